@@ -213,6 +213,7 @@ lv_str_enum_pattern = re.compile('^_{prefix}_STR_(.+)'.format(prefix=module_pref
 lv_callback_type_pattern = re.compile('({prefix}_){{0,1}}(.+)_cb(_t){{0,1}}'.format(prefix=module_prefix))
 lv_global_callback_pattern = re.compile('.*g_cb_t')
 lv_func_returns_array = re.compile('.*_array$')
+lv_func_keeps_arg = re.compile('.*_(set|add)_.*')
 lv_enum_name_pattern = re.compile('^(ENUM_){{0,1}}({prefix}_){{0,1}}(.*)'.format(prefix=module_prefix.upper()))
 
 # Prevent identifier names which are Python reserved words (add underscore in such case)
@@ -269,6 +270,34 @@ def is_obj_ctor(func):
     if not lv_base_obj_pattern.match(get_type(args[0].type, remove_quals=True)): return False
     return True
 
+def is_lv_obj_arg(arg):
+    return hasattr(arg, 'type') and get_type(arg.type, remove_quals = True) == 'lv_obj_t *'
+
+def is_ptr_arg(arg):
+    return hasattr(arg, 'type') and isinstance(arg.type, (c_ast.PtrDecl, c_ast.ArrayDecl)) and not decl_to_callback(arg)
+
+def has_user_data_arg(args):
+    return len(args) > 0 and hasattr(args[-1], 'type') and gen.visit(args[-1].type) == 'void *' and args[-1].name == 'user_data' and \
+        any(decl_to_callback(arg) for arg in args)
+
+# Pointer arguments an LVGL setter may store, kept alive with its first argument
+def get_kept_args(func, args):
+    if len(args) < 2 or not lv_func_keeps_arg.match(func.name) or not is_ptr_arg(args[0]):
+        return []
+    user_data_arg = has_user_data_arg(args)
+    return [i for i, arg in enumerate(args)
+        if i > 0 and is_ptr_arg(arg) and not is_lv_obj_arg(arg) and not (user_data_arg and i == len(args) - 1)]
+
+# A function that copies its const struct argument into LVGL's memory and returns the copy (lv_anim_start)
+def get_copied_struct_name(func, args):
+    if len(args) < 1 or not is_ptr_arg(args[0]) or is_lv_obj_arg(args[0]) or not isinstance(func.type.type, c_ast.PtrDecl):
+        return None
+    arg_type = args[0].type.type
+    if not hasattr(arg_type, 'quals') or 'const' not in arg_type.quals:
+        return None
+    struct_name = get_type(arg_type, remove_quals = True)
+    return struct_name if struct_name == get_type(func.type.type.type, remove_quals = True) else None
+
 def is_global_callback(arg_type):
     arg_type_str = get_name(arg_type.type)
     # print('/* --> is_global_callback %s: %s */' % (lv_global_callback_pattern.match(arg_type_str), arg_type_str))
@@ -755,6 +784,18 @@ print ("""
  */
 
 {lv_headers}
+
+/*
+ * The port can refresh the display off the python thread. LV_MP_WAIT() returns once python can touch LVGL again,
+ * LV_MP_CAN_CALL() says whether a callback on this thread can call python
+ */
+
+#ifndef LV_MP_WAIT
+#define LV_MP_WAIT()
+#endif
+#ifndef LV_MP_CAN_CALL
+#define LV_MP_CAN_CALL() 1
+#endif
 """.format(
         module_name = module_name,
         cmd_line=' '.join(argv),
@@ -843,6 +884,7 @@ STATIC mp_obj_t lv_fun_builtin_var_call(mp_obj_t self_in, size_t n_args, size_t
            MP_OBJ_IS_TYPE(self_in, &mp_lv_type_fun_builtin_static_var));
     mp_lv_obj_fun_builtin_var_t *self = MP_OBJ_TO_PTR(self_in);
     mp_arg_check_num(n_args, n_kw, self->n_args, self->n_args, false);
+    LV_MP_WAIT();
     return self->mp_fun(n_args, args, self->lv_fun);
 }
 
@@ -872,6 +914,7 @@ typedef struct mp_lv_struct_t
 {
     mp_obj_base_t base;
     void *data;
+    mp_obj_t kept; // python objects LVGL points to from this struct, when python allocated it
 } mp_lv_struct_t;
 
 STATIC const mp_lv_struct_t mp_lv_null_obj;
@@ -969,6 +1012,43 @@ STATIC inline LV_OBJ_T *mp_get_callbacks(mp_obj_t mp_obj)
 
 STATIC inline const mp_obj_type_t *get_BaseObj_type();
 
+// LVGL's memory is outside the GC heap, so the GC can't see python objects that only LVGL points to.
+// They are kept alive here instead: the handle of every lv_obj_t python has seen, until the object is deleted,
+// and anything without an owner to keep it with.
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp_lv_handles);
+
+// What is kept with an owner in LVGL's memory (an object, style, animation, timer, display...), keyed by the owner,
+// until LVGL calls lv_mp_release for it
+MP_REGISTER_ROOT_POINTER(mp_obj_t mp_lv_kept);
+
+#define MP_LV_KEY(ptr) MP_OBJ_NEW_SMALL_INT((uintptr_t)(ptr) >> 2)
+
+STATIC mp_obj_t mp_lv_handles_dict()
+{
+    if (MP_STATE_VM(mp_lv_handles) == MP_OBJ_NULL) MP_STATE_VM(mp_lv_handles) = mp_obj_new_dict(0);
+    return MP_STATE_VM(mp_lv_handles);
+}
+
+STATIC void mp_lv_keep(const void *lv_ptr, mp_obj_t obj)
+{
+    mp_obj_dict_store(mp_lv_handles_dict(), MP_LV_KEY(lv_ptr), obj);
+}
+
+STATIC void mp_lv_drop(const void *lv_ptr)
+{
+    if (MP_STATE_VM(mp_lv_handles) == MP_OBJ_NULL) return;
+    mp_obj_dict_t *dict = MP_OBJ_TO_PTR(MP_STATE_VM(mp_lv_handles));
+    mp_map_lookup(&dict->map, MP_LV_KEY(lv_ptr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+}
+
+// Called by LVGL when it frees or resets an owner
+void lv_mp_release(const void *owner)
+{
+    if (MP_STATE_VM(mp_lv_kept) == MP_OBJ_NULL) return;
+    mp_obj_dict_t *dict = MP_OBJ_TO_PTR(MP_STATE_VM(mp_lv_kept));
+    mp_map_lookup(&dict->map, MP_LV_KEY(owner), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+}
+
 STATIC void mp_lv_delete_cb(lv_event_t * e)
 {
     LV_OBJ_T *lv_obj = e->current_target;
@@ -977,6 +1057,8 @@ STATIC void mp_lv_delete_cb(lv_event_t * e)
         if (self) {
             self->lv_obj = NULL;
         }
+        mp_lv_drop(lv_obj);
+        lv_mp_release(lv_obj);
     }
 }
 
@@ -1005,8 +1087,9 @@ STATIC inline mp_obj_t lv_to_mp(LV_OBJ_T *lv_obj)
             .callbacks = NULL,
         };
 
-        // Register the Python object in user_data
+        // Register the Python object in user_data, and keep it while the object lives
         lv_obj->user_data = self;
+        mp_lv_keep(lv_obj, MP_OBJ_FROM_PTR(self));
 
         // Register a "Delete" event callback
         lv_obj_add_event_cb(lv_obj, mp_lv_delete_cb, LV_EVENT_DELETE, NULL);
@@ -1206,6 +1289,7 @@ STATIC mp_obj_t lv_struct_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t
 
 STATIC mp_obj_t lv_struct_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value)
 {
+    LV_MP_WAIT();
     mp_lv_struct_t *self = mp_to_lv_struct(self_in);
 
     if ((!self) || (!self->data))
@@ -1489,14 +1573,133 @@ STATIC mp_obj_t get_callback_dict_from_user_data(void *user_data)
 typedef void *(*mp_lv_get_user_data)(void *);
 typedef void (*mp_lv_set_user_data)(void *, void *);
 
+// Python objects an LVGL setter stores a pointer to (image sources, styles, button maps, callback dicts) are kept
+// with the owner they are stored in: the function's first argument. When LVGL allocated the owner they are kept in
+// mp_lv_kept until LVGL releases it. When python allocated it they are kept in its struct object, and go with it.
+// Without an owner they are kept for good.
+
+#ifdef LV_OBJ_T
+
+STATIC mp_obj_t mp_lv_kept_dict(mp_obj_t owner_obj, const void *owner, bool create)
+{
+    if (!owner) return MP_OBJ_NULL;
+    if (!lv_mem_arena_has(owner)) {
+        mp_obj_t native_obj = owner_obj == MP_OBJ_NULL ? MP_OBJ_NULL : get_native_obj(owner_obj);
+        if (native_obj == MP_OBJ_NULL || !MP_OBJ_IS_OBJ(native_obj) ||
+            MP_OBJ_TYPE_GET_SLOT_OR_NULL(mp_obj_get_type(native_obj), make_new) != &make_new_lv_struct) return MP_OBJ_NULL;
+        mp_lv_struct_t *mp_lv_struct = MP_OBJ_TO_PTR(native_obj);
+        if (mp_lv_struct->data != owner) return MP_OBJ_NULL;
+        if (mp_lv_struct->kept == MP_OBJ_NULL && create) mp_lv_struct->kept = mp_obj_new_dict(0);
+        return mp_lv_struct->kept;
+    }
+    if (MP_STATE_VM(mp_lv_kept) == MP_OBJ_NULL) {
+        if (!create) return MP_OBJ_NULL;
+        MP_STATE_VM(mp_lv_kept) = mp_obj_new_dict(0);
+    }
+    mp_obj_dict_t *dict = MP_OBJ_TO_PTR(MP_STATE_VM(mp_lv_kept));
+    mp_map_elem_t *elem = mp_map_lookup(&dict->map, MP_LV_KEY(owner), MP_MAP_LOOKUP);
+    if (elem) return elem->value;
+    if (!create) return MP_OBJ_NULL;
+    mp_obj_t kept = mp_obj_new_dict(0);
+    mp_obj_dict_store(MP_STATE_VM(mp_lv_kept), MP_LV_KEY(owner), kept);
+    return kept;
+}
+
+STATIC void mp_lv_keep_with(mp_obj_t owner_obj, const void *owner, mp_obj_t key, mp_obj_t obj)
+{
+    mp_obj_t kept = mp_lv_kept_dict(owner_obj, owner, true);
+    if (kept != MP_OBJ_NULL) {
+        mp_obj_dict_store(kept, key, obj);
+    } else if (mp_obj_is_obj(obj) && obj != mp_const_none) {
+        mp_lv_keep(MP_OBJ_TO_PTR(obj), obj);
+    }
+}
+
+// A setter replaces what it stored before with the same other arguments (a selector, a keyboard mode), so what it's
+// passed is kept under the setter and those. Structs LVGL allocated itself (chart series and such) are part of the key
+GENMPY_UNUSED STATIC void mp_lv_keep_set(mp_obj_t owner_obj, const void *owner, const void *setter,
+    const mp_obj_t *keys, size_t n_keys, const mp_obj_t *objs, const void * const *data, size_t n_objs)
+{
+    if (!owner) return;
+    size_t n_arena = 0;
+    for (size_t i = 0; i < n_objs; i++) {
+        if (data[i] && lv_mem_arena_has(data[i])) n_arena++;
+    }
+    mp_obj_tuple_t *key = MP_OBJ_TO_PTR(mp_obj_new_tuple(1 + n_keys + n_arena, NULL));
+    mp_obj_tuple_t *kept = MP_OBJ_TO_PTR(mp_obj_new_tuple(n_objs - n_arena, NULL));
+    size_t k = 0, o = 0;
+    key->items[k++] = MP_LV_KEY(setter);
+    for (size_t i = 0; i < n_keys; i++) key->items[k++] = keys[i];
+    for (size_t i = 0; i < n_objs; i++) {
+        if (data[i] && lv_mem_arena_has(data[i])) key->items[k++] = MP_LV_KEY(data[i]);
+        else kept->items[o++] = objs[i];
+    }
+    mp_lv_keep_with(owner_obj, owner, MP_OBJ_FROM_PTR(key), MP_OBJ_FROM_PTR(kept));
+}
+
+// What is added piles up (styles on an object), so each is kept under what it points to.
+// Structs LVGL allocated itself (chart series and such) don't need it
+GENMPY_UNUSED STATIC void mp_lv_keep_add(mp_obj_t owner_obj, const void *owner, mp_obj_t obj, const void *data)
+{
+    if (owner && data && !lv_mem_arena_has(data)) mp_lv_keep_with(owner_obj, owner, MP_LV_KEY(data), obj);
+}
+
+// A user_data argument is kept with the function's first argument, or with what it returns (a timer) without one
+GENMPY_UNUSED STATIC void mp_lv_keep_user_data(mp_obj_t owner_obj, const void *owner, mp_obj_t user_data_obj, void *user_data)
+{
+    if (!user_data) return;
+    if (user_data_obj == mp_const_none) user_data_obj = MP_OBJ_FROM_PTR(user_data); // the callback dict made for it
+    mp_lv_keep_with(owner_obj, owner, MP_LV_KEY(user_data), user_data_obj);
+}
+
+// lv_anim_start copies a python struct into LVGL's memory, what was kept with it now has to be kept with the copy
+GENMPY_UNUSED STATIC void mp_lv_keep_copy(mp_obj_t src_obj, const void *src, const void *dst, void *user_data)
+{
+    if (!dst || dst == src) return;
+    mp_obj_t src_kept = mp_lv_kept_dict(src_obj, src, false);
+    if (src_kept != MP_OBJ_NULL) {
+        mp_map_t *map = mp_obj_dict_get_map(src_kept);
+        for (size_t i = 0; i < map->alloc; i++) {
+            if (mp_map_slot_is_filled(map, i)) mp_lv_keep_with(MP_OBJ_NULL, dst, map->table[i].key, map->table[i].value);
+        }
+    }
+    if (user_data) mp_lv_keep_with(MP_OBJ_NULL, dst, MP_LV_KEY(user_data), MP_OBJ_FROM_PTR(user_data));
+}
+
+// A callback dict in the user_data of a python struct is seen by the GC already.
+// A user_data argument is kept after the call, see mp_lv_keep_user_data
+STATIC void mp_lv_root_callbacks(void *dict, mp_obj_t owner_obj, bool user_data_arg)
+{
+    const void *owner = owner_obj == MP_OBJ_NULL ? NULL : mp_to_ptr(owner_obj);
+    if (user_data_arg || !owner || !lv_mem_arena_has(owner)) return;
+    mp_lv_keep_with(owner_obj, owner, MP_LV_KEY(dict), MP_OBJ_FROM_PTR(dict));
+}
+
+#else // LV_OBJ_T
+
+STATIC inline void mp_lv_keep_set(mp_obj_t owner_obj, const void *owner, const void *setter,
+    const mp_obj_t *keys, size_t n_keys, const mp_obj_t *objs, const void * const *data, size_t n_objs) {}
+STATIC inline void mp_lv_keep_add(mp_obj_t owner_obj, const void *owner, mp_obj_t obj, const void *data) {}
+STATIC inline void mp_lv_keep_user_data(mp_obj_t owner_obj, const void *owner, mp_obj_t user_data_obj, void *user_data) {}
+STATIC inline void mp_lv_keep_copy(mp_obj_t src_obj, const void *src, const void *dst, void *user_data) {}
+STATIC inline void mp_lv_root_callbacks(void *dict, mp_obj_t owner_obj, bool user_data_arg) {}
+
+#endif // LV_OBJ_T
+
+// A new callback dict is kept alive with owner, the function's first argument (MP_OBJ_NULL if it has none).
+// user_data_arg is set when user_data_ptr is a local variable.
 STATIC void *mp_lv_callback(mp_obj_t mp_callback, void *lv_callback, qstr callback_name,
-     void **user_data_ptr, void *containing_struct, mp_lv_get_user_data get_user_data, mp_lv_set_user_data set_user_data)
+     void **user_data_ptr, void *containing_struct, mp_lv_get_user_data get_user_data, mp_lv_set_user_data set_user_data,
+     mp_obj_t owner, bool user_data_arg)
 {
     if (lv_callback && mp_obj_is_callable(mp_callback)) {
         void *user_data = NULL;
         if (user_data_ptr) {
             // user_data is either a dict of callbacks in case of struct, or a pointer to mp_lv_obj_t in case of lv_obj_t
-            if (! (*user_data_ptr) ) *user_data_ptr = MP_OBJ_TO_PTR(mp_obj_new_dict(0)); // if it's NULL - it's a dict for a struct
+            if (! (*user_data_ptr) ) { // if it's NULL - it's a dict for a struct
+                *user_data_ptr = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
+                mp_lv_root_callbacks(*user_data_ptr, owner, user_data_arg);
+            }
             user_data = *user_data_ptr;
         }
         else if (get_user_data && set_user_data) {
@@ -1504,6 +1707,7 @@ STATIC void *mp_lv_callback(mp_obj_t mp_callback, void *lv_callback, qstr callba
             if (!user_data) {
                 user_data = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
                 set_user_data(containing_struct, user_data);
+                mp_lv_root_callbacks(user_data, owner, false);
             }
         }
 
@@ -1940,7 +2144,7 @@ def try_generate_struct(struct_name, struct):
                     gen_func_error(decl, "Missing 'user_data' as a field of the first parameter of the callback function '%s_%s_callback'" % (struct_name, func_name))
                 else:
                     gen_func_error(decl, "Missing 'user_data' member in struct '%s'" % struct_name)
-            write_cases.append('case MP_QSTR_{field}: data->{decl_name} = {cast}mp_lv_callback(dest[1], {lv_callback} ,MP_QSTR_{struct_name}_{field}, {user_data}, NULL, NULL, NULL); break; // converting to callback {type_name}'.
+            write_cases.append('case MP_QSTR_{field}: data->{decl_name} = {cast}mp_lv_callback(dest[1], {lv_callback} ,MP_QSTR_{struct_name}_{field}, {user_data}, NULL, NULL, NULL, MP_OBJ_NULL, false); break; // converting to callback {type_name}'.
                 format(struct_name = struct_name, field = sanitize(decl.name), decl_name = decl.name, lv_callback = lv_callback, user_data = full_user_data_ptr, type_name = type_name, cast = cast))
             read_cases.append('case MP_QSTR_{field}: dest[0] = mp_lv_funcptr(&mp_{funcptr}_mpobj, {cast}data->{decl_name}, {lv_callback} ,MP_QSTR_{struct_name}_{field}, {user_data}); break; // converting from callback {type_name}'.
                 format(struct_name = struct_name, field = sanitize(decl.name), decl_name = decl.name, lv_callback = lv_callback, funcptr = lv_to_mp_funcptr[type_name], user_data = full_user_data, type_name = type_name, cast = cast))
@@ -1987,6 +2191,7 @@ STATIC inline mp_obj_t mp_read_ptr_{sanitized_struct_name}(void *field)
 
 STATIC void mp_{sanitized_struct_name}_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest)
 {{
+    LV_MP_WAIT();
     mp_lv_struct_t *self = MP_OBJ_TO_PTR(self_in);
     GENMPY_UNUSED {struct_tag}{struct_name} *data = ({struct_tag}{struct_name}*)self->data;
 
@@ -2384,6 +2589,7 @@ def gen_callback_func(func, func_name = None, user_data_argument = False):
 
 GENMPY_UNUSED STATIC {return_type} {func_name}_callback({func_args})
 {{
+    if (!LV_MP_CAN_CALL()) return{default_value};
     mp_obj_t mp_args[{num_args}];
     {build_args}
     mp_obj_t callbacks = get_callback_dict_from_user_data({user_data});
@@ -2401,6 +2607,7 @@ GENMPY_UNUSED STATIC {return_type} {func_name}_callback({func_args})
         build_args="\n    ".join([build_callback_func_arg(arg, i, func, func_name=func_name) for i,arg in enumerate(args)]),
         user_data=full_user_data,
         return_value_assignment = '' if return_type == 'void' else 'mp_obj_t callback_result = ',
+        default_value = '' if return_type == 'void' else ' (%s){0}' % return_type,
         return_value='' if return_type == 'void' else ' %s(callback_result)' % mp_to_lv[return_type]))
     generated_callbacks[func_name] = True
 
@@ -2461,8 +2668,10 @@ def build_mp_func_arg(arg, index, func, obj_name):
             arg_metadata = {'type': 'callback', 'function': callback_metadata[callback_name]}
             if arg.name: arg_metadata['name'] = arg.name
             func_metadata[func.name]['args'].append(arg_metadata)
-            return 'void *{arg_name} = mp_lv_callback(mp_args[{i}], &{callback_name}_callback, MP_QSTR_{callback_name}, {full_user_data}, {containing_struct}, (mp_lv_get_user_data){user_data_getter}, (mp_lv_set_user_data){user_data_setter});'.format(
+            return 'void *{arg_name} = mp_lv_callback(mp_args[{i}], &{callback_name}_callback, MP_QSTR_{callback_name}, {full_user_data}, {containing_struct}, (mp_lv_get_user_data){user_data_getter}, (mp_lv_set_user_data){user_data_setter}, {owner}, {user_data_arg});'.format(
                 i = index,
+                owner = 'mp_args[0]' if index > 0 and is_ptr_arg(args[0]) else 'MP_OBJ_NULL',
+                user_data_arg = 'true' if user_data_argument else 'false',
                 arg_name = fixed_arg.name,
                 callback_name = sanitize(callback_name),
                 full_user_data = full_user_data,
@@ -2491,6 +2700,70 @@ def build_mp_func_arg(arg, index, func, obj_name):
             convertor = mp_to_lv[arg_type],
             i = index)
 
+def get_arg_name_or_default(arg, index):
+    return arg.name if (hasattr(arg, 'name') and arg.name) else ("arg%d" % index)
+
+# LVGL holds on to what a setter is passed (image sources, styles, button maps), keep it alive with the owner.
+# A list passed as an array is converted to a new C array, that's what LVGL points to
+def build_mp_func_kept_objs(arg, index):
+    var = get_arg_name_or_default(arg, index)
+    convertor = mp_to_lv[get_type(arg.type, remove_quals = True)]
+    if convertor.startswith('mp_arr_to_') or convertor.startswith('mp_array_to_'):
+        return ['mp_args[%d]' % index, 'MP_OBJ_FROM_PTR(%s)' % var], [var, var]
+    return ['mp_args[%d]' % index], [var]
+
+# The other arguments of a setter tell what it replaces (a selector, a keyboard mode)
+def build_mp_func_set_key(arg, index):
+    if is_ptr_arg(arg):
+        return 'MP_LV_KEY(%s)' % get_arg_name_or_default(arg, index)
+    if lv_mp_type.get(get_type(arg.type, remove_quals = True)) in ['int', 'float', 'bool']:
+        return 'mp_args[%d]' % index
+    return None
+
+def build_mp_func_keep(func, args):
+    kept_args = get_kept_args(func, args)
+    if not kept_args:
+        return ''
+    owner = get_arg_name_or_default(args[0], 0)
+    objs, data = [], []
+    for i in kept_args:
+        arg_objs, arg_data = build_mp_func_kept_objs(args[i], i)
+        objs += arg_objs
+        data += arg_data
+    if '_set_' in func.name:
+        keys = [build_mp_func_set_key(arg, i) for i, arg in enumerate(args) if i > 0 and i not in kept_args]
+        keys = [key for key in keys if key]
+        return 'mp_lv_keep_set(mp_args[0], {owner}, lv_func_ptr, {keys}, {n_keys}, (const mp_obj_t[]){{{objs}}}, (const void *[]){{{data}}}, {n_objs});'.format(
+            owner = owner,
+            keys = '(const mp_obj_t[]){%s}' % ', '.join(keys) if keys else 'NULL',
+            n_keys = len(keys),
+            objs = ', '.join(objs),
+            data = ', '.join(data),
+            n_objs = len(objs))
+    return '\n    '.join('mp_lv_keep_add(mp_args[0], {owner}, {obj}, {var});'.format(
+            owner = owner,
+            obj = obj,
+            var = var) for obj, var in zip(objs, data))
+
+# What LVGL stores during the call that can only be kept once it returns
+def build_mp_func_keep_result(func, args):
+    if has_user_data_arg(args):
+        if is_ptr_arg(args[0]):
+            owner_obj, owner = 'mp_args[0]', get_arg_name_or_default(args[0], 0)
+        else:
+            owner_obj, owner = 'MP_OBJ_NULL', '_res' if isinstance(func.type.type, c_ast.PtrDecl) else 'NULL'
+        return 'mp_lv_keep_user_data({owner_obj}, {owner}, mp_args[{i}], user_data);'.format(
+            owner_obj = owner_obj,
+            owner = owner,
+            i = len(args) - 1)
+    copied_struct_name = get_copied_struct_name(func, args)
+    if copied_struct_name in structs:
+        has_user_data = 'user_data' in [decl.name for decl in flatten_struct(structs[copied_struct_name].decls)]
+        return 'mp_lv_keep_copy(mp_args[0], {src}, _res, {user_data});'.format(
+            src = get_arg_name_or_default(args[0], 0),
+            user_data = '_res ? _res->user_data : NULL' if has_user_data else 'NULL')
+    return ''
+
 def emit_func_obj(func_obj_name, func_name, param_count, func_ptr, is_static):
     print("""
 STATIC {builtin_macro}(mp_{func_obj_name}_mpobj, {param_count}, mp_{func_name}, {func_ptr});
@@ -2525,9 +2798,18 @@ def gen_mp_func(func, obj_name):
         param_count = len(args)
 
     # If func prototype matches an already generated func, reuse it and only emit func obj that points to it.
+    # What a body keeps alive depends on more than the prototype, so that's part of the key.
     prototype_str = gen.visit(function_prototype(func))
-    if prototype_str in func_prototypes:
-        original_func = func_prototypes[prototype_str]
+    kept_args = get_kept_args(func, args)
+    reuse_key = prototype_str
+    if kept_args:
+        reuse_key += ' %s %s' % ('set' if '_set_' in func.name else 'add', kept_args)
+    if has_user_data_arg(args):
+        reuse_key += ' user_data'
+    elif get_copied_struct_name(func, args):
+        reuse_key += ' copy'
+    if reuse_key in func_prototypes:
+        original_func = func_prototypes[reuse_key]
         if generated_funcs[original_func.name] == True:
             print("/* Reusing %s for %s */" % (original_func.name, func.name))
             emit_func_obj(func.name, original_func.name, param_count, func.name, is_static_member(func, base_obj_type))
@@ -2535,7 +2817,7 @@ def gen_mp_func(func, obj_name):
             func_metadata[func.name]['args'] = func_metadata[original_func.name]['args']
             generated_funcs[func.name] = True # completed generating the function
             return
-    func_prototypes[prototype_str] = func
+    func_prototypes[reuse_key] = func
 
     # user_data argument must be handled first, if it exists
     try:
@@ -2572,8 +2854,8 @@ def gen_mp_func(func, obj_name):
 
 STATIC mp_obj_t mp_{func}(size_t mp_n_args, const mp_obj_t *mp_args, void *lv_func_ptr)
 {{
-    {build_args}
-    {build_result}(({func_ptr})lv_func_ptr)({send_args});
+    {build_args}{build_keep}
+    {build_result}(({func_ptr})lv_func_ptr)({send_args});{build_keep_result}
     return {build_return_value};
 }}
 
@@ -2587,8 +2869,10 @@ STATIC mp_obj_t mp_{func}(size_t mp_n_args, const mp_obj_t *mp_args, void *lv_fu
                (not isinstance(arg.type, c_ast.TypeDecl)) or
                (not isinstance(arg.type.type, c_ast.IdentifierType)) or
                'void' not in arg.type.type.names]), # Handle the case of 'void' param which should be ignored
-        send_args=", ".join([(arg.name if (hasattr(arg, 'name') and arg.name) else ("arg%d" % i)) for i,arg in enumerate(args)]),
+        build_keep=''.join('\n    ' + line for line in [build_mp_func_keep(func, args)] if line),
+        send_args=", ".join([get_arg_name_or_default(arg, i) for i,arg in enumerate(args)]),
         build_result=build_result,
+        build_keep_result=''.join('\n    ' + line for line in [build_mp_func_keep_result(func, args)] if line),
         build_return_value=build_return_value))
 
     emit_func_obj(func.name, func.name, param_count, func.name, is_static_member(func, base_obj_type))
@@ -56,6 +56,21 @@
 #define LV_USE_STDLIB_STRING    LV_STDLIB_BUILTIN
 #define LV_USE_STDLIB_SPRINTF   LV_STDLIB_BUILTIN
 
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
+    /*LVGL allocates from its own TLSF arena outside the MicroPython heap, so widgets aren't scanned by every
+     *gc.collect() and don't fragment the heap python apps use. It's SPIRAM on the ESP and mmap'd on desktop.
+     *When it's full another pool of LV_MEM_ARENA_EXPAND_SIZE (or bigger, for one big allocation) is added*/
+#ifdef ESP_PLATFORM
+    #define LV_MEM_ARENA_SIZE (1024 * 1024U)
+    #define LV_MEM_ARENA_EXPAND_SIZE (256 * 1024U)
+#else
+    #define LV_MEM_ARENA_SIZE (4 * 1024 * 1024U)
+    #define LV_MEM_ARENA_EXPAND_SIZE (1024 * 1024U)
+#endif
+    /*Most pools the arena will grow to, the first one included*/
+    #define LV_MEM_ARENA_MAX_POOLS 8
+#endif
+
 #if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
     /*Size of the memory available for `lv_malloc()` in bytes (>= 2kB)*/
     #define LV_MEM_SIZE (512 * 1024U)          /*[bytes]*/
@@ -100,7 +115,23 @@
  * - LV_OS_RTTHREAD
  * - LV_OS_WINDOWS
  * - LV_OS_CUSTOM */
-#define LV_USE_OS   LV_OS_NONE
+/*Tulip refreshes the display on a render thread of its own, and renders with two draw units, on both cores of the S3
+ *or as pthreads on desktop*/
+#ifdef ESP_PLATFORM
+    #define LV_USE_OS   LV_OS_FREERTOS
+#else
+    #define LV_USE_OS   LV_OS_PTHREAD
+#endif
+
+/*The render thread is in tulip/shared/lvgl_render.c. The MicroPython binding waits for its refresh before python
+ *touches LVGL, and asks before it calls python from a callback*/
+#if !defined(LVGL_PREPROCESS) && !defined(__ASSEMBLY__)
+    #include <stdint.h>
+    void lvgl_render_wait();
+    uint8_t lvgl_render_python_ok();
+#endif
+#define LV_MP_WAIT()        lvgl_render_wait()
+#define LV_MP_CAN_CALL()    lvgl_render_python_ok()
 
 #if LV_USE_OS == LV_OS_CUSTOM
     #define LV_OS_CUSTOM_INCLUDE <stdint.h>
@@ -121,7 +152,7 @@
     /* Set the number of draw unit.
      * > 1 requires an operating system enabled in `LV_USE_OS`
      * > 1 means multiply threads will render the screen in parallel */
-    #define LV_DRAW_SW_DRAW_UNIT_CNT    1
+    #define LV_DRAW_SW_DRAW_UNIT_CNT    2
 
     /* Use Arm-2D to accelerate the sw render */
     #define LV_USE_DRAW_ARM2D_SYNC      0
@@ -151,13 +182,21 @@
         #define LV_DRAW_SW_CIRCLE_CACHE_SIZE 4
     #endif
 
-    #define  LV_USE_DRAW_SW_ASM     LV_DRAW_SW_ASM_NONE
+    /* Tulip's RGB332 blend kernels (SSE2 / NEON on desktop, 32-bit SWAR on the ESP32-S3) */
+    #define  LV_USE_DRAW_SW_ASM     LV_DRAW_SW_ASM_CUSTOM
 
     #if LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM
-        #define  LV_DRAW_SW_ASM_CUSTOM_INCLUDE ""
+        #define  LV_DRAW_SW_ASM_CUSTOM_INCLUDE "draw/sw/blend/tulip/lv_blend_tulip.h"
     #endif
 #endif
 
+/* Stack size of each draw unit's thread. On the S3 these come out of internal RAM */
+#ifdef ESP_PLATFORM
+    #define LV_DRAW_THREAD_STACKSIZE (10 * 1024)
+#else
+    #define LV_DRAW_THREAD_STACKSIZE (64 * 1024)
+#endif
+
 /* Use NXP's VG-Lite GPU on iMX RTxxx platforms. */
 #define LV_USE_DRAW_VGLITE 0
 
@@ -306,8 +345,11 @@ extern void mp_lv_init_gc();
  *If size is 0, the cache function is not enabled and the decoded mem will be released immediately after use.*/
 #ifdef MICROPY_CACHE_SIZE
     #define LV_CACHE_DEF_SIZE   MICROPY_CACHE_SIZE
+#elif defined(ESP_PLATFORM)
+    /*Tulip's PNG decoder (tulip/shared/lvgl_png.c) caches RGB332 images in the arena*/
+    #define LV_CACHE_DEF_SIZE   (512 * 1024)
 #else
-    #define LV_CACHE_DEF_SIZE   0
+    #define LV_CACHE_DEF_SIZE   (2 * 1024 * 1024)
 #endif
 
 /*Default number of image header cache entries. The cache is used to store the headers of images
@@ -135,7 +135,7 @@ typedef struct _lv_global_t {
     void * theme_mono;
 #endif
 
-#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN || LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
     lv_tlsf_state_t tlsf_state;
 #endif
 
@@ -562,6 +562,9 @@ static uint32_t _calculate_draw_buf_size(uint32_t w, uint32_t h, lv_color_format
     if(cf == LV_COLOR_FORMAT_RGB565A8) {
         size += (stride / 2) * h; /*A8 mask*/
     }
+    else if(cf == LV_COLOR_FORMAT_RGB332A8) {
+        size += stride * h; /*A8 mask*/
+    }
     else if(LV_COLOR_FORMAT_IS_INDEXED(cf)) {
         /*@todo we have to include palette right before image data*/
         size += LV_COLOR_INDEXED_PALETTE_SIZE(cf) * 4;
@@ -218,7 +218,8 @@ lv_draw_buf_t * lv_image_decoder_post_process(lv_image_decoder_dsc_t * dsc, lv_d
     if(decoded == NULL) return NULL; /*No need to adjust*/
 
     lv_image_decoder_args_t * args = &dsc->args;
-    if(args->stride_align && decoded->header.cf != LV_COLOR_FORMAT_RGB565A8) {
+    if(args->stride_align && decoded->header.cf != LV_COLOR_FORMAT_RGB565A8 &&
+       decoded->header.cf != LV_COLOR_FORMAT_RGB332A8) {
         uint32_t stride_expect = lv_draw_buf_width_to_stride(decoded->header.w, decoded->header.cf);
         if(decoded->header.stride != stride_expect) {
             LV_LOG_TRACE("Stride mismatch");
@@ -0,0 +1,315 @@
+/**
+ * @file lv_blend_tulip.h
+ *
+ * RGB332 blend kernels for Tulip, hooked in with LV_USE_DRAW_SW_ASM == LV_DRAW_SW_ASM_CUSTOM.
+ *
+ * Tulip's RGB332 mix (lv_color_8_8_mix) only keeps 3 bits of alpha, and each level is a fixed bit select:
+ * dest = (src & bits) | (dest & ~bits). So a blend is just an AND/ANDNOT/OR per pixel, which we can do
+ * 16 pixels at a time with SSE2 or NEON on desktop and 4 at a time in a 32-bit word (SWAR) on the ESP32-S3.
+ * Results are bit-exact with the scalar loops in lv_draw_sw_blend_to_rgb332.c.
+ */
+
+#ifndef LV_BLEND_TULIP_H
+#define LV_BLEND_TULIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+
+#include "../../../../lv_conf_internal.h"
+
+#if !defined(__ASSEMBLY__) && !defined(LVGL_PREPROCESS)
+
+#include <stdint.h>
+#include <string.h>
+#include "../lv_draw_sw_blend.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB332(dsc)                   lv_color_blend_to_rgb332_tulip(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB332_WITH_OPA(dsc)          lv_color_blend_to_rgb332_with_opa_tulip(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB332_WITH_MASK(dsc)         lv_color_blend_to_rgb332_with_mask_tulip(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB332_MIX_MASK_OPA(dsc)      lv_color_blend_to_rgb332_mix_mask_opa_tulip(dsc)
+
+/* lv_draw_sw_blend_to_rgb332.c uses these for both RGB332 and ARGB8888 sources */
+#define LV_DRAW_SW_RGB332_BLEND_NORMAL_TO_RGB332(dsc)           lv_image_blend_to_rgb332_tulip(dsc, 0)
+#define LV_DRAW_SW_RGB332_BLEND_NORMAL_TO_RGB332_WITH_OPA(dsc)  lv_image_blend_to_rgb332_tulip(dsc, 0)
+#define LV_DRAW_SW_RGB332_BLEND_NORMAL_TO_RGB332_WITH_MASK(dsc) lv_image_blend_to_rgb332_tulip(dsc, 1)
+#define LV_DRAW_SW_RGB332_BLEND_NORMAL_TO_RGB332_MIX_MASK_OPA(dsc) lv_image_blend_to_rgb332_tulip(dsc, 1)
+
+/* Pixels per ARGB8888 conversion chunk */
+#define LV_BLEND_TULIP_CHUNK 64
+
+/**********************
+ *  INLINE FUNCTIONS
+ **********************/
+
+/* The bits of src that a mix of `opa` keeps. Same levels as the switch in lv_color_8_8_mix */
+static inline uint8_t lv_blend_tulip_bits(lv_opa_t opa)
+{
+    static const uint8_t bits[8] = { 0x00, 0x24, 0x49, 0x6d, 0x92, 0xb6, 0xdb, 0xff };
+    return bits[opa >> 5];
+}
+
+static inline uint32_t lv_blend_tulip_load32(const uint8_t * p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+/* p is word aligned here, so these are single loads and stores */
+static inline uint32_t lv_blend_tulip_load32_aligned(const uint8_t * p)
+{
+    uint32_t v;
+    memcpy(&v, __builtin_assume_aligned(p, 4), 4);
+    return v;
+}
+
+static inline void lv_blend_tulip_store32_aligned(uint8_t * p, uint32_t v)
+{
+    memcpy(__builtin_assume_aligned(p, 4), &v, 4);
+}
+
+/* dest = (src & bits) | (dest & ~bits) with one `bits` for the whole row. src NULL means `color` */
+static inline void LV_ATTRIBUTE_FAST_MEM lv_blend_tulip_row_const(uint8_t * dest, const uint8_t * src, uint8_t color,
+                                                                  uint8_t bits, int32_t w)
+{
+    int32_t x = 0;
+#if defined(__SSE2__)
+    __m128i b = _mm_set1_epi8((char)bits);
+    __m128i c = _mm_set1_epi8((char)(color & bits));
+    for(; x + 16 <= w; x += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + x));
+        __m128i s = src ? _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x)), b) : c;
+        _mm_storeu_si128((__m128i *)(dest + x), _mm_or_si128(s, _mm_andnot_si128(b, d)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint8x16_t b = vdupq_n_u8(bits);
+    uint8x16_t c = vdupq_n_u8(color);
+    for(; x + 16 <= w; x += 16) {
+        uint8x16_t s = src ? vld1q_u8(src + x) : c;
+        vst1q_u8(dest + x, vbslq_u8(b, s, vld1q_u8(dest + x)));
+    }
+#else
+    /* Byte at a time up to a word boundary, then 4 pixels per word */
+    for(; x < w && ((uintptr_t)(dest + x) & 3); x++) dest[x] = ((src ? src[x] : color) & bits) | (dest[x] & ~bits);
+    uint32_t b = bits * 0x01010101u;
+    uint32_t c = (color & bits) * 0x01010101u;
+    for(; x + 4 <= w; x += 4) {
+        uint32_t s = src ? (lv_blend_tulip_load32(src + x) & b) : c;
+        lv_blend_tulip_store32_aligned(dest + x, s | (lv_blend_tulip_load32_aligned(dest + x) & ~b));
+    }
+#endif
+    for(; x < w; x++) dest[x] = ((src ? src[x] : color) & bits) | (dest[x] & ~bits);
+}
+
+/* Same, but each pixel's bits come from its mask byte */
+static inline void LV_ATTRIBUTE_FAST_MEM lv_blend_tulip_row_mask(uint8_t * dest, const uint8_t * src, uint8_t color,
+                                                                 const lv_opa_t * mask, int32_t w)
+{
+    int32_t x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i seven = _mm_set1_epi8(7);
+    __m128i c = _mm_set1_epi8((char)color);
+    for(; x + 16 <= w; x += 16) {
+        __m128i m = _mm_loadu_si128((const __m128i *)(mask + x));
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero)) == 0xffff) continue;
+        __m128i s = src ? _mm_loadu_si128((const __m128i *)(src + x)) : c;
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(m, ones)) == 0xffff) {
+            _mm_storeu_si128((__m128i *)(dest + x), s);
+            continue;
+        }
+        /* No byte shuffle in SSE2, so build the bits from the 7 non-zero levels */
+        __m128i level = _mm_and_si128(_mm_srli_epi16(m, 5), seven);
+        __m128i b = zero;
+        for(int8_t l = 1; l < 8; l++) {
+            b = _mm_or_si128(b, _mm_and_si128(_mm_cmpeq_epi8(level, _mm_set1_epi8(l)),
+                                              _mm_set1_epi8((char)lv_blend_tulip_bits(l << 5))));
+        }
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + x));
+        _mm_storeu_si128((__m128i *)(dest + x), _mm_or_si128(_mm_and_si128(s, b), _mm_andnot_si128(b, d)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t levels[16] = { 0x00, 0x24, 0x49, 0x6d, 0x92, 0xb6, 0xdb, 0xff };
+    const uint8x16_t lut = vld1q_u8(levels);
+    uint8x16_t c = vdupq_n_u8(color);
+    for(; x + 16 <= w; x += 16) {
+        uint8x16_t m = vld1q_u8(mask + x);
+        if(vmaxvq_u8(m) == 0) continue;
+        uint8x16_t s = src ? vld1q_u8(src + x) : c;
+        if(vminvq_u8(m) == 0xff) {
+            vst1q_u8(dest + x, s);
+            continue;
+        }
+        uint8x16_t b = vqtbl1q_u8(lut, vshrq_n_u8(m, 5));
+        vst1q_u8(dest + x, vbslq_u8(b, s, vld1q_u8(dest + x)));
+    }
+#else
+    for(; x < w && ((uintptr_t)(dest + x) & 3); x++) {
+        uint8_t b = lv_blend_tulip_bits(mask[x]);
+        dest[x] = ((src ? src[x] : color) & b) | (dest[x] & ~b);
+    }
+    uint32_t c = color * 0x01010101u;
+    for(; x + 4 <= w; x += 4) {
+        /* Antialiased edges are short, most words are all clear or all set */
+        uint32_t m = lv_blend_tulip_load32(mask + x);
+        if(m == 0) continue;
+        uint32_t s = src ? lv_blend_tulip_load32(src + x) : c;
+        if(m == 0xffffffffu) {
+            lv_blend_tulip_store32_aligned(dest + x, s);
+            continue;
+        }
+        uint32_t b = lv_blend_tulip_bits(m & 0xff) | (lv_blend_tulip_bits((m >> 8) & 0xff) << 8) |
+                     (lv_blend_tulip_bits((m >> 16) & 0xff) << 16) | ((uint32_t)lv_blend_tulip_bits(m >> 24) << 24);
+        lv_blend_tulip_store32_aligned(dest + x, (s & b) | (lv_blend_tulip_load32_aligned(dest + x) & ~b));
+    }
+#endif
+    for(; x < w; x++) {
+        uint8_t b = lv_blend_tulip_bits(mask[x]);
+        dest[x] = ((src ? src[x] : color) & b) | (dest[x] & ~b);
+    }
+}
+
+static inline lv_result_t LV_ATTRIBUTE_FAST_MEM lv_color_blend_to_rgb332_tulip(_lv_draw_sw_blend_fill_dsc_t * dsc)
+{
+    uint8_t color8 = lv_color_rgb332(dsc->color);
+    uint8_t * dest = dsc->dest_buf;
+    for(int32_t y = 0; y < dsc->dest_h; y++) {
+        memset(dest, color8, dsc->dest_w);
+        dest += dsc->dest_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+static inline lv_result_t LV_ATTRIBUTE_FAST_MEM lv_color_blend_to_rgb332_with_opa_tulip(_lv_draw_sw_blend_fill_dsc_t *
+                                                                                        dsc)
+{
+    uint8_t bits = lv_blend_tulip_bits(dsc->opa);
+    if(bits == 0) return LV_RESULT_OK;
+    if(bits == 0xff) return lv_color_blend_to_rgb332_tulip(dsc);
+    uint8_t color8 = lv_color_rgb332(dsc->color);
+    uint8_t * dest = dsc->dest_buf;
+    for(int32_t y = 0; y < dsc->dest_h; y++) {
+        lv_blend_tulip_row_const(dest, NULL, color8, bits, dsc->dest_w);
+        dest += dsc->dest_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+static inline lv_result_t LV_ATTRIBUTE_FAST_MEM lv_color_blend_to_rgb332_with_mask_tulip(_lv_draw_sw_blend_fill_dsc_t *
+                                                                                         dsc)
+{
+    uint8_t color8 = lv_color_rgb332(dsc->color);
+    uint8_t * dest = dsc->dest_buf;
+    const lv_opa_t * mask = dsc->mask_buf;
+    for(int32_t y = 0; y < dsc->dest_h; y++) {
+        lv_blend_tulip_row_mask(dest, NULL, color8, mask, dsc->dest_w);
+        dest += dsc->dest_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+static inline lv_result_t LV_ATTRIBUTE_FAST_MEM lv_color_blend_to_rgb332_mix_mask_opa_tulip(
+    _lv_draw_sw_blend_fill_dsc_t * dsc)
+{
+    uint8_t color8 = lv_color_rgb332(dsc->color);
+    uint8_t * dest = dsc->dest_buf;
+    const lv_opa_t * mask = dsc->mask_buf;
+    lv_opa_t mixed[LV_BLEND_TULIP_CHUNK];
+    for(int32_t y = 0; y < dsc->dest_h; y++) {
+        for(int32_t x = 0; x < dsc->dest_w; x += LV_BLEND_TULIP_CHUNK) {
+            int32_t n = LV_MIN(LV_BLEND_TULIP_CHUNK, dsc->dest_w - x);
+            for(int32_t i = 0; i < n; i++) mixed[i] = LV_OPA_MIX2(mask[x + i], dsc->opa);
+            lv_blend_tulip_row_mask(dest + x, NULL, color8, mixed, n);
+        }
+        dest += dsc->dest_stride;
+        mask += dsc->mask_stride;
+    }
+    return LV_RESULT_OK;
+}
+
+/* Normal blend of an RGB332 or ARGB8888 image. Anything else falls back to the C loops */
+static inline lv_result_t LV_ATTRIBUTE_FAST_MEM lv_image_blend_to_rgb332_tulip(_lv_draw_sw_blend_image_dsc_t * dsc,
+                                                                               uint8_t masked)
+{
+    int32_t w = dsc->dest_w;
+    uint8_t * dest = dsc->dest_buf;
+    const lv_opa_t * mask = masked ? dsc->mask_buf : NULL;
+    lv_opa_t opa = dsc->opa >= LV_OPA_MAX ? LV_OPA_COVER : dsc->opa;
+
+    if(dsc->src_color_format == LV_COLOR_FORMAT_RGB332) {
+        const uint8_t * src = dsc->src_buf;
+        uint8_t bits = lv_blend_tulip_bits(opa);
+        lv_opa_t mixed[LV_BLEND_TULIP_CHUNK];
+        for(int32_t y = 0; y < dsc->dest_h; y++) {
+            if(mask == NULL) {
+                if(bits == 0xff) memcpy(dest, src, w);
+                else if(bits) lv_blend_tulip_row_const(dest, src, 0, bits, w);
+            }
+            else if(opa == LV_OPA_COVER) {
+                lv_blend_tulip_row_mask(dest, src, 0, mask, w);
+            }
+            else {
+                for(int32_t x = 0; x < w; x += LV_BLEND_TULIP_CHUNK) {
+                    int32_t n = LV_MIN(LV_BLEND_TULIP_CHUNK, w - x);
+                    for(int32_t i = 0; i < n; i++) mixed[i] = LV_OPA_MIX2(mask[x + i], opa);
+                    lv_blend_tulip_row_mask(dest + x, src + x, 0, mixed, n);
+                }
+            }
+            dest += dsc->dest_stride;
+            src += dsc->src_stride;
+            if(mask) mask += dsc->mask_stride;
+        }
+        return LV_RESULT_OK;
+    }
+
+    if(dsc->src_color_format == LV_COLOR_FORMAT_ARGB8888) {
+        /* Convert a chunk to RGB332 plus a combined alpha, then blend it like a masked RGB332 image */
+        const uint8_t * src_row = dsc->src_buf;
+        uint8_t px[LV_BLEND_TULIP_CHUNK];
+        lv_opa_t alpha[LV_BLEND_TULIP_CHUNK];
+        for(int32_t y = 0; y < dsc->dest_h; y++) {
+            const lv_color32_t * src = (const lv_color32_t *)src_row;
+            for(int32_t x = 0; x < w; x += LV_BLEND_TULIP_CHUNK) {
+                int32_t n = LV_MIN(LV_BLEND_TULIP_CHUNK, w - x);
+                for(int32_t i = 0; i < n; i++) {
+                    lv_color32_t c = src[x + i];
+                    px[i] = lv_color_rgb332_32(c);
+                    if(mask == NULL) alpha[i] = opa == LV_OPA_COVER ? c.alpha : LV_OPA_MIX2(c.alpha, opa);
+                    else alpha[i] = opa == LV_OPA_COVER ? LV_OPA_MIX2(c.alpha, mask[x + i]) : LV_OPA_MIX3(c.alpha, opa, mask[x + i]);
+                }
+                lv_blend_tulip_row_mask(dest + x, px, 0, alpha, n);
+            }
+            dest += dsc->dest_stride;
+            src_row += dsc->src_stride;
+            if(mask) mask += dsc->mask_stride;
+        }
+        return LV_RESULT_OK;
+    }
+
+    return LV_RESULT_INVALID;
+}
+
+#endif /*!defined(__ASSEMBLY__) && !defined(LVGL_PREPROCESS)*/
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_BLEND_TULIP_H*/
@@ -53,6 +53,7 @@
 static void img_draw_core(lv_draw_unit_t * draw_unit, const lv_draw_image_dsc_t * draw_dsc,
                           const lv_image_decoder_dsc_t * decoder_dsc, lv_draw_image_sup_t * sup,
                           const lv_area_t * img_coords, const lv_area_t * clipped_img_area);
+static uint8_t * rgb332_to_argb8888(const uint8_t * src_buf, const lv_image_header_t * header);
 
 /**********************
  *  STATIC VARIABLES
@@ -188,6 +189,22 @@ static void img_draw_core(lv_draw_unit_t * draw_unit, const lv_draw_image_dsc_t
     uint32_t img_stride = decoded->header.stride;
     lv_color_format_t cf = decoded->header.cf;
 
+    /*RGB332 and RGB332A8 can only be blended as they are. To transform, mask or recolor them
+     *widen them to ARGB8888 first and draw that like any other ARGB8888 image*/
+    uint8_t * argb_buf = NULL;
+    bool recolored = draw_dsc->recolor_opa > LV_OPA_MIN;
+    if((cf == LV_COLOR_FORMAT_RGB332 && (transformed || recolored)) ||
+       (cf == LV_COLOR_FORMAT_RGB332A8 && (transformed || masked || recolored))) {
+        argb_buf = rgb332_to_argb8888(src_buf, header);
+        if(argb_buf == NULL) {
+            LV_LOG_WARN("Couldn't allocate the ARGB8888 copy of an RGB332 image. Not drawing it.");
+            return;
+        }
+        src_buf = argb_buf;
+        img_stride = header->w * 4;
+        cf = LV_COLOR_FORMAT_ARGB8888;
+    }
+
     lv_memzero(&blend_dsc, sizeof(lv_draw_sw_blend_dsc_t));
     blend_dsc.opa = draw_dsc->opa;
     blend_dsc.blend_mode = draw_dsc->blend_mode;
@@ -226,6 +243,18 @@ static void img_draw_core(lv_draw_unit_t * draw_unit, const lv_draw_image_dsc_t
         blend_dsc.src_color_format = LV_COLOR_FORMAT_RGB565;
         lv_draw_sw_blend(draw_unit, &blend_dsc);
     }
+    else if(cf == LV_COLOR_FORMAT_RGB332A8) {
+        /*Blended as RGB332 + mask. Anything else was made ARGB8888 above*/
+        blend_dsc.src_area = img_coords;
+        blend_dsc.src_buf = src_buf;
+        blend_dsc.src_color_format = LV_COLOR_FORMAT_RGB332;
+        blend_dsc.blend_area = img_coords;
+        blend_dsc.mask_buf = (lv_opa_t *)src_buf + img_stride * header->h;
+        blend_dsc.mask_stride = img_stride;
+        blend_dsc.mask_area = img_coords;
+        blend_dsc.mask_res = LV_DRAW_SW_MASK_RES_CHANGED;
+        lv_draw_sw_blend(draw_unit, &blend_dsc);
+    }
     /*The simplest case just copy the pixels into the draw_buf. Blending will convert the colors if needed*/
     else if(!transformed && !masked && draw_dsc->recolor_opa <= LV_OPA_MIN) {
         blend_dsc.src_area = img_coords;
@@ -434,6 +463,38 @@ static void img_draw_core(lv_draw_unit_t * draw_unit, const lv_draw_image_dsc_t
 
         lv_free(tmp_buf);
     }
+
+    if(argb_buf) lv_free(argb_buf);
+}
+
+/**
+ * Widen an RGB332 or RGB332A8 image to ARGB8888, for the transform and recolor code
+ * @param src_buf   the RGB332 plane, followed by the A8 plane for RGB332A8
+ * @param header    the image's header
+ * @return          a w * h * 4 buffer to free with `lv_free`, NULL if out of memory
+ */
+static uint8_t * rgb332_to_argb8888(const uint8_t * src_buf, const lv_image_header_t * header)
+{
+    int32_t w = header->w;
+    int32_t h = header->h;
+    uint32_t stride = header->stride;
+    lv_color32_t * dest = lv_malloc(w * h * sizeof(lv_color32_t));
+    if(dest == NULL) return NULL;
+
+    const uint8_t * a_buf = header->cf == LV_COLOR_FORMAT_RGB332A8 ? src_buf + stride * h : NULL;
+    lv_color32_t * d = dest;
+    int32_t x, y;
+    for(y = 0; y < h; y++) {
+        const uint8_t * c = src_buf + stride * y;
+        for(x = 0; x < w; x++) {
+            d->red = ((c[x] >> 5) * 255) / 7;
+            d->green = (((c[x] >> 2) & 0x07) * 255) / 7;
+            d->blue = (c[x] & 0x03) * 85;
+            d->alpha = a_buf ? a_buf[stride * y + x] : LV_OPA_COVER;
+            d++;
+        }
+    }
+    return (uint8_t *)dest;
 }
 
 #endif /*LV_USE_DRAW_SW*/
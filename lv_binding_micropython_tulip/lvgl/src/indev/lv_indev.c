@@ -151,6 +151,7 @@ void lv_indev_delete(lv_indev_t * indev)
     /*Remove the input device from the list*/
     _lv_ll_remove(indev_ll_head, indev);
     /*Free the memory of the input device*/
+    LV_MP_RELEASE(indev);
     lv_free(indev);
 }
 
@@ -151,6 +151,7 @@ bool lv_anim_delete(void * var, lv_anim_exec_xcb_t exec_cb)
         if((a->var == var || var == NULL) && (a->exec_cb == exec_cb || exec_cb == NULL)) {
             _lv_ll_remove(anim_ll_p, a);
             if(a->deleted_cb != NULL) a->deleted_cb(a);
+            LV_MP_RELEASE(a);
             lv_free(a);
             anim_mark_list_change(); /*Read by `anim_timer`. It need to know if a delete occurred in
                                        the linked list*/
@@ -168,6 +169,12 @@ bool lv_anim_delete(void * var, lv_anim_exec_xcb_t exec_cb)
 
 void lv_anim_delete_all(void)
 {
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
+    lv_anim_t * a;
+    _LV_LL_READ(anim_ll_p, a) {
+        LV_MP_RELEASE(a);
+    }
+#endif
     _lv_ll_clear(anim_ll_p);
     anim_mark_list_change();
 }
@@ -444,6 +451,7 @@ static void anim_completed_handler(lv_anim_t * a)
         /*Call the callback function at the end*/
         if(a->completed_cb != NULL) a->completed_cb(a);
         if(a->deleted_cb != NULL) a->deleted_cb(a);
+        LV_MP_RELEASE(a);
         lv_free(a);
     }
     /*If the animation is not deleted then restart it*/
@@ -538,6 +546,7 @@ static bool remove_concurrent_anims(lv_anim_t * a_current)
             /*|| (a->custom_exec_cb && a->custom_exec_cb == a_current->custom_exec_cb)*/)) {
             _lv_ll_remove(anim_ll_p, a);
             if(a->deleted_cb != NULL) a->deleted_cb(a);
+            LV_MP_RELEASE(a);
             lv_free(a);
             /*Read by `anim_timer`. It need to know if a delete occurred in the linked list*/
             anim_mark_list_change();
@@ -57,6 +57,7 @@ uint8_t lv_color_format_get_bpp(lv_color_format_t cf)
         case LV_COLOR_FORMAT_A8:
         case LV_COLOR_FORMAT_I8:
         case LV_COLOR_FORMAT_RGB332:
+        case LV_COLOR_FORMAT_RGB332A8:
             return 8;
 
         case LV_COLOR_FORMAT_RGB565A8:
@@ -88,6 +89,7 @@ bool lv_color_format_has_alpha(lv_color_format_t cf)
         case LV_COLOR_FORMAT_I4:
         case LV_COLOR_FORMAT_I8:
         case LV_COLOR_FORMAT_RGB565A8:
+        case LV_COLOR_FORMAT_RGB332A8:
         case LV_COLOR_FORMAT_ARGB8888:
             return true;
         default:
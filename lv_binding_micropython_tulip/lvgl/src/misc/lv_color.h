@@ -72,6 +72,7 @@ typedef uint8_t lv_opa_t;
                                             (cf) == LV_COLOR_FORMAT_L8 ? 8 :        \
                                             (cf) == LV_COLOR_FORMAT_A8 ? 8 :        \
                                             (cf) == LV_COLOR_FORMAT_RGB332 ? 8 :    \
+                                            (cf) == LV_COLOR_FORMAT_RGB332A8 ? 8 :  \
                                             (cf) == LV_COLOR_FORMAT_I8 ? 8 :        \
                                             (cf) == LV_COLOR_FORMAT_RGB565 ? 16 :   \
                                             (cf) == LV_COLOR_FORMAT_RGB565A8 ? 16 : \
@@ -125,6 +126,7 @@ enum _lv_color_format_t {
     LV_COLOR_FORMAT_I8                = 0x0A,
     LV_COLOR_FORMAT_A8                = 0x0E,
     LV_COLOR_FORMAT_RGB332            = 0x15,
+    LV_COLOR_FORMAT_RGB332A8          = 0x16,   /**< RGB332 array followed by Alpha array, like RGB565A8*/
 
     /*2 byte (+alpha) formats*/
     LV_COLOR_FORMAT_RGB565            = 0x12,
@@ -192,6 +192,7 @@ void lv_style_reset(lv_style_t * style)
     LV_ASSERT_STYLE(style);
 
     if(style->prop_cnt != 255) lv_free(style->values_and_props);
+    LV_MP_RELEASE(style);
     lv_memzero(style, sizeof(lv_style_t));
 #if LV_USE_ASSERT_STYLE
     style->sentinel = LV_STYLE_SENTINEL_VALUE;
@@ -192,6 +192,7 @@ void lv_timer_delete(lv_timer_t * timer)
     _lv_ll_remove(timer_ll_p, timer);
     state.timer_deleted = true;
 
+    LV_MP_RELEASE(timer);
     lv_free(timer);
 }
 
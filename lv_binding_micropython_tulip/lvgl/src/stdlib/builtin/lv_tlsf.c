@@ -1,5 +1,5 @@
 #include "../../lv_conf_internal.h"
-#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN || LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
 
 #include "lv_tlsf.h"
 #include "../../stdlib/lv_string.h"
@@ -10,7 +10,12 @@
 #undef  printf
 #define printf LV_LOG_ERROR
 
-#define TLSF_MAX_POOL_SIZE (LV_MEM_SIZE + LV_MEM_POOL_EXPAND_SIZE)
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+    #define TLSF_MAX_POOL_SIZE (LV_MEM_SIZE + LV_MEM_POOL_EXPAND_SIZE)
+#else
+    /*The MicroPython arena adds a pool bigger than LV_MEM_ARENA_EXPAND_SIZE for one big allocation*/
+    #define TLSF_MAX_POOL_SIZE (32 * 1024 * 1024U)
+#endif
 
 #if !defined(_DEBUG)
     #define _DEBUG 0
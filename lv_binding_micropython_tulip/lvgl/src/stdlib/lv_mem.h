@@ -130,10 +130,39 @@ lv_result_t lv_mem_test(void);
  */
 void lv_mem_monitor(lv_mem_monitor_t * mon_p);
 
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
+/**
+ * Tell if p is in LVGL's arena, outside the MicroPython heap
+ * @param p         any pointer
+ * @return          true if LVGL allocated the memory p points into
+ */
+bool lv_mem_arena_has(const void * p);
+
+/**
+ * Give the number of pools the arena has grown to and how many allocations failed
+ * @param pools_p   the number of pools is stored here
+ * @param failed_p  the number of failed allocations is stored here
+ */
+void lv_mem_arena_info(uint32_t * pools_p, uint32_t * failed_p);
+
+/**
+ * Tell the MicroPython binding LVGL is done with an object, style, animation, timer or display,
+ * so the python objects the binding kept alive for it can go. The binding provides it
+ * @param p         what LVGL freed or reset
+ */
+void lv_mp_release(const void * p);
+#endif
+
 /**********************
  *      MACROS
  **********************/
 
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
+#define LV_MP_RELEASE(p) lv_mp_release(p)
+#else
+#define LV_MP_RELEASE(p)
+#endif
+
 #ifdef __cplusplus
 } /*extern "C"*/
 #endif
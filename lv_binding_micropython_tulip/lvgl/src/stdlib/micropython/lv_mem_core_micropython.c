@@ -9,22 +9,54 @@
 #if LV_USE_STDLIB_MALLOC == LV_STDLIB_MICROPYTHON
 #include "../../stdlib/lv_mem.h"
 #include "include/lv_mp_mem_custom_include.h"
+#include "../../core/lv_global.h"
+#include "../builtin/lv_tlsf.h"
+#ifdef ESP_PLATFORM
+    #include "esp_heap_caps.h"
+#else
+    #include <sys/mman.h>
+#endif
 
 /*********************
  *      DEFINES
  *********************/
+/* LVGL doesn't use the MicroPython heap at all. Everything, from the MicroPython thread or the draw
+ * threads, comes out of a TLSF arena of SPIRAM (mmap on desktop) that grows a pool at a time.
+ * The GC never scans it: the binding roots the few python objects LVGL points at (see mp_lv_keep).*/
+#define state LV_GLOBAL_DEFAULT()->tlsf_state
+
+#if LV_USE_OS
+    #define ARENA_LOCK() lv_mutex_lock(&state.mutex)
+    #define ARENA_UNLOCK() lv_mutex_unlock(&state.mutex)
+#else
+    #define ARENA_LOCK()
+    #define ARENA_UNLOCK()
+#endif
 
 /**********************
  *      TYPEDEFS
  **********************/
+typedef struct {
+    void * mem;
+    size_t bytes;
+    lv_pool_t pool;
+} arena_pool_t;
 
 /**********************
  *  STATIC PROTOTYPES
  **********************/
+static void * pool_get(size_t bytes);
+static void pool_put(void * mem, size_t bytes);
+static bool arena_grow(size_t size);
+static void * arena_malloc(size_t size);
+static void arena_walker(void * ptr, size_t size, int used, void * user);
 
 /**********************
  *  STATIC VARIABLES
  **********************/
+static arena_pool_t pools[LV_MEM_ARENA_MAX_POOLS];
+static uint8_t pool_count;
+static size_t failed;
 
 /**********************
  *      MACROS
@@ -36,18 +68,33 @@
 
 void lv_mem_init(void)
 {
-    return; /*Nothing to init*/
+#if LV_USE_OS
+    lv_mutex_init(&state.mutex);
+#endif
+    pool_count = 0;
+    failed = 0;
+    state.cur_used = 0;
+    state.max_used = 0;
+    void * mem = pool_get(LV_MEM_ARENA_SIZE);
+    LV_ASSERT_MALLOC(mem);
+    state.tlsf = lv_tlsf_create_with_pool(mem, LV_MEM_ARENA_SIZE);
+    pools[pool_count++] = (arena_pool_t){mem, LV_MEM_ARENA_SIZE, lv_tlsf_get_pool(state.tlsf)};
 }
 
 void lv_mem_deinit(void)
 {
-    return; /*Nothing to deinit*/
-
+    lv_tlsf_destroy(state.tlsf);
+    state.tlsf = NULL;
+    for(uint8_t i = 0; i < pool_count; i++) pool_put(pools[i].mem, pools[i].bytes);
+    pool_count = 0;
+#if LV_USE_OS
+    lv_mutex_delete(&state.mutex);
+#endif
 }
 
 lv_mem_pool_t lv_mem_add_pool(void * mem, size_t bytes)
 {
-    /*Not supported*/
+    /*Not supported, the arena adds its own pools*/
     LV_UNUSED(mem);
     LV_UNUSED(bytes);
     return NULL;
@@ -62,34 +109,165 @@ void lv_mem_remove_pool(lv_mem_pool_t pool)
 
 void * lv_malloc_core(size_t size)
 {
-    return m_malloc(size);
+    ARENA_LOCK();
+    void * p = arena_malloc(size);
+    ARENA_UNLOCK();
+    return p;
 }
 
 void * lv_realloc_core(void * p, size_t new_size)
 {
-    return m_realloc(p, new_size);
+    if(p == NULL) return lv_malloc_core(new_size);
+    ARENA_LOCK();
+    size_t old_size = lv_tlsf_block_size(p);
+    void * new_p = lv_tlsf_realloc(state.tlsf, p, new_size);
+    if(new_p) {
+        state.cur_used -= old_size;
+        state.cur_used += lv_tlsf_block_size(new_p);
+        state.max_used = LV_MAX(state.cur_used, state.max_used);
+    }
+    else if(arena_grow(new_size)) {
+        /*A new pool can't extend the old block, move it*/
+        new_p = arena_malloc(new_size);
+        if(new_p) {
+            lv_memcpy(new_p, p, old_size < new_size ? old_size : new_size);
+            state.cur_used -= old_size;
+            lv_tlsf_free(state.tlsf, p);
+        }
+    }
+    else {
+        failed++; /*arena_malloc counts it when it fails after a grow*/
+    }
+    ARENA_UNLOCK();
+    return new_p;
 }
 
 void lv_free_core(void * p)
 {
-    m_free(p);
+    if(p == NULL) return;
+    ARENA_LOCK();
+    size_t size = lv_tlsf_block_size(p);
+    lv_tlsf_free(state.tlsf, p);
+    if(state.cur_used > size) state.cur_used -= size;
+    else state.cur_used = 0;
+    ARENA_UNLOCK();
 }
 
 void lv_mem_monitor_core(lv_mem_monitor_t * mon_p)
 {
-    /*Not supported*/
-    LV_UNUSED(mon_p);
-    return;
+    lv_memzero(mon_p, sizeof(lv_mem_monitor_t));
+    ARENA_LOCK();
+    for(uint8_t i = 0; i < pool_count; i++) {
+        lv_tlsf_walk_pool(pools[i].pool, arena_walker, mon_p);
+    }
+    mon_p->max_used = state.max_used;
+    ARENA_UNLOCK();
+
+    mon_p->used_pct = 100 - (uint64_t)100U * mon_p->free_size / mon_p->total_size;
+    if(mon_p->free_size > 0) {
+        mon_p->frag_pct = (uint64_t)mon_p->free_biggest_size * 100U / mon_p->free_size;
+        mon_p->frag_pct = 100 - mon_p->frag_pct;
+    }
+    else {
+        mon_p->frag_pct = 0; /*no fragmentation if all the RAM is used*/
+    }
 }
 
 lv_result_t lv_mem_test_core(void)
 {
-    /*Not supported*/
-    return LV_RESULT_OK;
+    ARENA_LOCK();
+    int err = lv_tlsf_check(state.tlsf);
+    ARENA_UNLOCK();
+    return err ? LV_RESULT_INVALID : LV_RESULT_OK;
+}
+
+bool lv_mem_arena_has(const void * p)
+{
+    for(uint8_t i = 0; i < pool_count; i++) {
+        if((const uint8_t *)p >= (const uint8_t *)pools[i].mem && (const uint8_t *)p < (const uint8_t *)pools[i].mem + pools[i].bytes)
+            return true;
+    }
+    return false;
+}
+
+void lv_mem_arena_info(uint32_t * pools_p, uint32_t * failed_p)
+{
+    *pools_p = pool_count;
+    *failed_p = failed;
 }
 
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
+static void * pool_get(size_t bytes)
+{
+#ifdef ESP_PLATFORM
+    return heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+#else
+    void * mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return mem == MAP_FAILED ? NULL : mem;
+#endif
+}
+
+static void pool_put(void * mem, size_t bytes)
+{
+#ifdef ESP_PLATFORM
+    LV_UNUSED(bytes);
+    heap_caps_free(mem);
+#else
+    munmap(mem, bytes);
+#endif
+}
+
+/*Called with the arena locked*/
+static bool arena_grow(size_t size)
+{
+    if(pool_count == LV_MEM_ARENA_MAX_POOLS) return false;
+    size_t bytes = LV_MEM_ARENA_EXPAND_SIZE;
+    size_t need = size + lv_tlsf_pool_overhead() + lv_tlsf_alloc_overhead() + lv_tlsf_align_size();
+    if(need > bytes) bytes = (need + 4095) & ~(size_t)4095;
+    void * mem = pool_get(bytes);
+    if(mem == NULL) return false;
+    lv_pool_t pool = lv_tlsf_add_pool(state.tlsf, mem, bytes);
+    if(pool == NULL) {
+        pool_put(mem, bytes);
+        return false;
+    }
+    pools[pool_count++] = (arena_pool_t){mem, bytes, pool};
+    LV_LOG_INFO("LVGL arena grew to %d pools", pool_count);
+    return true;
+}
+
+/*Called with the arena locked*/
+static void * arena_malloc(size_t size)
+{
+    void * p = lv_tlsf_malloc(state.tlsf, size);
+    if(p == NULL && arena_grow(size)) p = lv_tlsf_malloc(state.tlsf, size);
+    if(p == NULL) {
+        failed++;
+        return NULL;
+    }
+    state.cur_used += lv_tlsf_block_size(p);
+    state.max_used = LV_MAX(state.cur_used, state.max_used);
+    return p;
+}
+
+static void arena_walker(void * ptr, size_t size, int used, void * user)
+{
+    LV_UNUSED(ptr);
+
+    lv_mem_monitor_t * mon_p = user;
+    mon_p->total_size += size;
+    if(used) {
+        mon_p->used_cnt++;
+    }
+    else {
+        mon_p->free_cnt++;
+        mon_p->free_size += size;
+        if(size > mon_p->free_biggest_size)
+            mon_p->free_biggest_size = size;
+    }
+}
+
 #endif /*LV_STDLIB_MICROPYTHON*/
@@ -130,6 +130,18 @@ list(APPEND MICROPY_SOURCE_EXTMOD
     ${TULIP_SHARED_DIR}/smallfont.c
     ${TULIP_SHARED_DIR}/display.c
     ${TULIP_SHARED_DIR}/bresenham.c
+    ${TULIP_SHARED_DIR}/displaylist.c
+    ${TULIP_SHARED_DIR}/perf.c
+    ${TULIP_SHARED_DIR}/bench.c
+    ${TULIP_SHARED_DIR}/capture.c
+    ${TULIP_SHARED_DIR}/events.c
+    ${TULIP_SHARED_DIR}/vector.c
+    ${TULIP_SHARED_DIR}/copper.c
+    ${TULIP_SHARED_DIR}/tilemap.c
+    ${TULIP_SHARED_DIR}/motion.c
+    ${TULIP_SHARED_DIR}/collide.c
+    ${TULIP_SHARED_DIR}/gesture.c
+    ${TULIP_SHARED_DIR}/surface.c
     ${TULIP_SHARED_DIR}/tulip_helpers.c
     ${TULIP_SHARED_DIR}/editor.c
     ${TULIP_SHARED_DIR}/keyscan.c
@@ -141,6 +153,8 @@ list(APPEND MICROPY_SOURCE_EXTMOD
     ${TULIP_SHARED_DIR}/sequencer.c
     ${TULIP_SHARED_DIR}/lodepng.c
     ${TULIP_SHARED_DIR}/lvgl_u8g2.c
+    ${TULIP_SHARED_DIR}/lvgl_png.c
+    ${TULIP_SHARED_DIR}/lvgl_render.c
     ${TULIP_SHARED_DIR}/u8fontdata.c
     ${TULIP_SHARED_DIR}/u8g2_fonts.c
     ${TULIP_SHARED_DIR}/memorypcm.c
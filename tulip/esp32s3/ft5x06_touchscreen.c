@@ -18,6 +18,7 @@
 #include "esp_log.h"
 #include "string.h"
 #include "display.h"
+#include "gesture.h"
 #include "soc/io_mux_reg.h"
 #include "ui.h"
 #include "pins.h"
@@ -262,6 +263,7 @@ void run_ft5x06(void *param)
                     if(i==0) got_primary_touch = 1;
                     //if(i==0) fprintf(stderr,"held %d evt %d touch i %d touch point %d  x:%d  y:%d became %d %d\n", touch_held, touch_info.touch_event, i, touch_info.touch_point, touch_info.curx[i], touch_info.cury[i], last_touch_x[i], last_touch_y[i]);
                 }
+                touch_points = touch_info.touch_point;
                 if(got_primary_touch) {
                     send_touch_to_micropython(last_touch_x[0], last_touch_y[0], 0); 
                 } else {
@@ -276,6 +278,7 @@ void run_ft5x06(void *param)
                 press_received = 0;                 
             }
         }
+        gesture_poll();
         vTaskDelay(20/portTICK_PERIOD_MS);
     }
     vTaskDelete(NULL);
@@ -34,6 +34,7 @@
 #include "py/gc.h"
 #include "py/mpthread.h"
 #include "gccollect.h"
+#include "perf.h"
 
 #if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2 || CONFIG_IDF_TARGET_ESP32S3
 
@@ -61,9 +62,11 @@ static void gc_collect_inner(int level) {
 }
 
 void gc_collect(void) {
+    int64_t tic = get_time_us();
     gc_collect_start();
     gc_collect_inner(0);
     gc_collect_end();
+    perf_record(PERF_GC, (uint32_t)tic, (uint32_t)(get_time_us() - tic));
 }
 
 #elif CONFIG_IDF_TARGET_ESP32C3
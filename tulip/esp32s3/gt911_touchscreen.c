@@ -1,5 +1,6 @@
 
 #include "display.h"
+#include "gesture.h"
 #include "gt911_touchscreen.h"
 #include "pins.h"
 #ifndef TDECK
@@ -92,6 +93,7 @@ void run_gt911(void *param) {
                 #endif
             }
             //fprintf(stderr, "touch DOWN %d %d\n", last_touch_x[0], last_touch_y[0]);
+            touch_points = touch_cnt;
             send_touch_to_micropython(last_touch_x[0], last_touch_y[0], 0);
             gt911_held = 1;
         } else {
@@ -101,6 +103,7 @@ void run_gt911(void *param) {
                 gt911_held = 0;
             }
         }
+        gesture_poll();
         vTaskDelay(20/portTICK_PERIOD_MS);
     }
 }
@@ -52,6 +52,8 @@
 #include "uart.h"
 #include "usb.h"
 #include "sequencer.h"
+#include "events.h"
+#include "surface.h"
 #include "usb_serial_jtag.h"
 #include "modmachine.h"
 #include "modnetwork.h"
@@ -114,6 +116,7 @@ TaskHandle_t alles_parse_handle;
 TaskHandle_t alles_receive_handle;
 TaskHandle_t amy_render_handle;
 TaskHandle_t alles_fill_buffer_handle;
+TaskHandle_t capture_handle;
 TaskHandle_t idle_0_handle;
 TaskHandle_t idle_1_handle;
 TaskHandle_t sequencer_handle;
@@ -149,11 +152,11 @@ float compute_cpu_usage(uint8_t debug) {
     const char* const tasks[] = {
          "IDLE0", "IDLE1", "Tmr Svc", "ipc0", "ipc1", "main", "wifi", "esp_timer", "sys_evt", "tiT",
          DISPLAY_TASK_NAME, USB_TASK_NAME, TOUCHSCREEN_TASK_NAME, TULIP_MP_TASK_NAME, MIDI_TASK_NAME, ALLES_TASK_NAME,
-         ALLES_PARSE_TASK_NAME, ALLES_RECEIVE_TASK_NAME, ALLES_RENDER_TASK_NAME, ALLES_FILL_BUFFER_TASK_NAME, SEQUENCER_TASK_NAME, 0
+         ALLES_PARSE_TASK_NAME, ALLES_RECEIVE_TASK_NAME, ALLES_RENDER_TASK_NAME, ALLES_FILL_BUFFER_TASK_NAME, SEQUENCER_TASK_NAME, LVGL_RENDER_TASK_NAME, 0
     };
     const uint8_t cores[] = {0, 1, 0, 0, 1, 0, 0, 0, 1, 0, DISPLAY_TASK_COREID, USB_TASK_COREID, TOUCHSCREEN_TASK_COREID, TULIP_MP_TASK_COREID,
         MIDI_TASK_COREID, ALLES_TASK_COREID, ALLES_PARSE_TASK_COREID, ALLES_RECEIVE_TASK_COREID, ALLES_RENDER_TASK_COREID, ALLES_FILL_BUFFER_TASK_COREID, 
-        SEQUENCER_TASK_COREID};
+        SEQUENCER_TASK_COREID, LVGL_RENDER_TASK_COREID};
 
     uxArraySize = uxTaskGetNumberOfTasks();
     pxTaskStatusArray = pvPortMalloc( uxArraySize * sizeof( TaskStatus_t ) );
@@ -255,6 +258,13 @@ soft_reset:
     }
 
     MP_STATE_PORT(native_code_pointers) = MP_OBJ_NULL;
+    // LVGL outlives the heap, the binding's dicts of python objects it points to don't
+    MP_STATE_VM(mp_lv_handles) = MP_OBJ_NULL;
+    MP_STATE_VM(mp_lv_kept) = MP_OBJ_NULL;
+    events_clear();
+    // bg_target pointed into the old heap
+    surface_set_target(NULL, 0, 0);
+    MP_STATE_PORT(tulip_bg_target) = MP_OBJ_NULL;
 
     // initialise peripherals
     machine_pins_init();
@@ -25,6 +25,8 @@
 #define ALLES_RECEIVE_TASK_PRIORITY (ESP_TASK_PRIO_MIN + 3)
 #define ALLES_RENDER_TASK_PRIORITY (ESP_TASK_PRIO_MAX )
 #define ALLES_FILL_BUFFER_TASK_PRIORITY (ESP_TASK_PRIO_MAX )
+#define CAPTURE_TASK_PRIORITY (ESP_TASK_PRIO_MIN)
+#define LVGL_RENDER_TASK_PRIORITY (ESP_TASK_PRIO_MIN + 1)
 
 // Since display is on core0, things on core0 will be slower than things on core1
 #define DISPLAY_TASK_COREID (0)
@@ -38,6 +40,8 @@
 #define ALLES_RECEIVE_TASK_COREID (1)
 #define ALLES_RENDER_TASK_COREID (0)
 #define ALLES_FILL_BUFFER_TASK_COREID (1)
+#define CAPTURE_TASK_COREID (1)
+#define LVGL_RENDER_TASK_COREID (0)
 
 #define DISPLAY_TASK_STACK_SIZE    (4 * 1024) 
 #define USB_TASK_STACK_SIZE    (4 * 1024) 
@@ -50,6 +54,8 @@
 #define ALLES_RECEIVE_TASK_STACK_SIZE (4 * 1024)
 #define ALLES_RENDER_TASK_STACK_SIZE (8 * 1024)
 #define ALLES_FILL_BUFFER_TASK_STACK_SIZE (8 * 1024)
+#define CAPTURE_TASK_STACK_SIZE (8 * 1024)
+#define LVGL_RENDER_TASK_STACK_SIZE (16 * 1024)
 
 #define MP_TASK_HEAP_SIZE (2 * 1024 * 1024)
 
@@ -64,8 +70,10 @@
 #define ALLES_RECEIVE_TASK_NAME     "alles_rec_task"
 #define ALLES_RENDER_TASK_NAME      "alles_r_task"
 #define ALLES_FILL_BUFFER_TASK_NAME "alles_fb_task"
+#define CAPTURE_TASK_NAME           "capture_task"
+#define LVGL_RENDER_TASK_NAME       "lvgl_r_task"
 
-#define MAX_TASKS 21 // includes system tasks
+#define MAX_TASKS 22 // includes system tasks
 
 extern TaskHandle_t display_handle;
 extern TaskHandle_t usb_handle;
@@ -78,6 +86,8 @@ extern TaskHandle_t alles_parse_handle;
 extern TaskHandle_t alles_receive_handle;
 extern TaskHandle_t amy_render_handle;
 extern TaskHandle_t alles_fill_buffer_handle;
+extern TaskHandle_t capture_handle;
+extern TaskHandle_t lvgl_render_handle;
 extern TaskHandle_t idle_0_handle;
 extern TaskHandle_t idle_1_handle;
 // For CPU usage
@@ -153,6 +153,7 @@ void run_tdeck_display(void) {
             tic0 = esp_timer_get_time();
         }        
 
+        display_frame_start();
         // bounce the entire screen at once to the display
         for(uint16_t y=0;y<V_RES;y=y+FONT_HEIGHT) {
             // Get the pixel data for a row of screen from Tulip
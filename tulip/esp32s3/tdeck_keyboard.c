@@ -26,6 +26,54 @@ struct KeyMapping {
     char alternative;
 };
 
+// The HID scan code a USB keyboard would send for c, KEY_NONE for the symbols, which need shift there
+static uint8_t tdeck_scan(uint16_t c) {
+    if(c >= 'a' && c <= 'z') return KEY_A + (c - 'a');
+    if(c >= 'A' && c <= 'Z') return KEY_A + (c - 'A');
+    if(c >= '1' && c <= '9') return KEY_1 + (c - '1');
+    switch(c) {
+        case '0': return KEY_0;
+        case ' ': return KEY_SPACE;
+        case 13: return KEY_ENTER;
+        case 8: return KEY_BACKSPACE;
+        case 9: return KEY_TAB;
+        case 27: return KEY_ESC;
+        case 127: return KEY_DELETE;
+        case 258: return KEY_DOWN;
+        case 259: return KEY_UP;
+        case 260: return KEY_LEFT;
+        case 261: return KEY_RIGHT;
+        default: return KEY_NONE;
+    }
+}
+
+// A char to LVGL, as its LV_KEY_ if it has one
+static uint32_t tdeck_lvgl_key(uint16_t c) {
+    switch(c) {
+        case 261: return LV_KEY_RIGHT;
+        case 260: return LV_KEY_LEFT;
+        case 259: return LV_KEY_UP;
+        case 258: return LV_KEY_DOWN;
+        case 27: return LV_KEY_ESC;
+        case 8: return LV_KEY_BACKSPACE;
+        case 13: return LV_KEY_ENTER;
+        case 9: return LV_KEY_NEXT;
+        default: return c;
+    }
+}
+
+// The T-Deck keyboard only tells us a char once it's typed, no scan codes and no key ups. So each char goes out
+// as a down and an up together, typed from key (before any ctrl mapping), with ctrl down around it if ctrl is on
+static void tdeck_send_key(uint16_t c, uint16_t key, bool ctrl) {
+    uint8_t scan = tdeck_scan(key);
+    if(ctrl) key_event(KEY_EVENT_DOWN, KEY_LEFTCTRL, 0);
+    key_event(KEY_EVENT_DOWN, scan, c);
+    key_event(KEY_EVENT_UP, scan, 0);
+    if(ctrl) key_event(KEY_EVENT_UP, KEY_LEFTCTRL, 0);
+    lvgl_key_put(tdeck_lvgl_key(c));
+    send_key_to_micropython(c);
+}
+
 static void IRAM_ATTR gpio_interrupt_handler(void *args)
 {
     int pinNumber = (int)args;
@@ -43,11 +91,11 @@ void watch_trackball(void *params)
     {
         if (xQueueReceive(interruptQueue, &pinNumber, portMAX_DELAY))
         {
-            if(pinNumber == TDECK_TRACKBALL_UP) send_key_to_micropython(259);
-            if(pinNumber == TDECK_TRACKBALL_DOWN) send_key_to_micropython(258);
-            if(pinNumber == TDECK_TRACKBALL_LEFT) send_key_to_micropython(260);
-            if(pinNumber == TDECK_TRACKBALL_RIGHT) send_key_to_micropython(261);
-            if(pinNumber == TDECK_TRACKBALL_CLICK) send_key_to_micropython(13);
+            if(pinNumber == TDECK_TRACKBALL_UP) tdeck_send_key(259, 259, false);
+            if(pinNumber == TDECK_TRACKBALL_DOWN) tdeck_send_key(258, 258, false);
+            if(pinNumber == TDECK_TRACKBALL_LEFT) tdeck_send_key(260, 260, false);
+            if(pinNumber == TDECK_TRACKBALL_RIGHT) tdeck_send_key(261, 261, false);
+            if(pinNumber == TDECK_TRACKBALL_CLICK) tdeck_send_key(13, 13, false);
             //fprintf(stderr,"GPIO %d was pressed. The state is %d\n", pinNumber, gpio_get_level(pinNumber));
         }
     }
@@ -63,34 +111,6 @@ char get_alternative_char(struct KeyMapping mappings[], int size, char original)
     return original;
 }
 
-#define KEYBOARD_BUFFER_SIZE 32
-
-static char lvgl_kb_buf[KEYBOARD_BUFFER_SIZE];
-
-
-void lvgl_keyboard_read(lv_indev_t * indev_drv, lv_indev_data_t * data) {
-    (void) indev_drv;     // unused
-
-    static bool dummy_read = false;
-    const size_t len = strlen(lvgl_kb_buf);
-
-    // Send a release manually
-    if (dummy_read) {
-        dummy_read = false;
-        data->state = LV_INDEV_STATE_RELEASED;
-        data->continue_reading = len > 0;
-    }
-        // Send the pressed character 
-    else if (len > 0) {
-        dummy_read = true;
-        data->state = LV_INDEV_STATE_PRESSED;
-        data->key = lvgl_kb_buf[0];
-        memmove(lvgl_kb_buf, lvgl_kb_buf + 1, len);
-        data->continue_reading = true;
-    }
-}
-
-
 void run_tdeck_keyboard() {
 
     bool alt_char_mode = false;
@@ -217,10 +237,10 @@ void run_tdeck_keyboard() {
                 }
                 // Send as is, combining with ctrl if toggled
                 if (ctrl_toggle) {
-                    send_key_to_micropython(get_alternative_char(ctrlMappings, ctrlMappingsSize, char_to_send[0]));
+                    tdeck_send_key(get_alternative_char(ctrlMappings, ctrlMappingsSize, char_to_send[0]), char_to_send[0], true);
                     ctrl_toggle = false;  // Reset toggle after sending
                 } else {
-                    send_key_to_micropython(char_to_send[0]);
+                    tdeck_send_key(char_to_send[0], char_to_send[0], false);
                 }
             }
         }
@@ -1,8 +1,6 @@
 // usb_keyboard.c
 #include "usb_keyboard.h"
 
-#define KEYBOARD_BUFFER_SIZE 32
-
 uint16_t keyboard_bytes = KEYBOARD_BYTES;
 
 typedef union {
@@ -120,7 +118,6 @@ bool isKeyboardReady = false;
 uint8_t KeyboardInterval;
 bool isKeyboardPolling = false;
 int64_t KeyboardTimer=0;
-int64_t KeyRepeatTimer=0;
 
 
 
@@ -360,12 +357,6 @@ void usbh_task(void)
   }
 }
 
-// Keep track of which keys / scan codes are being held
-uint16_t current_held = 0;
-int64_t current_held_ms = 0;
-int64_t last_inter_trigger_ms = 0;
-
-
 
 uint32_t keycode_to_ctrl_key(uint16_t key)
 {
@@ -410,83 +401,56 @@ uint32_t keycode_to_ctrl_key(uint16_t key)
 }
 
 
-static char lvgl_kb_buf[KEYBOARD_BUFFER_SIZE];
-
-
-void lvgl_keyboard_read(lv_indev_t * indev_drv, lv_indev_data_t * data) {
-    (void) indev_drv;     // unused
-
-    static bool dummy_read = false;
-    const size_t len = strlen(lvgl_kb_buf);
-
-    // Send a release manually
-    if (dummy_read) {
-        dummy_read = false;
-        data->state = LV_INDEV_STATE_RELEASED;
-        data->continue_reading = len > 0;
-    }
-        // Send the pressed character 
-    else if (len > 0) {
-        dummy_read = true;
-        data->state = LV_INDEV_STATE_PRESSED;
-        data->key = lvgl_kb_buf[0];
-        memmove(lvgl_kb_buf, lvgl_kb_buf + 1, len);
-        data->continue_reading = true;
-    }
+// A char to LVGL, as its LV_KEY_ if it has one
+static void lvgl_send_key(uint16_t c) {
+    uint32_t ctrl_key = keycode_to_ctrl_key(c);
+    lvgl_key_put(ctrl_key != '\0' ? ctrl_key : c);
 }
 
 
-
 void decode_report(uint8_t *p) {
     // First byte, modifier mask
     uint8_t modifier = p[0];
-    uint8_t new_key = 0;
-    uint8_t key_held_this_session = 0;
     // Second byte, reserved
     // next 6 bytes, scan codes (for rollover)
     //fprintf(stderr,"decode report %d %d %d %d %d %d\n", p[2],p[3],p[4],p[5],p[6],p[7]);
+    // Too many keys down, every slot is KEY_ERR_OVF. Wait for a real report
+    if(p[2] == KEY_ERR_OVF) return;
+
+    // Modifiers come as bits, not scan codes. Send them as their keys going down and up
+    for(uint8_t i=0;i<8;i++) {
+        uint8_t bit = 1 << i;
+        if((modifier & bit) != (last_scan[0] & bit)) {
+            key_event((modifier & bit) ? KEY_EVENT_DOWN : KEY_EVENT_UP, KEY_LEFTCTRL + i, 0);
+        }
+    }
+    // Keys that were in the last report and aren't now came up
+    for(uint8_t j=2;j<8;j++) {
+        if(last_scan[j] == 0) continue;
+        uint8_t still = 0;
+        for(uint8_t i=2;i<8;i++) {
+            if(p[i] == last_scan[j]) still = 1;
+        }
+        if(!still) key_event(KEY_EVENT_UP, last_scan[j], 0);
+    }
     for(uint8_t i=2;i<8;i++) {
         if(p[i]!=0) {
-            key_held_this_session = 1;
             uint8_t skip = 0;
             for(uint8_t j=2;j<8;j++) {
         		if(last_scan[j] == p[i]) skip = 1;
   			}
 	  		if(!skip) { // only process new keys
 		        uint16_t c = scan_ascii(p[i], modifier);
+                // keyscan repeats it while it's down
+                key_event(KEY_EVENT_DOWN, p[i], c);
 		        if(c) {
-                    
-                    if(keycode_to_ctrl_key(c) != '\0') {
-                        const size_t len = strlen(lvgl_kb_buf);
-                        if (len < KEYBOARD_BUFFER_SIZE - 1) {
-                            lvgl_kb_buf[len] = keycode_to_ctrl_key(c);
-                            lvgl_kb_buf[len + 1] = '\0';
-                        }
-                    } else {
-                        // put it in lvgl_kb_buf for lvgl
-                        const size_t len = strlen(lvgl_kb_buf);
-                        if (len < KEYBOARD_BUFFER_SIZE - 1) {
-                            lvgl_kb_buf[len] = c;
-                            lvgl_kb_buf[len+1] = '\0';
-                        }
-                    }
-                    
-                    new_key = 1;
-                    current_held_ms = esp_timer_get_time()/1000;
-                    current_held = c; 
-                    //fprintf(stderr, "sending new key %d to MP at time %lld\n", c, current_held_ms);
+                    lvgl_send_key(c);
+                    //fprintf(stderr, "sending new key %d to MP\n", c);
                     send_key_to_micropython(c);
                 }
             }	
 		} 
     }
-    if(!new_key && !key_held_this_session) {
-        // we got a message but no new keys. so is a release
-        //fprintf(stderr, "turning off key\n");
-        current_held_ms = 0;
-        current_held = 0;
-        last_inter_trigger_ms = 0;
-    }
     for(uint8_t i=0;i<8;i++) last_scan[i] = p[i];
 }
 
@@ -665,16 +629,12 @@ void run_usb()
   while(1) {
       usbh_task();
       KeyboardTimer = esp_timer_get_time() / 1000;
-      KeyRepeatTimer = esp_timer_get_time() / 1000;
 
       // Handle key repeat
-      if(current_held > 0) {
-        if(KeyRepeatTimer - current_held_ms > KEY_REPEAT_TRIGGER_MS) {
-            if(KeyRepeatTimer - last_inter_trigger_ms > KEY_REPEAT_INTER_MS) {
-                send_key_to_micropython(current_held);
-                last_inter_trigger_ms = KeyRepeatTimer;
-            }
-        }
+      uint16_t repeat = key_repeat_poll();
+      if(repeat) {
+        lvgl_send_key(repeat);
+        send_key_to_micropython(repeat);
       }
       if (isKeyboardReady && !isKeyboardPolling && (KeyboardTimer > KeyboardInterval)) {
         KeyboardIn->num_bytes = keyboard_bytes; 
@@ -21,11 +21,6 @@
 #define KEYBOARD_BYTES 8
 extern uint16_t keyboard_bytes;
 
-// How long you hold down a key before it starts repeating
-#define KEY_REPEAT_TRIGGER_MS 500
-// How often (in ms) to repeat a key once held
-#define KEY_REPEAT_INTER_MS 90
-
 void usbh_setup();
 void run_usb();
 
@@ -1,12 +1,18 @@
 #!/bin/bash
 # build.sh
 # Just builds locally
+# ./build.sh 1280x720 builds for another screen size as dev/tulip-1280x720, run it with ./dev/tulip -r 1280x720
 set -e
 
 source ../shared/grab_submodules.sh
-make DEBUG=1
 mkdir -p dev
-cp build-standard/tulip/obj/tulip dev/
+if [ -n "$1" ]; then
+    make DEBUG=1 TULIP_RES=$1
+    cp build-standard-$1/tulip/obj/tulip dev/tulip-$1
+else
+    make DEBUG=1
+    cp build-standard/tulip/obj/tulip dev/
+fi
 
 mkdir -p ~/Documents/tulipcc
 mkdir -p ~/Documents/tulipcc/user
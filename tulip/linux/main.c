@@ -59,6 +59,7 @@
 #include "alles.h"
 #include "midi.h"
 #include "sequencer.h"
+#include "events.h"
 
 
 // Command line options, with their defaults
@@ -493,6 +494,19 @@ STATIC void sys_set_excecutable(char *argv0) {
 extern int16_t amy_device_id;
 extern void setup_lvgl();
 
+// Headless mode, see shared/desktop/headless_display.c
+extern uint8_t headless;
+extern uint8_t headless_step;
+extern float headless_fps;
+extern char * headless_wav_fn;
+extern void headless_display_init();
+extern int headless_display_draw();
+extern void headless_audio_close();
+
+// -x: run this file after boot.py instead of the REPL. Headless tulip quits when it's done
+char * tulip_run_script = NULL;
+volatile uint8_t tulip_mp_done = 0;
+
 
 /*
 MP_NOINLINE int main_(int argc, char **argv);
@@ -576,6 +590,8 @@ MP_NOINLINE void * main_(void *vargs) {  //int argc, char **argv) {
 
 
     mp_init();
+    // Nothing queued can outlive the heap its callbacks are on
+    events_clear();
 
 
 
@@ -781,6 +797,10 @@ MP_NOINLINE void * main_(void *vargs) {  //int argc, char **argv) {
     inspect = true;
     pyexec_frozen_module("_boot.py", false);
     pyexec_file_if_exists("boot.py");
+    if (tulip_run_script != NULL) {
+        pyexec_file(tulip_run_script);
+        goto soft_reset_exit;
+    }
     if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
         int ret = pyexec_file_if_exists("main.py");
         if (ret & PYEXEC_FORCED_EXIT) {
@@ -826,6 +846,9 @@ soft_reset_exit:
     mp_thread_deinit();
     #endif
 
+    // The display, audio and MIDI threads are still running, don't let them dispatch into a heap that's going
+    events_clear();
+
     #if defined(MICROPY_UNIX_COVERAGE)
     gc_sweep_all();
     #endif
@@ -846,16 +869,37 @@ soft_reset_exit:
 
     // printf("total bytes = %d\n", m_get_total_bytes_allocated());
     //return ret & 0xff;
+    tulip_mp_done = 1;
     return 0;
 }
 
+// -r WxH: run the Tulip Desktop built for that screen size instead (make TULIP_RES=WxH, see build.sh), which
+// sits next to this one as tulip-WxH. Screen size is compiled in, so each size is its own binary
+static void exec_resolution(char **argv, const char *res) {
+    char ours[16];
+    snprintf(ours, sizeof(ours), "%dx%d", H_RES, V_RES);
+    if(strcmp(res, ours) == 0) return;
+    char path[PATH_MAX];
+    const char *self = argv[0];
+    // tulip-1280x720 -r 800x480 should find tulip-800x480, not tulip-1280x720-800x480
+    const char *dash = strrchr(self, '-');
+    int w, h;
+    char more;
+    int len = (dash != NULL && sscanf(dash + 1, "%dx%d%c", &w, &h, &more) == 2) ? (int)(dash - self) : (int)strlen(self);
+    snprintf(path, sizeof(path), "%.*s-%s", len, self, res);
+    argv[0] = path;
+    execvp(path, argv);
+    fprintf(stderr, "no Tulip built for %s (%s): %s\n", res, path, strerror(errno));
+    exit(1);
+}
+
 int main(int argc, char **argv) {
     // Get the resources folder loc
     // So thread out alles and then micropython tasks
 
     // Display has to run on main thread on macos
     int opt;
-    while((opt = getopt(argc, argv, ":d:c:lh")) != -1) 
+    while((opt = getopt(argc, argv, ":d:c:lhHSF:w:x:r:")) != -1) 
     { 
         switch(opt) 
         { 
@@ -866,10 +910,34 @@ int main(int argc, char **argv) {
                 amy_print_devices();
                 exit(0);
                 break;
+            case 'H':
+                headless = 1;
+                break;
+            case 'S':
+                headless_step = 1;
+                break;
+            case 'F':
+                headless_fps = atof(optarg);
+                break;
+            case 'w':
+                headless_wav_fn = optarg;
+                break;
+            case 'x':
+                tulip_run_script = optarg;
+                break;
+            case 'r':
+                exec_resolution(argv, optarg);
+                break;
             case 'h':
                 fprintf(stderr,"usage: tulip\n");
                 fprintf(stderr,"\t[-d sound device id, use -l to list, default, autodetect]\n");
                 fprintf(stderr,"\t[-l list all sound devices and exit]\n");
+                fprintf(stderr,"\t[-x run this python file after boot instead of the REPL]\n");
+                fprintf(stderr,"\t[-r WxH: run the Tulip built for this screen size, default %dx%d]\n", H_RES, V_RES);
+                fprintf(stderr,"\t[-H headless: no window or sound device]\n");
+                fprintf(stderr,"\t[-F headless frames per second, 0 for as fast as possible, default %d]\n", (int)TARGET_DESKTOP_FPS);
+                fprintf(stderr,"\t[-S headless: only advance frames from tulip.frame_step()]\n");
+                fprintf(stderr,"\t[-w headless: write audio to this WAV file]\n");
                 fprintf(stderr,"\t[-h show this help and exit]\n");
                 exit(0);
                 break;
@@ -883,12 +951,18 @@ int main(int argc, char **argv) {
                 break; 
         } 
     }
-    unix_display_init();
+    if(headless) {
+        headless_display_init();
+    } else {
+        unix_display_init();
+    }
     pthread_t alles_thread_id;
     pthread_create(&alles_thread_id, NULL, alles_start, NULL);
 
-    //pthread_t midi_thread_id;
-    ///pthread_create(&midi_thread_id, NULL, run_midi, NULL);
+#ifdef ALSA_MIDI
+    pthread_t midi_thread_id;
+    pthread_create(&midi_thread_id, NULL, run_midi, NULL);
+#endif
 
     pthread_t mp_thread_id;
     pthread_create(&mp_thread_id, NULL, main_, NULL);
@@ -902,6 +976,22 @@ int main(int argc, char **argv) {
     // Schedule a "turning on" sound
     bleep();
 
+    if(headless) {
+        while(!tulip_mp_done) {
+            if(headless_step) {
+                // frames are drawn by tulip.frame_step() on the python thread
+                usleep(10000);
+                continue;
+            }
+            c = headless_display_draw();
+            if(headless_fps > 0) {
+                int sleep_ms_for_frame = (int) ((1000.0/headless_fps) - c);
+                if(sleep_ms_for_frame > 0) usleep(1000*sleep_ms_for_frame);
+            }
+        }
+        headless_audio_close();
+        return 0;
+    }
 
 display_jump: 
     while(c>=0) {
@@ -59,6 +59,7 @@
 #include "alles.h"
 #include "midi.h"
 #include "sequencer.h"
+#include "events.h"
 
 // Command line options, with their defaults
 STATIC bool compile_only = false;
@@ -490,6 +491,19 @@ STATIC void sys_set_excecutable(char *argv0) {
 #define PATHLIST_SEP_CHAR ':'
 #endif
 
+// Headless mode, see shared/desktop/headless_display.c
+extern uint8_t headless;
+extern uint8_t headless_step;
+extern float headless_fps;
+extern char * headless_wav_fn;
+extern void headless_display_init();
+extern int headless_display_draw();
+extern void headless_audio_close();
+
+// -x: run this file after boot.py instead of the REPL. Headless tulip quits when it's done
+char * tulip_run_script = NULL;
+volatile uint8_t tulip_mp_done = 0;
+
 
 #include <CoreFoundation/CFURL.h>
 #include <CoreFoundation/CFURLAccess.h>
@@ -612,6 +626,8 @@ MP_NOINLINE void * main_(void *vargs) {  //int argc, char **argv) {
 
 
     mp_init();
+    // Nothing queued can outlive the heap its callbacks are on
+    events_clear();
 
 
 
@@ -817,6 +833,10 @@ MP_NOINLINE void * main_(void *vargs) {  //int argc, char **argv) {
     inspect = true;
     pyexec_frozen_module("_boot.py", false);
     pyexec_file_if_exists("boot.py");
+    if (tulip_run_script != NULL) {
+        pyexec_file(tulip_run_script);
+        goto soft_reset_exit;
+    }
     if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
         int ret = pyexec_file_if_exists("main.py");
         if (ret & PYEXEC_FORCED_EXIT) {
@@ -862,6 +882,9 @@ soft_reset_exit:
     mp_thread_deinit();
     #endif
 
+    // The display, audio and MIDI threads are still running, don't let them dispatch into a heap that's going
+    events_clear();
+
     #if defined(MICROPY_UNIX_COVERAGE)
     gc_sweep_all();
     #endif
@@ -882,6 +905,7 @@ soft_reset_exit:
 
     // printf("total bytes = %d\n", m_get_total_bytes_allocated());
     //return ret & 0xff;
+    tulip_mp_done = 1;
     return 0;
 }
 extern int8_t unix_display_flag;
@@ -894,7 +918,7 @@ int main(int argc, char **argv) {
 
     // Display has to run on main thread on macos
     int opt;
-    while((opt = getopt(argc, argv, ":d:c:lh")) != -1) 
+    while((opt = getopt(argc, argv, ":d:c:lhHSF:w:x:")) != -1) 
     { 
         switch(opt) 
         { 
@@ -905,10 +929,30 @@ int main(int argc, char **argv) {
                 amy_print_devices();
                 exit(0);
                 break;
+            case 'H':
+                headless = 1;
+                break;
+            case 'S':
+                headless_step = 1;
+                break;
+            case 'F':
+                headless_fps = atof(optarg);
+                break;
+            case 'w':
+                headless_wav_fn = optarg;
+                break;
+            case 'x':
+                tulip_run_script = optarg;
+                break;
             case 'h':
                 fprintf(stderr,"usage: tulip\n");
                 fprintf(stderr,"\t[-d sound device id, use -l to list, default, autodetect]\n");
                 fprintf(stderr,"\t[-l list all sound devices and exit]\n");
+                fprintf(stderr,"\t[-x run this python file after boot instead of the REPL]\n");
+                fprintf(stderr,"\t[-H headless: no window or sound device]\n");
+                fprintf(stderr,"\t[-F headless frames per second, 0 for as fast as possible, default %d]\n", (int)TARGET_DESKTOP_FPS);
+                fprintf(stderr,"\t[-S headless: only advance frames from tulip.frame_step()]\n");
+                fprintf(stderr,"\t[-w headless: write audio to this WAV file]\n");
                 fprintf(stderr,"\t[-h show this help and exit]\n");
                 exit(0);
                 break;
@@ -922,7 +966,11 @@ int main(int argc, char **argv) {
                 break; 
         } 
     }
-    unix_display_init();
+    if(headless) {
+        headless_display_init();
+    } else {
+        unix_display_init();
+    }
     pthread_t alles_thread_id;
     pthread_create(&alles_thread_id, NULL, alles_start, NULL);
 
@@ -939,6 +987,22 @@ int main(int argc, char **argv) {
     delay_ms(100);
     // Schedule a "turning on" sound
 
+    if(headless) {
+        while(!tulip_mp_done) {
+            if(headless_step) {
+                // frames are drawn by tulip.frame_step() on the python thread
+                usleep(10000);
+                continue;
+            }
+            int ticks = headless_display_draw();
+            if(headless_fps > 0) {
+                int sleep_ms_for_frame = (int) ((1000.0/headless_fps) - ticks);
+                if(sleep_ms_for_frame > 0) usleep(1000*sleep_ms_for_frame);
+            }
+        }
+        headless_audio_close();
+        return 0;
+    }
 
 display_jump:
 
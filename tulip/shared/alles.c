@@ -3,6 +3,7 @@
 // brian@variogr.am
 
 #include "alles.h"
+#include "perf.h"
 
 uint8_t board_level;
 uint8_t status;
@@ -44,6 +45,72 @@ extern int32_t computed_delta ; // can be negative no prob, but usually host is
 extern uint8_t computed_delta_set ; // have we set a delta yet?
 extern int32_t last_ping_time;
 
+alles_partition_t alles_partitions[ALLES_RENDER_PARTITIONS];
+
+// Rough relative cost of rendering one osc this block. Only audible oscs are rendered by amy_render, the
+// oscs modulating them or making up an algo or partials voice are rendered along with the osc that uses them
+static uint32_t osc_cost(uint16_t osc) {
+    if(synth[osc].status != STATUS_AUDIBLE) return 0;
+    switch(synth[osc].wave) {
+        case PARTIALS: return 8;
+        case ALGO: return 6;
+        case KS: return 3;
+        case PCM:
+        case CUSTOM: return 2;
+        default: return 1;
+    }
+}
+
+// Split the oscs into ALLES_RENDER_PARTITIONS contiguous ranges of about equal cost. A fixed half each leaves a
+// core idle when all the voices are on low osc numbers. Call after amy_prepare_buffer, before the renders start
+void alles_partition_oscs() {
+    uint8_t costs[AMY_OSCS];
+    uint32_t total = 0;
+    for(uint16_t osc=0;osc<AMY_OSCS;osc++) {
+        costs[osc] = osc_cost(osc);
+        total += costs[osc];
+    }
+    uint32_t acc = 0;
+    uint8_t p = 0;
+    alles_partitions[0].start = 0;
+    alles_partitions[0].cost = 0;
+    for(uint16_t osc=0;osc<AMY_OSCS;osc++) {
+        // Start the next partition at this osc if its middle is past this partition's share
+        while(p < ALLES_RENDER_PARTITIONS-1 && (2*acc + costs[osc]) * ALLES_RENDER_PARTITIONS > 2 * total * (p+1)) {
+            alles_partitions[p].end = osc;
+            p++;
+            alles_partitions[p].start = osc;
+            alles_partitions[p].cost = 0;
+        }
+        acc += costs[osc];
+        alles_partitions[p].cost += costs[osc];
+    }
+    alles_partitions[p].end = AMY_OSCS;
+    // Nothing left for these, they still render so their core's buffer is cleared
+    for(uint8_t q=p+1;q<ALLES_RENDER_PARTITIONS;q++) {
+        alles_partitions[q].start = AMY_OSCS;
+        alles_partitions[q].end = AMY_OSCS;
+        alles_partitions[q].cost = 0;
+    }
+}
+
+// Render partition p into AMY's buffer for core p
+void alles_render_partition(uint8_t p) {
+    alles_partition_t *part = &alles_partitions[p];
+    int64_t tic = get_time_us();
+    amy_render(part->start, part->end, p);
+    part->last_us = (uint32_t)(get_time_us() - tic);
+    if(part->last_us > part->max_us) part->max_us = part->last_us;
+    part->blocks++;
+}
+
+void alles_partition_reset_stats() {
+    for(uint8_t p=0;p<ALLES_RENDER_PARTITIONS;p++) {
+        alles_partitions[p].max_us = 0;
+        alles_partitions[p].blocks = 0;
+    }
+}
+
 amy_err_t sync_init() {
     client_id = -1; // for now
     for(uint8_t i=0;i<255;i++) { clocks[i] = 0; ping_times[i] = 0; }
@@ -60,11 +127,15 @@ i2s_chan_handle_t tx_handle;
 
 extern void mcast_listen_task(void *pvParameters);
 
+#if ALLES_RENDER_WORKERS != 2
+#error "Tulip CC renders AMY on its two cores, one worker each"
+#endif
+
 // Render the second core
 void esp_render_task( void * pvParameters) {
     while(1) {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-        amy_render(0, AMY_OSCS/2, 1);
+        alles_render_partition(1);
         xTaskNotifyGive(alles_fill_buffer_handle);
     }
 }
@@ -73,19 +144,22 @@ void esp_render_task( void * pvParameters) {
 void esp_fill_audio_buffer_task() {
     while(1) {
         AMY_PROFILE_START(AMY_ESP_FILL_BUFFER)
+        int64_t tic = get_time_us();
 
         // Get ready to render
         amy_prepare_buffer();
+        alles_partition_oscs();
         // Tell the other core to start rendering
         xTaskNotifyGive(amy_render_handle);
         // Render me
-        amy_render(AMY_OSCS/2, AMY_OSCS, 0);
+        alles_render_partition(0);
         // Wait for the other core to finish
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
         // Write to i2s
         int16_t *block = amy_fill_buffer();
         AMY_PROFILE_STOP(AMY_ESP_FILL_BUFFER)
+        perf_record(PERF_AMY, (uint32_t)tic, (uint32_t)(get_time_us() - tic));
 
         // We turn off writing to i2s on r10 when doing on chip debugging because of pins
         #ifndef TULIP_R10_DEBUG
@@ -118,7 +192,7 @@ void alles_send_message(char * message, uint16_t len) {
 // init AMY from the esp. wraps some amy funcs in a task to do multicore rendering on the ESP32 
 amy_err_t esp_amy_init() {
     sync_init();
-    amy_start(2,1,1);
+    amy_start(ALLES_RENDER_WORKERS,1,1);
     // We create a mutex for changing the event queue and pointers as two tasks do it at once
     xQueueSemaphore = xSemaphoreCreateMutex();
 
@@ -135,9 +209,68 @@ amy_err_t esp_amy_init() {
 #else
 
 extern void *miniaudio_run(void *vargp);
+extern uint8_t headless;
+extern void headless_audio_init();
 #include <pthread.h>
+
+// ALLES_RENDER_WORKERS-1 threads, each renders its own partition. The thread asking for the block is the
+// last worker and renders partition 0
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_go = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t render_done = PTHREAD_COND_INITIALIZER;
+static uint32_t render_generation = 0;
+static uint8_t render_pending = 0;
+
+static void *render_worker(void *vargp) {
+    uint8_t p = (uint8_t)(intptr_t)vargp;
+    uint32_t seen = 0;
+    while(1) {
+        pthread_mutex_lock(&render_lock);
+        while(render_generation == seen) pthread_cond_wait(&render_go, &render_lock);
+        seen = render_generation;
+        pthread_mutex_unlock(&render_lock);
+        alles_render_partition(p);
+        pthread_mutex_lock(&render_lock);
+        if(--render_pending == 0) pthread_cond_signal(&render_done);
+        pthread_mutex_unlock(&render_lock);
+    }
+    return NULL;
+}
+
+static void render_pool_start() {
+    for(uint8_t p=1;p<ALLES_RENDER_WORKERS;p++) {
+        pthread_t thread_id;
+        pthread_create(&thread_id, NULL, render_worker, (void*)(intptr_t)p);
+        pthread_detach(thread_id);
+    }
+}
+
+// One block of AMY, rendered across the pool, for loops that drive AMY themselves
+int16_t * alles_render_block() {
+    amy_prepare_buffer();
+    alles_partition_oscs();
+    pthread_mutex_lock(&render_lock);
+    render_pending = ALLES_RENDER_WORKERS - 1;
+    render_generation++;
+    pthread_cond_broadcast(&render_go);
+    pthread_mutex_unlock(&render_lock);
+    alles_render_partition(0);
+    pthread_mutex_lock(&render_lock);
+    while(render_pending) pthread_cond_wait(&render_done, &render_lock);
+    pthread_mutex_unlock(&render_lock);
+    return amy_fill_buffer();
+}
+
 amy_err_t unix_amy_init() {
     sync_init();
+    if(headless) {
+        // No sound device, the headless display loop renders blocks itself, across the pool
+        amy_start(ALLES_RENDER_WORKERS,1,1);
+        render_pool_start();
+        headless_audio_init();
+        return AMY_OK;
+    }
+    // miniaudio's callback renders AMY in one go on its own thread
     amy_start(1,1,1);
     pthread_t thread_id;
     pthread_create(&thread_id, NULL, miniaudio_run, NULL);
@@ -88,10 +88,29 @@ void alles_init_multicast(uint8_t local_node);
 void esp_show_debug(uint8_t type);
 void alles_send_message(char * message, uint16_t len);
 
+// Threads rendering AMY at once: the two cores on Tulip CC, the render pool on Tulip Desktop's headless mode.
+// AMY mixes one buffer per core it was started with, and has at most 2
+#define ALLES_RENDER_WORKERS 2
+// Each worker renders one contiguous range of oscillators, picked every block so each has about the same work in it
+#define ALLES_RENDER_PARTITIONS ALLES_RENDER_WORKERS
+
+typedef struct {
+    uint16_t start, end;        // oscs, end not included
+    uint32_t cost;              // estimated work this block, see osc_cost()
+    uint32_t last_us, max_us;   // time the last render of this partition took, and the most since reset
+    uint32_t blocks;
+} alles_partition_t;
+
+extern alles_partition_t alles_partitions[ALLES_RENDER_PARTITIONS];
+void alles_partition_oscs();
+void alles_render_partition(uint8_t p);
+void alles_partition_reset_stats();
+
 #ifdef ESP_PLATFORM
 void run_alles();
 #else
 void * alles_start(void *vargs);
+int16_t * alles_render_block();
 #endif
 
 
@@ -0,0 +1,453 @@
+// bench.c
+// Microbenchmarks for the hot paths: bounce buffer compositing, TFB raster, the BG drawing primitives,
+// PNG decode, u8g2 text, the memory PCM oscillator, the alles/AMY message parser and the MIDI parser.
+// Each one times a loop of iterations and reports how many units of work (pixels, events, samples) it did,
+// so tulip.bench() can give ns per unit on desktop and on device.
+// BG drawing happens in the offscreen corner (x >= H_RES, y >= V_RES) so it doesn't mess up the screen.
+// Pixel counts for shapes are the shape's nominal size, good for comparing runs, not primitives.
+#include "bench.h"
+#include "lodepng.h"
+#include "u8g2_fonts.h"
+#include "alles.h"
+#include "midi.h"
+#include "amy.h"
+
+#define BENCH_X H_RES
+#define BENCH_Y V_RES
+#define BENCH_W OFFSCREEN_X_PX
+#define BENCH_H OFFSCREEN_Y_PX
+#define BENCH_FONT 5
+#define BENCH_PCM_LEN 4096
+
+extern uint8_t mesh_local_playback;
+extern int8_t memorypcm_load(mp_obj_t bytes, uint32_t samplerate, uint8_t midinote, uint32_t loopstart, uint32_t loopend);
+extern void memorypcm_unload_patch(uint8_t patch);
+
+static uint8_t *bench_buf = NULL;
+static uint32_t bench_buf_len = 0;
+static uint32_t bench_iter = 0;
+
+static uint8_t bench_alloc(uint32_t len) {
+    bench_buf = (uint8_t*)malloc_caps(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    bench_buf_len = len;
+    return bench_buf != NULL;
+}
+
+static void bench_free() {
+    if(bench_buf != NULL) free_caps(bench_buf);
+    bench_buf = NULL;
+    bench_buf_len = 0;
+}
+
+static uint32_t line_px(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    int16_t dx = abs(x1 - x0);
+    int16_t dy = abs(y1 - y0);
+    return (dx > dy ? dx : dy) + 1;
+}
+
+
+// Compositor: a whole frame of bounce buffers with 0, 8 or 32 sprites on
+
+static uint16_t saved_sprite_x[SPRITES], saved_sprite_y[SPRITES], saved_sprite_w[SPRITES], saved_sprite_h[SPRITES];
+static uint8_t saved_sprite_vis[SPRITES];
+static sprite_tf_t saved_sprite_tf[SPRITES];
+static uint32_t saved_sprite_mem[SPRITES];
+static uint8_t saved_collisions[128];
+
+static uint8_t bounce_setup(uint8_t sprites) {
+    if(!bench_alloc(FONT_HEIGHT*H_RES*BYTES_PER_PIXEL)) return 0;
+    memcpy(saved_collisions, collision_bitfield, 128);
+    for(uint8_t i=0;i<SPRITES;i++) {
+        saved_sprite_x[i] = sprite_x_px[i]; saved_sprite_y[i] = sprite_y_px[i];
+        saved_sprite_w[i] = sprite_w_px[i]; saved_sprite_h[i] = sprite_h_px[i];
+        saved_sprite_vis[i] = sprite_vis[i]; saved_sprite_mem[i] = sprite_mem[i];
+        saved_sprite_tf[i] = sprite_tf[i];
+        sprite_vis[i] = 0;
+        sprite_tf[i].on = 0;
+    }
+    // Spread them out, with some overlapping so the collision check does real work
+    for(uint8_t i=0;i<sprites;i++) {
+        sprite_x_px[i] = (i * 97) % (H_RES - 32);
+        sprite_y_px[i] = (i * 53) % (V_RES - 32);
+        sprite_w_px[i] = 32;
+        sprite_h_px[i] = 32;
+        sprite_mem[i] = 0;
+        sprite_vis[i] = SPRITE_IS_SPRITE;
+    }
+    return 1;
+}
+
+static uint8_t bounce_0_setup() { return bounce_setup(0); }
+static uint8_t bounce_8_setup() { return bounce_setup(8); }
+static uint8_t bounce_32_setup() { return bounce_setup(32); }
+// Same 32 sprites, each scaled and turned so the compositor takes the affine path
+static uint8_t bounce_32_affine_setup() {
+    if(!bounce_setup(32)) return 0;
+    for(uint8_t i=0;i<32;i++) display_sprite_transform(i, 1.5f, 1.5f, i * 11.25f, i & 3);
+    return 1;
+}
+
+static uint32_t bounce_run() {
+    uint32_t px = 0;
+    for(uint16_t y=0;y+FONT_HEIGHT<=V_RES;y=y+FONT_HEIGHT) {
+        display_bounce_empty(bench_buf, y*H_RES, H_RES*FONT_HEIGHT*BYTES_PER_PIXEL, NULL);
+        px += H_RES*FONT_HEIGHT;
+    }
+    return px;
+}
+
+static void bounce_teardown() {
+    for(uint8_t i=0;i<SPRITES;i++) {
+        sprite_x_px[i] = saved_sprite_x[i]; sprite_y_px[i] = saved_sprite_y[i];
+        sprite_w_px[i] = saved_sprite_w[i]; sprite_h_px[i] = saved_sprite_h[i];
+        sprite_vis[i] = saved_sprite_vis[i]; sprite_mem[i] = saved_sprite_mem[i];
+        sprite_tf[i] = saved_sprite_tf[i];
+    }
+    memcpy(collision_bitfield, saved_collisions, 128);
+    bench_free();
+}
+
+static uint32_t tfb_run() {
+    display_tfb_update(-1);
+    return TFB_ROWS*FONT_HEIGHT*H_RES;
+}
+
+
+// BG primitives, all clipped to the offscreen corner
+
+static uint8_t draw_setup() {
+    draw_set_clip(BENCH_X, BENCH_Y, BENCH_W, BENCH_H);
+    return 1;
+}
+
+static void draw_teardown() {
+    draw_set_clip(0, 0, 0, 0);
+}
+
+static uint32_t pixel_run() {
+    for(uint16_t j=0;j<BENCH_H;j++) {
+        for(uint16_t i=0;i<BENCH_W;i++) {
+            display_set_bg_pixel_pal(BENCH_X+i, BENCH_Y+j, i ^ j);
+        }
+    }
+    return BENCH_W*BENCH_H;
+}
+
+static uint32_t line_run() {
+    uint32_t px = 0;
+    for(uint8_t k=0;k<16;k++) {
+        int16_t y0 = BENCH_Y + k*(BENCH_H/16);
+        int16_t y1 = BENCH_Y + BENCH_H - 1 - k*(BENCH_H/16);
+        drawLine_scanline(BENCH_X, y0, BENCH_X+BENCH_W-1, y1, k);
+        px += line_px(BENCH_X, y0, BENCH_X+BENCH_W-1, y1);
+    }
+    return px;
+}
+
+static uint32_t bezier_run() {
+    uint32_t px = 0;
+    for(uint8_t k=0;k<8;k++) {
+        int16_t cy = BENCH_Y + k*(BENCH_H/8);
+        plotQuadBezier(BENCH_X, BENCH_Y+BENCH_H-1, BENCH_X+BENCH_W/2, cy, BENCH_X+BENCH_W-1, BENCH_Y+BENCH_H-1, k);
+        px += line_px(BENCH_X, BENCH_Y+BENCH_H-1, BENCH_X+BENCH_W/2, cy) + line_px(BENCH_X+BENCH_W/2, cy, BENCH_X+BENCH_W-1, BENCH_Y+BENCH_H-1);
+    }
+    return px;
+}
+
+static uint32_t rect_run() {
+    drawRect(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, bench_iter++);
+    return 2*(BENCH_W+BENCH_H);
+}
+
+static uint32_t rect_fill_run() {
+    fillRect(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, bench_iter++);
+    return BENCH_W*BENCH_H;
+}
+
+static uint32_t roundrect_run() {
+    drawRoundRect(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, 16, bench_iter++);
+    return 2*(BENCH_W+BENCH_H);
+}
+
+static uint32_t roundrect_fill_run() {
+    fillRoundRect(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, 16, bench_iter++);
+    return BENCH_W*BENCH_H;
+}
+
+static uint32_t circle_run() {
+    int16_t r = BENCH_H/2 - 1;
+    drawCircle(BENCH_X+BENCH_W/2, BENCH_Y+BENCH_H/2, r, bench_iter++);
+    return (r*44)/7;
+}
+
+static uint32_t circle_fill_run() {
+    int16_t r = BENCH_H/2 - 1;
+    fillCircle(BENCH_X+BENCH_W/2, BENCH_Y+BENCH_H/2, r, bench_iter++);
+    return (r*r*22)/7;
+}
+
+static uint32_t triangle_run() {
+    drawTriangle(BENCH_X, BENCH_Y+BENCH_H-1, BENCH_X+BENCH_W/2, BENCH_Y, BENCH_X+BENCH_W-1, BENCH_Y+BENCH_H-1, bench_iter++);
+    return line_px(BENCH_X, BENCH_Y+BENCH_H-1, BENCH_X+BENCH_W/2, BENCH_Y) + line_px(BENCH_X+BENCH_W/2, BENCH_Y, BENCH_X+BENCH_W-1, BENCH_Y+BENCH_H-1) + BENCH_W;
+}
+
+static uint32_t triangle_fill_run() {
+    fillTriangle(BENCH_X, BENCH_Y+BENCH_H-1, BENCH_X+BENCH_W/2, BENCH_Y, BENCH_X+BENCH_W-1, BENCH_Y+BENCH_H-1, bench_iter++);
+    return BENCH_W*BENCH_H/2;
+}
+
+static uint8_t fill_setup() {
+    fillRect(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, 0);
+    return 1;
+}
+
+// Alternate colors so every iteration refills the whole box
+static uint32_t fill_run() {
+    fill_region(BENCH_X+1, BENCH_Y+1, (bench_iter++ & 1) ? 1 : 2, NULL, 0, 0, BENCH_X, BENCH_Y, BENCH_W, BENCH_H);
+    return BENCH_W*BENCH_H;
+}
+
+static uint32_t str_run() {
+    uint16_t w = draw_new_str("Tulip", BENCH_X, BENCH_Y+BENCH_H/2, bench_iter++, BENCH_FONT, 0, 0, 0);
+    return w * u8g2_a_height(BENCH_FONT);
+}
+
+static uint8_t bitmap_setup() {
+    if(!bench_alloc(BENCH_W*BENCH_H*BYTES_PER_PIXEL)) return 0;
+    for(uint32_t i=0;i<bench_buf_len;i++) {
+        bench_buf[i] = (i & 0xff) == ALPHA ? 0 : (i & 0xff);
+    }
+    return 1;
+}
+
+static uint32_t bitmap_run() {
+    display_set_bg_bitmap_raw(BENCH_X, BENCH_Y, BENCH_W, BENCH_H, bench_buf);
+    return BENCH_W*BENCH_H;
+}
+
+static uint32_t blit_run() {
+    display_bg_bitmap_blit(BENCH_X, BENCH_Y, BENCH_W/2, BENCH_H, BENCH_X+BENCH_W/2, BENCH_Y);
+    return (BENCH_W/2)*BENCH_H;
+}
+
+static uint32_t blit_alpha_run() {
+    display_bg_bitmap_blit_alpha(BENCH_X, BENCH_Y, BENCH_W/2, BENCH_H, BENCH_X+BENCH_W/2, BENCH_Y);
+    return (BENCH_W/2)*BENCH_H;
+}
+
+// bg_clear touches the whole BG, so keep a copy to put back after
+static uint8_t clear_setup() {
+    if(!bench_alloc((H_RES+OFFSCREEN_X_PX)*(V_RES+OFFSCREEN_Y_PX)*BYTES_PER_PIXEL)) return 0;
+    memcpy(bench_buf, bg, bench_buf_len);
+    return 1;
+}
+
+static uint32_t clear_run() {
+    display_clear_bg(bench_iter++);
+    return (H_RES+OFFSCREEN_X_PX)*(V_RES+OFFSCREEN_Y_PX);
+}
+
+static void clear_teardown() {
+    memcpy(bg, bench_buf, bench_buf_len);
+    bench_free();
+}
+
+
+// PNG: a gradient the size of the bench box, encoded once in setup
+
+static uint8_t png_setup() {
+    uint8_t *rgba = (uint8_t*)malloc_caps(BENCH_W*BENCH_H*4, MALLOC_CAP_SPIRAM);
+    if(rgba == NULL) return 0;
+    for(uint16_t j=0;j<BENCH_H;j++) {
+        for(uint16_t i=0;i<BENCH_W;i++) {
+            uint8_t *p = rgba + (j*BENCH_W + i)*4;
+            p[0] = i*2; p[1] = j*2; p[2] = i ^ j; p[3] = 255;
+        }
+    }
+    size_t png_len = 0;
+    unsigned error = lodepng_encode_memory(&bench_buf, &png_len, rgba, BENCH_W, BENCH_H, LCT_RGBA, 8);
+    free_caps(rgba);
+    if(error) {
+        fprintf(stderr, "bench: png encode error %u: %s\n", error, lodepng_error_text(error));
+        bench_buf = NULL;
+        return 0;
+    }
+    bench_buf_len = png_len;
+    return 1;
+}
+
+static uint32_t png_decode_run() {
+    unsigned char *image;
+    unsigned width, height;
+    if(lodepng_decode_memory(&image, &width, &height, bench_buf, bench_buf_len, LCT_RGBA, 8)) return 0;
+    free_caps(image);
+    return width*height;
+}
+
+// The bg_png path: decode and convert to RGB332 into BG
+static uint32_t png_bg_run() {
+    unsigned char *image;
+    unsigned width, height;
+    if(lodepng_decode_memory(&image, &width, &height, bench_buf, bench_buf_len, LCT_RGBA, 8)) return 0;
+    display_set_bg_bitmap_rgba(BENCH_X, BENCH_Y, width, height, image);
+    free_caps(image);
+    return width*height;
+}
+
+
+// Memory PCM: renders a looping patch on the last oscillator, which is put back after
+
+#define BENCH_OSC (AMY_OSCS-1)
+static int8_t bench_patch = -1;
+static __typeof__(synth[0]) saved_synth;
+static __typeof__(msynth[0]) saved_msynth;
+static SAMPLE bench_block[AMY_BLOCK_SIZE];
+
+static uint8_t memorypcm_setup() {
+    // A sawtooth, memorypcm_load wants it as bytes
+    if(!bench_alloc(BENCH_PCM_LEN*sizeof(int16_t))) return 0;
+    int16_t *samples = (int16_t*)bench_buf;
+    for(uint16_t i=0;i<BENCH_PCM_LEN;i++) samples[i] = (int16_t)(i * 64);
+    bench_patch = memorypcm_load(mp_obj_new_bytes(bench_buf, bench_buf_len), 22050, 60, 0, 0);
+    bench_free();
+    if(bench_patch < 0) return 0;
+    memcpy(&saved_synth, &synth[BENCH_OSC], sizeof(saved_synth));
+    memcpy(&saved_msynth, &msynth[BENCH_OSC], sizeof(saved_msynth));
+    synth[BENCH_OSC].patch = bench_patch;
+    synth[BENCH_OSC].phase = 0;
+    msynth[BENCH_OSC].logfreq = 0;
+    msynth[BENCH_OSC].amp = 1;
+    msynth[BENCH_OSC].feedback = 1; // loop forever
+    return 1;
+}
+
+static uint32_t memorypcm_bench_run() {
+    memset(bench_block, 0, sizeof(bench_block));
+    memorypcm_render(bench_block, BENCH_OSC);
+    return AMY_BLOCK_SIZE;
+}
+
+static void memorypcm_teardown() {
+    memcpy(&synth[BENCH_OSC], &saved_synth, sizeof(saved_synth));
+    memcpy(&msynth[BENCH_OSC], &saved_msynth, sizeof(saved_msynth));
+    memorypcm_unload_patch(bench_patch);
+    bench_patch = -1;
+}
+
+
+// Parsers. Local playback is off while the alles one runs so the events don't reach AMY,
+// and the MIDI one drains its own messages from the queue (and drops any real MIDI in meanwhile.)
+
+static char bench_messages[][32] = {
+    "v0w1f440.0l1", "v0l0", "v1n60l0.5w5", "v2w0f220.0a0.5A100,1,250,0l1", "v2l0"
+};
+#define BENCH_MESSAGES (sizeof(bench_messages)/sizeof(bench_messages[0]))
+static uint8_t saved_local_playback;
+
+static uint8_t alles_setup() {
+    saved_local_playback = mesh_local_playback;
+    mesh_local_playback = 0;
+    return 1;
+}
+
+static uint32_t alles_run() {
+    for(uint8_t i=0;i<BENCH_MESSAGES;i++) {
+        alles_parse_message(bench_messages[i], strlen(bench_messages[i]));
+    }
+    return BENCH_MESSAGES;
+}
+
+static void alles_teardown() {
+    mesh_local_playback = saved_local_playback;
+}
+
+#define BENCH_MIDI_MESSAGES 32
+static uint8_t bench_midi[BENCH_MIDI_MESSAGES*3];
+static mp_obj_t saved_midi_callback;
+
+static uint8_t midi_setup() {
+    // Note ons and offs, with running status on the second half
+    for(uint8_t i=0;i<BENCH_MIDI_MESSAGES;i++) {
+        bench_midi[i*3+0] = (i < BENCH_MIDI_MESSAGES/2) ? 0x90 : 0x80;
+        bench_midi[i*3+1] = 36 + i;
+        bench_midi[i*3+2] = 100;
+    }
+    saved_midi_callback = midi_callback;
+    midi_callback = NULL;
+    return 1;
+}
+
+static uint32_t midi_run() {
+    convert_midi_bytes_to_messages(bench_midi, sizeof(bench_midi));
+    midi_queue_head = midi_queue_tail;
+    return BENCH_MIDI_MESSAGES;
+}
+
+static void midi_teardown() {
+    midi_callback = saved_midi_callback;
+}
+
+
+const bench_t benches[] = {
+    // name, unit, default iters, stops display, setup, run, teardown
+    { "bounce_0", "px", 20, 1, bounce_0_setup, bounce_run, bounce_teardown },
+    { "bounce_8", "px", 20, 1, bounce_8_setup, bounce_run, bounce_teardown },
+    { "bounce_32", "px", 20, 1, bounce_32_setup, bounce_run, bounce_teardown },
+    { "bounce_32_affine", "px", 20, 1, bounce_32_affine_setup, bounce_run, bounce_teardown },
+    { "tfb_update", "px", 20, 1, NULL, tfb_run, NULL },
+    { "bg_pixel", "px", 20, 0, NULL, pixel_run, NULL },
+    { "bg_line", "px", 200, 0, draw_setup, line_run, draw_teardown },
+    { "bg_bezier", "px", 200, 0, draw_setup, bezier_run, draw_teardown },
+    { "bg_rect", "px", 1000, 0, draw_setup, rect_run, draw_teardown },
+    { "bg_rect_fill", "px", 200, 0, draw_setup, rect_fill_run, draw_teardown },
+    { "bg_roundrect", "px", 1000, 0, draw_setup, roundrect_run, draw_teardown },
+    { "bg_roundrect_fill", "px", 200, 0, draw_setup, roundrect_fill_run, draw_teardown },
+    { "bg_circle", "px", 1000, 0, draw_setup, circle_run, draw_teardown },
+    { "bg_circle_fill", "px", 200, 0, draw_setup, circle_fill_run, draw_teardown },
+    { "bg_triangle", "px", 1000, 0, draw_setup, triangle_run, draw_teardown },
+    { "bg_triangle_fill", "px", 200, 0, draw_setup, triangle_fill_run, draw_teardown },
+    { "bg_fill", "px", 50, 0, fill_setup, fill_run, NULL },
+    { "bg_str", "px", 500, 0, draw_setup, str_run, draw_teardown },
+    { "bg_bitmap", "px", 200, 0, bitmap_setup, bitmap_run, bench_free },
+    { "bg_blit", "px", 200, 0, NULL, blit_run, NULL },
+    { "bg_blit_alpha", "px", 200, 0, NULL, blit_alpha_run, NULL },
+    { "bg_clear", "px", 5, 1, clear_setup, clear_run, clear_teardown },
+    { "png_decode", "px", 10, 0, png_setup, png_decode_run, bench_free },
+    { "png_bg", "px", 10, 0, png_setup, png_bg_run, bench_free },
+    { "memorypcm_render", "sample", 500, 0, memorypcm_setup, memorypcm_bench_run, memorypcm_teardown },
+    { "alles_parse_message", "event", 500, 0, alles_setup, alles_run, alles_teardown },
+    { "midi_parse", "event", 500, 0, midi_setup, midi_run, midi_teardown },
+};
+
+const uint16_t bench_count = sizeof(benches)/sizeof(bench_t);
+
+int16_t bench_find(const char *name) {
+    for(uint16_t i=0;i<bench_count;i++) {
+        if(strcmp(benches[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+// Runs benchmark i for iters iterations (0 is its default) after one untimed warm up run.
+// Returns 0 if it couldn't be set up.
+uint8_t bench_run(uint16_t i, uint32_t iters, bench_result_t *result) {
+    const bench_t *b = &benches[i];
+    if(iters == 0) iters = b->default_iters;
+    if(b->stops_display) display_stop();
+    if(b->setup != NULL && !b->setup()) {
+        if(b->stops_display) display_start();
+        return 0;
+    }
+    bench_iter = 0;
+    b->run();
+    result->units = 0;
+    int64_t tic = get_time_us();
+    for(uint32_t n=0;n<iters;n++) {
+        result->units += b->run();
+    }
+    result->total_us = get_time_us() - tic;
+    result->iters = iters;
+    if(b->teardown != NULL) b->teardown();
+    if(b->stops_display) display_start();
+    return 1;
+}
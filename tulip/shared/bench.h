@@ -0,0 +1,31 @@
+// bench.h
+// microbenchmarks for the display, drawing, TFB and audio hot paths
+#ifndef __BENCHH
+#define __BENCHH
+
+#include "display.h"
+#include "bresenham.h"
+
+typedef struct {
+    const char *name;
+    const char *unit;       // what one unit of work is: "px", "event", "byte" or "sample"
+    uint32_t default_iters;
+    uint8_t stops_display;  // pause scanout while it runs, so we aren't racing the bounce ISR
+    uint8_t (*setup)();     // returns 0 if the benchmark can't run right now
+    uint32_t (*run)();      // one iteration, returns the units of work it did
+    void (*teardown)();
+} bench_t;
+
+typedef struct {
+    uint32_t iters;
+    int64_t total_us;
+    uint64_t units;
+} bench_result_t;
+
+extern const bench_t benches[];
+extern const uint16_t bench_count;
+
+int16_t bench_find(const char *name);
+uint8_t bench_run(uint16_t i, uint32_t iters, bench_result_t *result);
+
+#endif
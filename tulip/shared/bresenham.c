@@ -1,9 +1,29 @@
 // bresenham.c
 // raster line etc drawing functions
 #include "bresenham.h"
+#include "surface.h"
 
 
+// Optional clip rect for everything that goes through drawPixel, used by display list replay
+static uint8_t draw_clip_active = 0;
+static int16_t draw_clip_x0, draw_clip_y0, draw_clip_x1, draw_clip_y1;
+
+void draw_set_clip(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if(w <= 0 || h <= 0) {
+        draw_clip_active = 0;
+        return;
+    }
+    draw_clip_x0 = x; draw_clip_y0 = y;
+    draw_clip_x1 = x + w; draw_clip_y1 = y + h;
+    draw_clip_active = 1;
+}
+
 void drawPixel(int cx, int cy, uint8_t pal_idx) {
+    if(draw_clip_active && (cx < draw_clip_x0 || cx >= draw_clip_x1 || cy < draw_clip_y0 || cy >= draw_clip_y1)) return;
+    if(draw_target.pixels) {
+        if(cx >= 0 && cy >= 0 && cx < draw_target.w && cy < draw_target.h) draw_target.pixels[cy*draw_target.w + cx] = pal_idx;
+        return;
+    }
     display_set_bg_pixel_pal(cx, cy, pal_idx);
 }
 
@@ -51,6 +71,10 @@ void drawLine_scanline(short x0, short y0,short x1, short y1,unsigned short colo
 
 
 uint8_t getPixel(int cx, int cy) {
+    if(draw_target.pixels) {
+        if(cx >= 0 && cy >= 0 && cx < draw_target.w && cy < draw_target.h) return draw_target.pixels[cy*draw_target.w + cx];
+        return 0;
+    }
     return display_get_bg_pixel_pal(cx,cy);
 }
 
@@ -102,87 +126,158 @@ uint16_t draw_new_str(const char * str, uint16_t x, uint16_t y, uint8_t fg, uint
 }
 
 
-//stack friendly and fast floodfill algorithm, using recursive function calls
-void floodFillScanline(int x, int y, int newColor, int oldColor)
-{
-  if(oldColor == newColor) return;
-  if(getPixel(x,y) != oldColor) return;
-
-  int x1;
+// Span flood fill (Heckbert, "A Seed Fill Algorithm", Graphics Gems 1990.)
+// Works directly on bg rows with a fixed size segment stack and a 1-bit "filled" mask over the clip rect,
+// so it never recurses and never allocates more than FILL_STACK_SEGMENTS + the mask.
+// If the stack overflows we drop the push, and when it drains we rescan the mask for filled spans that
+// still touch unfilled pixels and restart from there. Slower in that case, but always finishes.
+
+#define FILL_STACK_SEGMENTS 2048
+
+typedef struct {
+    int16_t y;
+    int16_t xl;
+    int16_t xr;
+    int16_t dy;
+} fill_segment_t;
+
+typedef struct {
+    fill_segment_t *stack;
+    uint16_t sp;
+    uint8_t overflow;
+    uint8_t *mask;
+    uint16_t mask_stride;
+    int16_t cx0, cy0, cx1, cy1; // inclusive clip
+    uint8_t old_color;
+    uint8_t color;
+    const uint8_t *pattern;
+    uint16_t pw, ph;
+} fill_state_t;
+
+static inline uint8_t *fill_row(int16_t y) {
+    if(draw_target.pixels) return draw_target.pixels + (uint32_t)y*draw_target.w;
+    return bg + (uint32_t)y*(H_RES+OFFSCREEN_X_PX)*BYTES_PER_PIXEL;
+}
 
-  //draw current scanline from start position to the right
-  x1 = x;
-  while(x1 < (H_RES + OFFSCREEN_X_PX) && getPixel(x1,y) == oldColor)
-  {
-    drawPixel(x1,y,newColor);
-    x1++;
-  }
+static inline uint8_t fill_marked(fill_state_t *f, int16_t x, int16_t y) {
+    uint32_t bit = x - f->cx0;
+    return f->mask[(y - f->cy0)*f->mask_stride + (bit >> 3)] & (1 << (bit & 7));
+}
 
-  //draw current scanline from start position to the left
-  x1 = x - 1;
-  while(x1 >= 0 && getPixel(x1,y) == oldColor)
-  {
-    drawPixel(x1,y,newColor);
-    x1--;
-  }
+static inline uint8_t fill_inside(fill_state_t *f, uint8_t *row, int16_t x, int16_t y) {
+    return row[x] == f->old_color && !fill_marked(f, x, y);
+}
 
-  //test for new scanlines above
-  x1 = x;
-  while(x1 < (H_RES + OFFSCREEN_X_PX) && getPixel(x1,y) == newColor)
-  {
-    if(y > 0 && getPixel(x1,y-1) == oldColor)
-    {
-      floodFillScanline(x1, y - 1, newColor, oldColor);
-    }
-    x1++;
-  }
-  x1 = x - 1;
-  while(x1 >= 0 && getPixel(x1,y) == newColor)
-  {
-    if(y > 0 && getPixel(x1,y-1) == oldColor)
-    {
-      floodFillScanline(x1, y - 1, newColor, oldColor);
+static inline void fill_set(fill_state_t *f, uint8_t *row, int16_t x, int16_t y) {
+    uint32_t bit = x - f->cx0;
+    f->mask[(y - f->cy0)*f->mask_stride + (bit >> 3)] |= (1 << (bit & 7));
+    if(f->pattern) {
+        uint8_t c = f->pattern[(y % f->ph)*f->pw + (x % f->pw)];
+        if(c != ALPHA) row[x] = c;
+    } else {
+        row[x] = f->color;
     }
-    x1--;
-  }
+}
 
-  //test for new scanlines below
-  x1 = x;
-  while(x1 < (H_RES + OFFSCREEN_X_PX) && getPixel(x1,y) == newColor)
-  {
-    if(y < (V_RES + OFFSCREEN_Y_PX) - 1 && getPixel(x1,y+1) == oldColor)
-    {
-      floodFillScanline(x1, y + 1, newColor, oldColor);
-    }
-    x1++;
-  }
-  x1 = x - 1;
-  while(x1 >= 0 && getPixel(x1,y) == newColor)
-  {
-    if(y < (V_RES + OFFSCREEN_Y_PX) - 1 && getPixel(x1,y+1) == oldColor)
-    {
-      floodFillScanline(x1, y + 1, newColor, oldColor);
+static inline void fill_push(fill_state_t *f, int16_t y, int16_t xl, int16_t xr, int16_t dy) {
+    if(y+dy < f->cy0 || y+dy > f->cy1) return;
+    if(f->sp == FILL_STACK_SEGMENTS) { f->overflow = 1; return; }
+    fill_segment_t *s = &f->stack[f->sp++];
+    s->y = y; s->xl = xl; s->xr = xr; s->dy = dy;
+}
+
+static void fill_drain(fill_state_t *f) {
+    while(f->sp) {
+        fill_segment_t s = f->stack[--f->sp];
+        int16_t y = s.y + s.dy;
+        int16_t x1 = s.xl, x2 = s.xr, dy = s.dy;
+        uint8_t *row = fill_row(y);
+        int16_t x, l;
+        for(x = x1; x >= f->cx0 && fill_inside(f, row, x, y); x--) fill_set(f, row, x, y);
+        if(x >= x1) goto skip;
+        l = x + 1;
+        if(l < x1) fill_push(f, y, l, x1 - 1, -dy); // leak on left
+        x = x1 + 1;
+        do {
+            for(; x <= f->cx1 && fill_inside(f, row, x, y); x++) fill_set(f, row, x, y);
+            fill_push(f, y, l, x - 1, dy);
+            if(x > x2 + 1) fill_push(f, y, x2 + 1, x - 1, -dy); // leak on right
+skip:       x++;
+            while(x <= x2 && !fill_inside(f, row, x, y)) x++;
+            l = x;
+        } while(x <= x2);
     }
-    x1--;
-  }
 }
 
-void floodFill(int16_t x, int16_t y, uint8_t color, uint8_t old_color) {   
-    if ( 0 <= x && x < (H_RES + OFFSCREEN_X_PX)  && 0 <= y && y < V_RES+OFFSCREEN_Y_PX) {
-        if(display_get_bg_pixel_pal(x,y) == old_color) {
-            display_set_bg_pixel_pal(x,y, color);
-            floodFill(x-1,y,color,old_color);
-            floodFill(x+1,y,color,old_color);
-            floodFill(x,y-1,color,old_color);
-            floodFill(x,y+1,color,old_color);
+// After an overflow: find every filled span with an unfilled neighbor above or below and push it again
+static void fill_rescan(fill_state_t *f) {
+    f->overflow = 0;
+    for(int16_t y = f->cy0; y <= f->cy1; y++) {
+        int16_t x = f->cx0;
+        while(x <= f->cx1) {
+            if(!fill_marked(f, x, y)) { x++; continue; }
+            int16_t l = x;
+            while(x <= f->cx1 && fill_marked(f, x, y)) x++;
+            for(int16_t dy = -1; dy <= 1; dy += 2) {
+                int16_t ny = y + dy;
+                if(ny < f->cy0 || ny > f->cy1) continue;
+                uint8_t *row = fill_row(ny);
+                for(int16_t i = l; i < x; i++) {
+                    if(fill_inside(f, row, i, ny)) { fill_push(f, y, l, x - 1, dy); break; }
+                }
+            }
         }
     }
 }
 
+// Fill the area connected to x,y that has the same color as x,y. 
+// If pattern is given (pw x ph pal_idxes, ALPHA is skipped) it is tiled from bg 0,0 instead of using color.
+// The fill never leaves the clip rect cx,cy,cw,ch. Pass cw or ch as 0 to use the whole bg (or draw target).
+void fill_region(int16_t x, int16_t y, uint8_t color, const uint8_t *pattern, uint16_t pw, uint16_t ph,
+                 int16_t cx, int16_t cy, int16_t cw, int16_t ch) {
+    fill_state_t f;
+    surface_t target = surface_target();
+    if(cw <= 0 || ch <= 0) { cx = 0; cy = 0; cw = target.w; ch = target.h; }
+    if(cx < 0) { cw += cx; cx = 0; }
+    if(cy < 0) { ch += cy; cy = 0; }
+    if(cx + cw > target.w) cw = target.w - cx;
+    if(cy + ch > target.h) ch = target.h - cy;
+    if(cw <= 0 || ch <= 0) return;
+    if(x < cx || x >= cx + cw || y < cy || y >= cy + ch) return;
+    if(pattern && (pw == 0 || ph == 0)) return;
+
+    f.cx0 = cx; f.cy0 = cy; f.cx1 = cx + cw - 1; f.cy1 = cy + ch - 1;
+    f.old_color = fill_row(y)[x];
+    f.color = color;
+    f.pattern = pattern;
+    f.pw = pw; f.ph = ph;
+    if(!pattern && f.old_color == color) return;
+
+    f.mask_stride = (cw + 7) / 8;
+    f.mask = (uint8_t*)calloc_caps(32, 1, f.mask_stride * ch, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    f.stack = (fill_segment_t*)malloc_caps(FILL_STACK_SEGMENTS * sizeof(fill_segment_t), MALLOC_CAP_INTERNAL);
+    if(f.mask == NULL || f.stack == NULL) {
+        fprintf(stderr, "fill: could not allocate scratch memory\n");
+        if(f.mask) free_caps(f.mask);
+        if(f.stack) free_caps(f.stack);
+        return;
+    }
+    f.sp = 0;
+    f.overflow = 0;
+
+    fill_push(&f, y, x, x, 1);      // the pixel below the seed, needed in some cases
+    fill_push(&f, y + 1, x, x, -1); // the seed row itself, popped first
+    fill_drain(&f);
+    while(f.overflow) {
+        fill_rescan(&f);
+        fill_drain(&f);
+    }
+    free_caps(f.stack);
+    free_caps(f.mask);
+}
 
 void fill(int16_t x, int16_t y, uint8_t color) {   
-    uint8_t old_color = display_get_bg_pixel_pal(x,y);  
-    floodFillScanline(x,y,color, old_color);
+    fill_region(x, y, color, NULL, 0, 0, 0, 0, 0, 0);
 }
 
 void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,  uint16_t color) {
@@ -9,6 +9,9 @@
 
 #define swap(x,y) { x = x + y; y = x - y; x = x - y; }
 
+void draw_set_clip(int16_t x, int16_t y, int16_t w, int16_t h);
+void drawPixel(int cx, int cy, uint8_t pal_idx);
+uint8_t getPixel(int cx, int cy);
 void plotQuadBezier(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t pal_idx);
 void plot_basic_bezier (int x0, int y0, int x1, int y1, int x2, int y2, uint8_t pal_idx);
 void fillRect(int16_t x, int16_t y, int16_t w, int16_t h,  uint16_t color);
@@ -23,6 +26,7 @@ void fillRoundRect(short x, short y, short w, short h, short r, unsigned short c
 void drawTriangle(short x0, short y0, short x1, short y1, short x2, short y2, unsigned short color);
 void fillTriangle ( short x0, short y0, short x1, short y1, short x2, short y2, unsigned short color);
 void fill(int16_t x, int16_t y, uint8_t color);
+void fill_region(int16_t x, int16_t y, uint8_t color, const uint8_t *pattern, uint16_t pw, uint16_t ph, int16_t cx, int16_t cy, int16_t cw, int16_t ch);
 void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
 void drawFastVLine(short x0, short y0, short h, short color);
 void drawLine_scanline(short x0, short y0,short x1, short y1,unsigned short color);
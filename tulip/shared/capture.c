@@ -0,0 +1,420 @@
+// capture.c
+// Screenshots and frame recording that don't stop scan-out.
+// At frame done we arm a spare frame buffer, and display_bounce_empty() copies each bounce buffer into it
+// as it's scanned out, starting from the top of the next frame. A capture task encodes finished frames
+// (PNG, BMP or RLE8 BMP) and the MP task writes them to disk, since the filesystem belongs to MicroPython.
+#include "capture.h"
+#include <inttypes.h>
+#include "tulip_helpers.h"
+#include "lodepng.h"
+#ifdef ESP_PLATFORM
+#include "tasks.h"
+#else
+#include <pthread.h>
+#endif
+
+#define CAPTURE_FRAME_BYTES (H_RES*V_RES)
+
+capture_slot_t capture_slots[CAPTURE_SLOTS];
+volatile int8_t capture_filling = -1;
+
+static volatile uint8_t capture_recording = 0;
+static volatile uint8_t capture_write_scheduled = 0;
+static uint8_t capture_task_running = 0;
+static char record_prefix[CAPTURE_FILENAME_LEN];
+static uint8_t record_format = CAPTURE_RLE;
+static uint32_t record_interval = 1;
+static int32_t record_next_vsync = 0;
+static uint32_t record_frames = 0;
+static uint32_t record_dropped = 0;
+
+static uint8_t capture_claim(capture_slot_t *s, uint8_t from, uint8_t to) {
+    uint8_t expected = from;
+    return __atomic_compare_exchange_n(&s->state, &expected, to, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void capture_set_state(capture_slot_t *s, uint8_t state) {
+    __atomic_store_n(&s->state, state, __ATOMIC_RELEASE);
+}
+
+static uint8_t capture_get_state(capture_slot_t *s) {
+    return __atomic_load_n(&s->state, __ATOMIC_ACQUIRE);
+}
+
+// -1 if we don't know the extension
+int8_t capture_format_for(const char *filename) {
+    uint16_t len = strlen(filename);
+    if(len < 4) return -1;
+    if(strcasecmp(filename + len - 4, ".png") == 0) return CAPTURE_PNG;
+    if(strcasecmp(filename + len - 4, ".bmp") == 0) return CAPTURE_BMP;
+    return -1;
+}
+
+
+// Encoders, run on the capture task
+
+uint32_t capture_encode_png(uint8_t *frame, uint8_t **out) {
+    uint8_t r,g,b,a;
+    LodePNGState state;
+    lodepng_state_init(&state);
+    a = 255; // todo, we could use BG alpha colors? but it doesn't matter
+    for(uint16_t i=0;i<256;i++) {
+        unpack_pal_idx(i, &r, &g, &b);
+        // You make the same entry in both the input image and the output image
+        lodepng_palette_add(&state.info_png.color, r,g,b,a);
+        lodepng_palette_add(&state.info_raw, r,g,b,a);
+    }
+    state.info_png.color.colortype = LCT_PALETTE;
+    state.info_png.color.bitdepth = 8;
+    state.info_raw.colortype = LCT_PALETTE;
+    state.info_raw.bitdepth = 8;
+    state.encoder.auto_convert = 0;
+
+    size_t outsize = 0;
+    unsigned err = lodepng_encode(out, &outsize, frame, H_RES, V_RES, &state);
+    lodepng_state_cleanup(&state);
+    if(err) {
+        fprintf(stderr, "capture: png encode error %u: %s\n", err, lodepng_error_text(err));
+        *out = NULL;
+        return 0;
+    }
+    return outsize;
+}
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+static void put_u32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+
+// BI_RLE8: runs of 3 or more are (count, value), anything else goes out in absolute mode (0, count, bytes, pad to 16 bits)
+static uint8_t *rle8_row(const uint8_t *row, uint16_t w, uint8_t *p) {
+    uint16_t i = 0;
+    while(i < w) {
+        uint16_t run = 1;
+        while(i+run < w && run < 255 && row[i+run] == row[i]) run++;
+        if(run >= 3) {
+            *p++ = run; *p++ = row[i];
+            i += run;
+            continue;
+        }
+        uint16_t j = i;
+        while(j < w && j-i < 255) {
+            if(j+2 < w && row[j] == row[j+1] && row[j] == row[j+2]) break;
+            j++;
+        }
+        uint16_t n = j - i;
+        if(n < 3) {
+            // absolute mode needs at least 3
+            for(uint16_t k=0;k<n;k++) { *p++ = 1; *p++ = row[i+k]; }
+        } else {
+            *p++ = 0; *p++ = n;
+            memcpy(p, row+i, n);
+            p += n;
+            if(n & 1) *p++ = 0;
+        }
+        i = j;
+    }
+    *p++ = 0; *p++ = 0; // end of line
+    return p;
+}
+
+static uint32_t capture_encode_bmp(uint8_t *frame, uint8_t rle, uint8_t **out) {
+    uint32_t header = 14 + 40 + 256*4;
+    uint32_t stride = (H_RES + 3) & ~3;
+    uint32_t max_len = header + (rle ? V_RES*(2*H_RES+2) + 2 : V_RES*stride);
+    uint8_t *o = (uint8_t*)malloc_caps(max_len, MALLOC_CAP_SPIRAM);
+    *out = o;
+    if(o == NULL) return 0;
+    uint8_t *p = o + header;
+    // BMP rows go bottom up
+    for(int16_t y=V_RES-1;y>=0;y--) {
+        uint8_t *row = frame + y*H_RES;
+        if(rle) {
+            p = rle8_row(row, H_RES, p);
+        } else {
+            memcpy(p, row, H_RES);
+            memset(p + H_RES, 0, stride - H_RES);
+            p += stride;
+        }
+    }
+    if(rle) { *p++ = 0; *p++ = 1; } // end of bitmap
+    uint32_t len = p - o;
+
+    o[0] = 'B'; o[1] = 'M';
+    put_u32(o+2, len);
+    put_u32(o+6, 0);
+    put_u32(o+10, header);
+    put_u32(o+14, 40);
+    put_u32(o+18, H_RES);
+    put_u32(o+22, V_RES);
+    put_u16(o+26, 1);
+    put_u16(o+28, 8);
+    put_u32(o+30, rle ? 1 : 0); // BI_RLE8 : BI_RGB
+    put_u32(o+34, len - header);
+    put_u32(o+38, 2835); // 72 DPI
+    put_u32(o+42, 2835);
+    put_u32(o+46, 256);
+    put_u32(o+50, 0);
+    for(uint16_t i=0;i<256;i++) {
+        uint8_t r,g,b;
+        unpack_pal_idx(i, &r, &g, &b);
+        o[54+i*4+0] = b; o[54+i*4+1] = g; o[54+i*4+2] = r; o[54+i*4+3] = 0;
+    }
+    return len;
+}
+
+
+// The MP side: write whatever is encoded. Scheduled by the capture task.
+
+STATIC mp_obj_t capture_write(mp_obj_t arg) {
+    capture_write_scheduled = 0;
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        capture_slot_t *s = &capture_slots[i];
+        if(capture_get_state(s) != CAPTURE_SLOT_ENCODED) continue;
+        if(s->out != NULL) {
+            char fn[CAPTURE_FILENAME_LEN + 16];
+            if(s->filename[0]) {
+                strcpy(fn, s->filename);
+            } else {
+                snprintf(fn, sizeof(fn), "%s%05" PRIu32 ".%s", record_prefix, s->frame_no, s->format == CAPTURE_PNG ? "png" : "bmp");
+            }
+            // A bad path shouldn't leave the slot stuck, so catch it here and carry on
+            nlr_buf_t nlr;
+            if(nlr_push(&nlr) == 0) {
+                write_file(fn, s->out, s->out_len, 1);
+                nlr_pop();
+            } else {
+                fprintf(stderr, "capture: could not write %s\n", fn);
+            }
+            free_caps(s->out);
+            s->out = NULL;
+        }
+        // Keep the frame buffers around while recording
+        if(!capture_recording) {
+            free_caps(s->frame);
+            s->frame = NULL;
+        }
+        capture_set_state(s, CAPTURE_SLOT_FREE);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(capture_write_obj, capture_write);
+
+static void capture_loop() {
+    while(1) {
+        uint8_t encoded = 0;
+        for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+            capture_slot_t *s = &capture_slots[i];
+            if(s->format >= CAPTURE_PEEK) continue;
+            if(!capture_claim(s, CAPTURE_SLOT_READY, CAPTURE_SLOT_ENCODING)) continue;
+            if(s->format == CAPTURE_PNG) {
+                s->out_len = capture_encode_png(s->frame, &s->out);
+            } else {
+                s->out_len = capture_encode_bmp(s->frame, s->format == CAPTURE_RLE, &s->out);
+            }
+            if(s->out == NULL) fprintf(stderr, "capture: could not encode frame\n");
+            capture_set_state(s, CAPTURE_SLOT_ENCODED);
+            encoded = 1;
+        }
+        if(!capture_write_scheduled) {
+            for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+                if(capture_get_state(&capture_slots[i]) == CAPTURE_SLOT_ENCODED) {
+                    if(mp_sched_schedule(MP_OBJ_FROM_PTR(&capture_write_obj), mp_const_none)) capture_write_scheduled = 1;
+                    break;
+                }
+            }
+        }
+        if(!encoded) delay_ms(10);
+    }
+}
+
+#ifdef ESP_PLATFORM
+static void capture_task(void *arg) {
+    capture_loop();
+}
+#else
+static void *capture_task(void *arg) {
+    capture_loop();
+    return NULL;
+}
+#endif
+
+static void capture_start_task() {
+    if(capture_task_running) return;
+    capture_task_running = 1;
+#ifdef ESP_PLATFORM
+    xTaskCreatePinnedToCore(&capture_task, CAPTURE_TASK_NAME, CAPTURE_TASK_STACK_SIZE, NULL, CAPTURE_TASK_PRIORITY, &capture_handle, CAPTURE_TASK_COREID);
+#else
+    pthread_t thread_id;
+    pthread_create(&thread_id, NULL, capture_task, NULL);
+#endif
+}
+
+// Claims a free slot and makes sure it has a frame buffer. Leaves it BUSY
+static capture_slot_t *capture_claim_free() {
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        capture_slot_t *s = &capture_slots[i];
+        if(!capture_claim(s, CAPTURE_SLOT_FREE, CAPTURE_SLOT_BUSY)) continue;
+        if(s->frame == NULL) s->frame = (uint8_t*)malloc_caps(CAPTURE_FRAME_BYTES, MALLOC_CAP_SPIRAM);
+        if(s->frame == NULL) {
+            capture_set_state(s, CAPTURE_SLOT_FREE);
+            return NULL;
+        }
+        return s;
+    }
+    return NULL;
+}
+
+// Asks for the next frame to be written to filename. Returns 0 if there's no free slot or no RAM for one
+uint8_t capture_request(const char *filename, uint8_t format) {
+    capture_slot_t *s = capture_claim_free();
+    if(s == NULL) return 0;
+    strncpy(s->filename, filename, CAPTURE_FILENAME_LEN-1);
+    s->filename[CAPTURE_FILENAME_LEN-1] = 0;
+    s->format = format;
+    capture_start_task();
+    capture_set_state(s, CAPTURE_SLOT_WANTED);
+    return 1;
+}
+
+// Screenshots asked for but not yet written
+uint8_t capture_pending() {
+    uint8_t n = 0;
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        uint8_t state = capture_get_state(&capture_slots[i]);
+        if(state != CAPTURE_SLOT_FREE && capture_slots[i].filename[0]) n++;
+    }
+    return n;
+}
+
+// Asks for the next frame to be copied for the MP task, without encoding it. Returns the slot, or -1 if there's
+// no free slot or no RAM for one. Poll capture_peek_frame() until it's there, then capture_peek_release() it
+int8_t capture_peek_request() {
+    capture_slot_t *s = capture_claim_free();
+    if(s == NULL) return -1;
+    s->filename[0] = 0;
+    s->format = CAPTURE_PEEK;
+    capture_set_state(s, CAPTURE_SLOT_WANTED);
+    return s - capture_slots;
+}
+
+// The peeked frame once a whole one has been copied, NULL until then
+uint8_t *capture_peek_frame(int8_t slot) {
+    capture_slot_t *s = &capture_slots[slot];
+    if(capture_get_state(s) != CAPTURE_SLOT_READY) return NULL;
+    return s->frame;
+}
+
+// Done with a peek, whether or not it was filled. If the display side is still filling it, it lets it go when it's done
+void capture_peek_release(int8_t slot) {
+    capture_slot_t *s = &capture_slots[slot];
+    if(!capture_claim(s, CAPTURE_SLOT_READY, CAPTURE_SLOT_BUSY) && !capture_claim(s, CAPTURE_SLOT_WANTED, CAPTURE_SLOT_BUSY)) {
+        __atomic_store_n(&s->format, CAPTURE_DROP, __ATOMIC_RELEASE);
+        // It may have been filled before it saw that
+        if(!capture_claim(s, CAPTURE_SLOT_READY, CAPTURE_SLOT_BUSY)) return;
+    }
+    if(!capture_recording) {
+        free_caps(s->frame);
+        s->frame = NULL;
+    }
+    capture_set_state(s, CAPTURE_SLOT_FREE);
+}
+
+// Records every (display fps / fps)th frame to prefix00000.bmp, prefix00001.bmp ...
+uint8_t capture_record_start(const char *prefix, float fps, uint8_t format) {
+    if(capture_recording) return 0;
+    uint8_t slots = 0;
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        capture_slot_t *s = capture_claim_free();
+        if(s == NULL) break;
+        s->filename[0] = 0;
+        slots++;
+    }
+    // Let them all go again, they keep their frame buffers
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        capture_slot_t *s = &capture_slots[i];
+        if(capture_get_state(s) == CAPTURE_SLOT_BUSY) capture_set_state(s, CAPTURE_SLOT_FREE);
+    }
+    if(slots < 2) {
+        capture_record_stop(NULL, NULL);
+        return 0;
+    }
+    strncpy(record_prefix, prefix, CAPTURE_FILENAME_LEN-1);
+    record_prefix[CAPTURE_FILENAME_LEN-1] = 0;
+    float display_fps = reported_fps > 0 ? reported_fps : TARGET_DESKTOP_FPS;
+    record_interval = (fps > 0 && fps < display_fps) ? (uint32_t)(display_fps / fps + 0.5) : 1;
+    record_format = format;
+    record_frames = 0;
+    record_dropped = 0;
+    record_next_vsync = vsync_count;
+    capture_start_task();
+    capture_recording = 1;
+    return 1;
+}
+
+void capture_record_stop(uint32_t *frames, uint32_t *dropped) {
+    capture_recording = 0;
+    if(frames) *frames = record_frames;
+    if(dropped) *dropped = record_dropped;
+    // Free the idle buffers, the ones still in flight are freed once they're written
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        capture_slot_t *s = &capture_slots[i];
+        if(!capture_claim(s, CAPTURE_SLOT_FREE, CAPTURE_SLOT_BUSY)) continue;
+        if(s->frame != NULL) free_caps(s->frame);
+        s->frame = NULL;
+        capture_set_state(s, CAPTURE_SLOT_FREE);
+    }
+}
+
+
+// The display side. Both of these can be in an ISR
+
+// At frame done: arm a slot for the next frame if a screenshot is waiting or the recorder is due
+void capture_frame_done() {
+    if(capture_filling >= 0) return;
+    for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+        if(capture_claim(&capture_slots[i], CAPTURE_SLOT_WANTED, CAPTURE_SLOT_ARMED)) {
+            capture_filling = i;
+            return;
+        }
+    }
+    if(capture_recording && vsync_count - record_next_vsync >= 0) {
+        record_next_vsync = vsync_count + record_interval;
+        for(uint8_t i=0;i<CAPTURE_SLOTS;i++) {
+            capture_slot_t *s = &capture_slots[i];
+            if(s->frame == NULL) continue;
+            if(capture_claim(s, CAPTURE_SLOT_FREE, CAPTURE_SLOT_BUSY)) {
+                s->filename[0] = 0;
+                s->format = record_format;
+                s->frame_no = record_frames++;
+                capture_set_state(s, CAPTURE_SLOT_ARMED);
+                capture_filling = i;
+                return;
+            }
+        }
+        // encoding can't keep up
+        record_dropped++;
+    }
+}
+
+// From display_bounce_empty, after it's composited the bounce buffer
+void IRAM_ATTR capture_bounce(uint8_t *b, int pos_px, int len_bytes) {
+    capture_slot_t *s = &capture_slots[capture_filling];
+    uint32_t at = pos_px % CAPTURE_FRAME_BYTES;
+    if(s->state == CAPTURE_SLOT_ARMED) {
+        if(at != 0) return; // wait for the top of a frame
+        s->rows = 0;
+        s->state = CAPTURE_SLOT_FILLING;
+    }
+    if(s->frame == NULL) {
+        capture_set_state(s, CAPTURE_SLOT_FREE);
+        capture_filling = -1;
+        return;
+    }
+    if(at + len_bytes > CAPTURE_FRAME_BYTES) len_bytes = CAPTURE_FRAME_BYTES - at;
+    memcpy(s->frame + at, b, len_bytes);
+    s->rows += len_bytes / H_RES;
+    if(s->rows >= V_RES) {
+        // A dropped peek keeps its frame buffer for the next capture to use, or capture_record_stop() to free
+        capture_set_state(s, __atomic_load_n(&s->format, __ATOMIC_ACQUIRE) == CAPTURE_DROP ? CAPTURE_SLOT_FREE : CAPTURE_SLOT_READY);
+        capture_filling = -1;
+    }
+}
@@ -0,0 +1,58 @@
+// capture.h
+// screenshots and frame recording without stopping the display
+#ifndef __CAPTUREH
+#define __CAPTUREH
+
+#include "display.h"
+
+// Frame buffers we capture into. The recorder uses all of them so encoding can lag a frame or two behind
+#define CAPTURE_SLOTS 3
+#define CAPTURE_FILENAME_LEN 128
+
+enum {
+    CAPTURE_PNG = 0,    // palette PNG, slow to encode but small
+    CAPTURE_BMP,        // 8-bit palette BMP, uncompressed
+    CAPTURE_RLE,        // 8-bit palette BMP, RLE8 compressed. Fast, and good for mostly flat screens
+    CAPTURE_PEEK,       // not encoded or written, the MP task reads the frame itself
+    CAPTURE_DROP,       // a peek given up before it was filled, freed once it is
+};
+
+// A slot goes FREE -> WANTED (a screenshot asked for) -> ARMED (at frame done) -> FILLING (from the first bounce
+// of the next frame) -> READY (a whole frame copied) -> ENCODING -> ENCODED (on the capture task) -> written and FREE (on the MP task)
+enum {
+    CAPTURE_SLOT_FREE = 0,
+    CAPTURE_SLOT_WANTED,
+    CAPTURE_SLOT_ARMED,
+    CAPTURE_SLOT_FILLING,
+    CAPTURE_SLOT_READY,
+    CAPTURE_SLOT_ENCODING,
+    CAPTURE_SLOT_ENCODED,
+    CAPTURE_SLOT_BUSY,      // being set up or freed by the MP task
+};
+
+typedef struct {
+    uint8_t state;
+    uint8_t format;
+    uint8_t *frame;     // H_RES*V_RES RGB332, as scanned out
+    uint16_t rows;
+    uint32_t frame_no;  // recorder frames are named after this, screenshots have a filename
+    char filename[CAPTURE_FILENAME_LEN];
+    uint8_t *out;
+    uint32_t out_len;
+} capture_slot_t;
+
+extern volatile int8_t capture_filling;
+
+int8_t capture_format_for(const char *filename);
+uint8_t capture_request(const char *filename, uint8_t format);
+uint8_t capture_record_start(const char *prefix, float fps, uint8_t format);
+void capture_record_stop(uint32_t *frames, uint32_t *dropped);
+uint8_t capture_pending();
+int8_t capture_peek_request();
+uint8_t *capture_peek_frame(int8_t slot);
+void capture_peek_release(int8_t slot);
+void capture_frame_done();
+void capture_bounce(uint8_t *b, int pos_px, int len_bytes);
+uint32_t capture_encode_png(uint8_t *frame, uint8_t **out);
+
+#endif
@@ -0,0 +1,264 @@
+// collide.c
+// Collisions worked out from where sprites are, not from the compositor drawing them, so sprites that are off,
+// off screen or on a copper line with sprites hidden still collide. Each sprite keeps a 1 bit per pixel mask of
+// its opaque pixels (of the transformed sprite, if it has a transform) that's only rebuilt when its frame, size,
+// transform or sprite RAM changes. A hashed grid finds the pairs whose boxes could touch, and those masks are
+// ANDed 32 px at a time. Walls are BG colors: a sprite hits one when an opaque pixel is over one on the BG.
+#include "collide.h"
+#include "vector.h"
+#include <string.h>
+
+typedef struct {
+    uint32_t *bits;     // h rows of stride words. Bit i of a row is pixel i, bits past w are 0
+    uint32_t alloc;     // words
+    uint16_t stride, w, h;
+    uint8_t valid;
+    // what the mask was made from
+    uint32_t mem, version;
+    uint16_t sw, sh;
+    sprite_tf_t tf;
+    int32_t ox, oy;     // where the mask starts in a transformed sprite's box, if it's clipped
+} collide_bits_t;
+
+static collide_bits_t masks[SPRITES];
+static uint32_t sprite_ram_version = 1;
+static uint32_t collide_sprites = 0xffffffff;
+static uint32_t walls[8];   // bit per pal_idx
+static uint8_t walls_on = 0;
+static uint32_t grid[COLLIDE_GRID * COLLIDE_GRID];
+
+#define BG_W (H_RES+OFFSCREEN_X_PX)
+#define BG_H (V_RES+OFFSCREEN_Y_PX)
+
+// count 0 for no walls
+void collide_set_walls(const uint8_t *pal_idxes, uint16_t count) {
+    memset(walls, 0, sizeof(walls));
+    for(uint16_t i=0;i<count;i++) walls[pal_idxes[i] >> 5] |= 1u << (pal_idxes[i] & 31);
+    walls_on = count > 0;
+}
+
+// Bit per sprite that takes part, all of them to start with
+void collide_set_sprites(uint32_t mask) {
+    collide_sprites = mask;
+}
+
+uint32_t collide_get_sprites() {
+    return collide_sprites;
+}
+
+// Anything written to sprite RAM could be in a mask
+void collide_sprite_ram_changed() {
+    sprite_ram_version++;
+}
+
+static uint8_t bits_size(collide_bits_t *m, uint16_t w, uint16_t h) {
+    uint16_t stride = (w + 31) / 32;
+    uint32_t words = (uint32_t)stride * h;
+    if(words > m->alloc) {
+        if(m->bits != NULL) free_caps(m->bits);
+        m->bits = (uint32_t*)malloc_caps(words * sizeof(uint32_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        m->alloc = m->bits ? words : 0;
+        if(m->bits == NULL) return 0;
+    }
+    m->stride = stride;
+    m->w = w;
+    m->h = h;
+    memset(m->bits, 0, words * sizeof(uint32_t));
+    return 1;
+}
+
+static inline void bits_set(collide_bits_t *m, uint16_t x, uint16_t y) {
+    m->bits[y * m->stride + (x >> 5)] |= 1u << (x & 31);
+}
+
+// The mask of sprite s and where its top left lands. 0 if it has nothing to collide with
+static uint8_t collide_mask(uint8_t s, int16_t *x, int16_t *y) {
+    collide_bits_t *m = &masks[s];
+    if(vector_kind(s)) {
+        // Vector sprites are their box on screen from the last frame drawn
+        display_rect_t r;
+        if(!vector_bounds(s, &r)) return 0;
+        *x = r.x0;
+        *y = r.y0;
+        uint16_t w = r.x1 - r.x0 + 1, h = r.y1 - r.y0 + 1;
+        if(m->valid && m->mem == 0xffffffff && m->w == w && m->h == h) return 1;
+        m->valid = 0;
+        if(!bits_size(m, w, h)) return 0;
+        for(uint16_t j=0;j<h;j++) for(uint16_t i=0;i<w;i++) bits_set(m, i, j);
+        m->mem = 0xffffffff;
+        m->valid = 1;
+        return 1;
+    }
+    uint16_t sw = sprite_w_px[s], sh = sprite_h_px[s];
+    uint32_t mem = sprite_mem[s];
+    if(sw == 0 || sh == 0 || mem + (uint32_t)sw * sh > SPRITE_RAM_BYTES) return 0;
+    int32_t x0, y0, x1, y1, ox = 0, oy = 0;
+    display_sprite_bounds(s, &x0, &y0, &x1, &y1);
+    sprite_tf_t *tf = &sprite_tf[s];
+    uint16_t mw = sw, mh = sh;
+    if(tf->on) {
+        // A transformed box can be far bigger than the screen. Its mask stops a screen past each edge,
+        // so it stays a sane size, and only sprites further off than that miss it
+        int32_t cx0 = MAX(x0, -H_RES), cy0 = MAX(y0, -V_RES);
+        int32_t cx1 = MIN(x1, 2*H_RES-1), cy1 = MIN(y1, 2*V_RES-1);
+        if(cx1 < cx0 || cy1 < cy0) return 0;
+        ox = cx0 - x0;
+        oy = cy0 - y0;
+        mw = cx1 - cx0 + 1;
+        mh = cy1 - cy0 + 1;
+        x0 = cx0;
+        y0 = cy0;
+    }
+    *x = x0;
+    *y = y0;
+    if(m->valid && m->mem == mem && m->version == sprite_ram_version && m->sw == sw && m->sh == sh &&
+       m->tf.on == tf->on && (!tf->on || (memcmp(&m->tf, tf, sizeof(sprite_tf_t)) == 0 &&
+       m->ox == ox && m->oy == oy && m->w == mw && m->h == mh))) return 1;
+
+    m->valid = 0;
+    const uint8_t *data = &sprite_ram[mem];
+    if(!tf->on) {
+        if(!bits_size(m, sw, sh)) return 0;
+        for(uint16_t j=0;j<sh;j++) {
+            for(uint16_t i=0;i<sw;i++) if(*data++ != ALPHA) bits_set(m, i, j);
+        }
+    } else {
+        // The same inverse mapping sprite_affine_row draws with, with the sprite at 0,0
+        if(!bits_size(m, mw, mh)) return 0;
+        int32_t cx = sw << 15, cy = sh << 15;
+        int32_t bx0 = sw/2 - tf->bw/2 + ox, by0 = sh/2 - tf->bh/2 + oy;
+        for(uint16_t j=0;j<mh;j++) {
+            int32_t dx = (bx0 << 16) + 0x8000 - cx;
+            int32_t dy = ((by0 + j) << 16) + 0x8000 - cy;
+            int32_t u = (int32_t)(((int64_t)tf->a * dx + (int64_t)tf->b * dy) >> 16) + cx;
+            int32_t v = (int32_t)(((int64_t)tf->c * dx + (int64_t)tf->d * dy) >> 16) + cy;
+            for(uint16_t i=0;i<mw;i++, u += tf->a, v += tf->c) {
+                uint32_t su = (uint32_t)(u >> 16);
+                uint32_t sv = (uint32_t)(v >> 16);
+                if(su < sw && sv < sh && data[sv * sw + su] != ALPHA) bits_set(m, i, j);
+            }
+        }
+    }
+    m->mem = mem;
+    m->version = sprite_ram_version;
+    m->sw = sw;
+    m->sh = sh;
+    m->tf = *tf;
+    m->ox = ox;
+    m->oy = oy;
+    m->valid = 1;
+    return 1;
+}
+
+// 32 px of a mask row from px bit on, 0s past the end
+static inline uint32_t mask_word(const collide_bits_t *m, uint16_t row, int32_t bit) {
+    const uint32_t *r = m->bits + row * m->stride;
+    int32_t i = bit >> 5, sh = bit & 31;
+    uint32_t word = (i < m->stride) ? r[i] >> sh : 0;
+    if(sh && i + 1 < m->stride) word |= r[i+1] << (32 - sh);
+    return word;
+}
+
+static uint8_t masks_touch(uint8_t a, int16_t ax, int16_t ay, uint8_t b, int16_t bx, int16_t by) {
+    const collide_bits_t *ma = &masks[a], *mb = &masks[b];
+    int16_t x0 = MAX(ax, bx), y0 = MAX(ay, by);
+    int16_t x1 = MIN(ax + ma->w, bx + mb->w), y1 = MIN(ay + ma->h, by + mb->h);
+    if(x1 <= x0 || y1 <= y0) return 0;
+    for(int16_t y=y0;y<y1;y++) {
+        for(int16_t x=x0;x<x1;x+=32) {
+            uint32_t both = mask_word(ma, y - ay, x - ax) & mask_word(mb, y - by, x - bx);
+            if(x1 - x < 32) both &= (1u << (x1 - x)) - 1;
+            if(both) return 1;
+        }
+    }
+    return 0;
+}
+
+// The BG pixel under screen px x,y, through the scroll registers on visible lines
+static inline uint8_t bg_under(int16_t x, int16_t y) {
+    int32_t bx = x, by = y;
+    if(y >= 0 && y < V_RES) {
+        bx = (x_offsets[y] + x) % BG_W;
+        by = y_offsets[y];
+    }
+    if(bx < 0 || by < 0 || bx >= BG_W || by >= BG_H) return 0;
+    return bg[by * BG_W + bx];
+}
+
+static uint8_t mask_hits_wall(uint8_t s, int16_t sx, int16_t sy) {
+    const collide_bits_t *m = &masks[s];
+    for(uint16_t j=0;j<m->h;j++) {
+        const uint32_t *r = m->bits + j * m->stride;
+        for(uint16_t k=0;k<m->stride;k++) {
+            uint32_t word = r[k];
+            while(word) {
+                uint8_t bit = __builtin_ctz(word);
+                word &= word - 1;
+                uint8_t c = bg_under(sx + k*32 + bit, sy + j);
+                if(walls[c >> 5] & (1u << (c & 31))) return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static inline uint32_t cell(int16_t v) {
+    // arithmetic shift, so negative coordinates get their own cells too
+    return (uint32_t)(v >> COLLIDE_CELL_SHIFT) & (COLLIDE_GRID - 1);
+}
+
+// Fills result[COLLIDE_RESULT_WORDS] and returns how many pairs of sprites touch
+uint32_t collide_run(uint32_t *result) {
+    int16_t x[SPRITES], y[SPRITES];
+    uint32_t in = 0;
+    memset(result, 0, COLLIDE_RESULT_WORDS * sizeof(uint32_t));
+    memset(grid, 0, sizeof(grid));
+    if(sprite_ram == NULL) return 0;
+
+    // Broad phase: each sprite goes in every cell its box covers
+    for(uint8_t s=0;s<SPRITES;s++) {
+        if(!(collide_sprites & (1u << s)) || !collide_mask(s, &x[s], &y[s])) continue;
+        in |= 1u << s;
+        int16_t x1 = x[s] + masks[s].w - 1, y1 = y[s] + masks[s].h - 1;
+        uint16_t cw = MIN((x1 >> COLLIDE_CELL_SHIFT) - (x[s] >> COLLIDE_CELL_SHIFT) + 1, COLLIDE_GRID);
+        uint16_t ch = MIN((y1 >> COLLIDE_CELL_SHIFT) - (y[s] >> COLLIDE_CELL_SHIFT) + 1, COLLIDE_GRID);
+        for(uint16_t j=0;j<ch;j++) {
+            uint32_t row = ((cell(y[s]) + j) & (COLLIDE_GRID - 1)) * COLLIDE_GRID;
+            for(uint16_t i=0;i<cw;i++) grid[row + ((cell(x[s]) + i) & (COLLIDE_GRID - 1))] |= 1u << s;
+        }
+    }
+
+    // Narrow phase on the sprites that share a cell with a higher numbered one
+    uint32_t pairs = 0;
+    for(uint8_t a=0;a<SPRITES;a++) {
+        if(!(in & (1u << a))) continue;
+        uint32_t near = 0;
+        int16_t x1 = x[a] + masks[a].w - 1, y1 = y[a] + masks[a].h - 1;
+        uint16_t cw = MIN((x1 >> COLLIDE_CELL_SHIFT) - (x[a] >> COLLIDE_CELL_SHIFT) + 1, COLLIDE_GRID);
+        uint16_t ch = MIN((y1 >> COLLIDE_CELL_SHIFT) - (y[a] >> COLLIDE_CELL_SHIFT) + 1, COLLIDE_GRID);
+        for(uint16_t j=0;j<ch;j++) {
+            uint32_t row = ((cell(y[a]) + j) & (COLLIDE_GRID - 1)) * COLLIDE_GRID;
+            for(uint16_t i=0;i<cw;i++) near |= grid[row + ((cell(x[a]) + i) & (COLLIDE_GRID - 1))];
+        }
+        near &= ~((2u << a) - 1);
+        while(near) {
+            uint8_t b = __builtin_ctz(near);
+            near &= near - 1;
+            if(masks_touch(a, x[a], y[a], b, x[b], y[b])) {
+                result[a] |= 1u << b;
+                result[b] |= 1u << a;
+                pairs++;
+            }
+        }
+        if(walls_on && mask_hits_wall(a, x[a], y[a])) result[SPRITES] |= 1u << a;
+    }
+    return pairs;
+}
+
+// With the display stopped
+void collide_teardown() {
+    for(uint8_t s=0;s<SPRITES;s++) {
+        if(masks[s].bits != NULL) free_caps(masks[s].bits);
+    }
+    memset(masks, 0, sizeof(masks));
+}
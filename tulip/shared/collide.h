@@ -0,0 +1,22 @@
+// collide.h
+// sprite to sprite and sprite to BG wall collisions from sprite positions, independent of what's drawn
+#ifndef __COLLIDEH
+#define __COLLIDEH
+
+#include "display.h"
+#include "polyfills.h"
+
+// Broad phase grid cell size in px, and the cells are hashed into a COLLIDE_GRID x COLLIDE_GRID table
+#define COLLIDE_CELL_SHIFT 6
+#define COLLIDE_GRID 32
+// Words collide_run fills: one per sprite (bit b set if it touches sprite b), then one of sprites touching a wall
+#define COLLIDE_RESULT_WORDS (SPRITES+1)
+
+void collide_set_walls(const uint8_t *pal_idxes, uint16_t count);
+void collide_set_sprites(uint32_t mask);
+uint32_t collide_get_sprites();
+void collide_sprite_ram_changed();
+uint32_t collide_run(uint32_t *result);
+void collide_teardown();
+
+#endif
@@ -0,0 +1,101 @@
+// copper.c
+// A "copper list": a table of what to do differently on each scanline, for raster bars, split screens, water and
+// fades without touching bg. Python builds a whole table in one call and it goes live at the next frame done, so an
+// effect never shows half updated. display_bounce_empty() looks up each row it composites: a line can skip the TFB
+// or the sprites, and have its finished pixels run through one of COPPER_PALETTES remap tables. Lines can also set
+// their scroll registers when the table goes live, for a batch of bg_scroll changes that land on the same frame.
+#include "copper.h"
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+copper_line_t * volatile copper_front = NULL;
+uint8_t *copper_luts = NULL;
+static copper_line_t *copper_tables[2];
+static copper_scroll_t *copper_scroll = NULL; // [V_RES], for lines with COPPER_SCROLL in the pending table
+static copper_line_t *copper_pending = NULL;  // table to put up at frame done
+static uint8_t copper_pending_off = 0;
+
+// The MP task sets the pending table, frame done (an ISR on the ESP) swaps it in
+#ifdef ESP_PLATFORM
+static portMUX_TYPE copper_mux = portMUX_INITIALIZER_UNLOCKED;
+#define COPPER_LOCK() portENTER_CRITICAL_SAFE(&copper_mux)
+#define COPPER_UNLOCK() portEXIT_CRITICAL_SAFE(&copper_mux)
+#else
+#define COPPER_LOCK() mp_uint_t copper_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define COPPER_UNLOCK() MICROPY_END_ATOMIC_SECTION(copper_atomic)
+#endif
+
+void copper_init() {
+    copper_tables[0] = (copper_line_t*)malloc_caps(V_RES*sizeof(copper_line_t), MALLOC_CAP_INTERNAL);
+    copper_tables[1] = (copper_line_t*)malloc_caps(V_RES*sizeof(copper_line_t), MALLOC_CAP_INTERNAL);
+    copper_scroll = (copper_scroll_t*)malloc_caps(V_RES*sizeof(copper_scroll_t), MALLOC_CAP_INTERNAL);
+    copper_luts = (uint8_t*)malloc_caps(COPPER_PALETTES*256, MALLOC_CAP_INTERNAL);
+    copper_front = NULL;
+    copper_pending = NULL;
+    copper_pending_off = 0;
+    for(uint16_t i=0;i<COPPER_PALETTES*256;i++) copper_luts[i] = i & 0xff;
+}
+
+void copper_teardown() {
+    copper_front = NULL;
+    copper_pending = NULL;
+    free_caps(copper_tables[0]); copper_tables[0] = NULL;
+    free_caps(copper_tables[1]); copper_tables[1] = NULL;
+    free_caps(copper_scroll); copper_scroll = NULL;
+    free_caps(copper_luts); copper_luts = NULL;
+}
+
+// Copies lines (V_RES of them) into whichever table isn't showing. scroll is only read for lines with COPPER_SCROLL.
+// Calling this again before frame done replaces what was pending
+void copper_set(const copper_line_t *lines, const copper_scroll_t *scroll) {
+    COPPER_LOCK();
+    copper_line_t *t = (copper_front == copper_tables[0]) ? copper_tables[1] : copper_tables[0];
+    memcpy(t, lines, V_RES*sizeof(copper_line_t));
+    memcpy(copper_scroll, scroll, V_RES*sizeof(copper_scroll_t));
+    copper_pending = t;
+    copper_pending_off = 0;
+    COPPER_UNLOCK();
+}
+
+void copper_off() {
+    COPPER_LOCK();
+    copper_pending = NULL;
+    copper_pending_off = 1;
+    COPPER_UNLOCK();
+}
+
+// Takes effect right away. Use another palette number and a new table to change one in step with other lines
+void copper_palette(uint8_t n, const uint8_t *lut) {
+    if(n == 0 || n >= COPPER_PALETTES) return;
+    memcpy(copper_luts + n*256, lut, 256);
+    if(copper_front != NULL) display_dirty_all();
+}
+
+void copper_frame_done() {
+    uint8_t changed = 0;
+    COPPER_LOCK();
+    if(copper_pending != NULL) {
+        copper_line_t *t = copper_pending;
+        for(uint16_t y=0;y<V_RES;y++) {
+            if(t[y].flags & COPPER_SCROLL) {
+                x_offsets[y] = copper_scroll[y].x_offset;
+                y_offsets[y] = copper_scroll[y].y_offset;
+                x_speeds[y] = copper_scroll[y].x_speed;
+                y_speeds[y] = copper_scroll[y].y_speed;
+                display_bg_line_update(y);
+                t[y].flags &= ~COPPER_SCROLL;
+            }
+        }
+        copper_front = t;
+        copper_pending = NULL;
+        changed = 1;
+    } else if(copper_pending_off) {
+        copper_front = NULL;
+        copper_pending_off = 0;
+        changed = 1;
+    }
+    COPPER_UNLOCK();
+    if(changed) display_dirty_all();
+}
@@ -0,0 +1,38 @@
+// copper.h
+// per scanline raster effects: palette remaps, hiding layers and scroll changes, from a table
+#ifndef __COPPERH
+#define __COPPERH
+
+#include "display.h"
+#include "polyfills.h"
+
+// Remap tables python can fill. Table 0 is always "leave the line alone"
+#define COPPER_PALETTES 8
+
+// Per line flags
+#define COPPER_NO_TFB 1         // don't draw the TFB on this line
+#define COPPER_NO_SPRITES 2     // or the sprites
+#define COPPER_NO_TILES 4       // or the tile map layer
+#define COPPER_SCROLL 0x80      // set this line's scroll registers when the table goes live
+
+typedef struct {
+    uint8_t palette;
+    uint8_t flags;
+} copper_line_t;
+
+typedef struct {
+    int16_t x_offset, y_offset, x_speed, y_speed;
+} copper_scroll_t;
+
+// The table the compositor uses this frame, NULL when there isn't one
+extern copper_line_t * volatile copper_front;
+extern uint8_t *copper_luts; // [COPPER_PALETTES][256], pal_idx in -> pal_idx out
+
+void copper_init();
+void copper_teardown();
+void copper_set(const copper_line_t *lines, const copper_scroll_t *scroll);
+void copper_off();
+void copper_palette(uint8_t n, const uint8_t *lut);
+void copper_frame_done();
+
+#endif
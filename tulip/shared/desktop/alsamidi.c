@@ -0,0 +1,156 @@
+// alsamidi.c
+// MIDI for Tulip Desktop on Linux, on the ALSA sequencer. Tulip is a client called "Tulip" with one port that other
+// programs can connect to in both directions (aconnect, qjackctl, a DAW), and it connects itself to the hardware
+// MIDI ports that are there when it starts. Input has its own thread, at realtime priority if we're allowed it, and
+// each message is stamped with the AMY sysclock time ALSA saw it arrive, not when we got around to reading it.
+// Output can be scheduled for an AMY sysclock time and ALSA's queue sends it then.
+// To try it without any hardware, loop the port into itself with `aconnect Tulip:0 Tulip:0`: midi_out comes back
+// in through midi_in.
+#include "midi.h"
+#include <alsa/asoundlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+// NULL until the port is up, midi_out before then goes nowhere
+static snd_seq_t * volatile seq = NULL;
+static int port = -1;
+static int queue = -1;
+static snd_midi_event_t *encoder = NULL;
+// midi_out is called from python and the sequencer thread
+static pthread_mutex_t out_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t real_time_ms(const snd_seq_real_time_t *t) {
+    return (int64_t)t->tv_sec * 1000 + t->tv_nsec / 1000000;
+}
+
+// ms since our queue started, the clock input is timestamped with
+static int64_t queue_now_ms(snd_seq_t *s) {
+    snd_seq_queue_status_t *status;
+    snd_seq_queue_status_alloca(&status);
+    if(snd_seq_get_queue_status(s, queue, status) < 0) return 0;
+    return real_time_ms(snd_seq_queue_status_get_real_time(status));
+}
+
+static snd_seq_t *alsa_midi_open() {
+    snd_seq_t *s;
+    if(snd_seq_open(&s, "default", SND_SEQ_OPEN_DUPLEX, 0) < 0) {
+        fprintf(stderr, "No ALSA sequencer, MIDI is off\n");
+        return NULL;
+    }
+    snd_seq_set_client_name(s, "Tulip");
+    queue = snd_seq_alloc_named_queue(s, "Tulip");
+    snd_seq_port_info_t *pinfo;
+    snd_seq_port_info_alloca(&pinfo);
+    snd_seq_port_info_set_name(pinfo, "Tulip MIDI");
+    snd_seq_port_info_set_capability(pinfo, SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ |
+        SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE | SND_SEQ_PORT_CAP_DUPLEX);
+    snd_seq_port_info_set_type(pinfo, SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION);
+    // Have ALSA stamp everything delivered to us with the queue's real time
+    snd_seq_port_info_set_timestamping(pinfo, 1);
+    snd_seq_port_info_set_timestamp_real(pinfo, 1);
+    snd_seq_port_info_set_timestamp_queue(pinfo, queue);
+    if(queue < 0 || snd_seq_create_port(s, pinfo) < 0 || snd_midi_event_new(256, &encoder) < 0) {
+        fprintf(stderr, "Could not set up the ALSA MIDI port\n");
+        snd_seq_close(s);
+        return NULL;
+    }
+    port = snd_seq_port_info_get_port(pinfo);
+    snd_seq_start_queue(s, queue, NULL);
+    snd_seq_drain_output(s);
+    return s;
+}
+
+// Like macOS connecting to every source, but only real devices, so Midi Through and other apps don't loop back
+static void connect_hardware(snd_seq_t *s) {
+    snd_seq_client_info_t *cinfo;
+    snd_seq_port_info_t *pinfo;
+    snd_seq_client_info_alloca(&cinfo);
+    snd_seq_port_info_alloca(&pinfo);
+    int me = snd_seq_client_id(s);
+    snd_seq_client_info_set_client(cinfo, -1);
+    while(snd_seq_query_next_client(s, cinfo) >= 0) {
+        int client = snd_seq_client_info_get_client(cinfo);
+        if(client == SND_SEQ_CLIENT_SYSTEM || client == me) continue;
+        snd_seq_port_info_set_client(pinfo, client);
+        snd_seq_port_info_set_port(pinfo, -1);
+        while(snd_seq_query_next_port(s, pinfo) >= 0) {
+            if(!(snd_seq_port_info_get_type(pinfo) & SND_SEQ_PORT_TYPE_HARDWARE)) continue;
+            unsigned int caps = snd_seq_port_info_get_capability(pinfo);
+            int p = snd_seq_port_info_get_port(pinfo);
+            if((caps & SND_SEQ_PORT_CAP_SUBS_READ) && snd_seq_connect_from(s, port, client, p) == 0) {
+                fprintf(stderr, "MIDI in from %s\n", snd_seq_port_info_get_name(pinfo));
+            }
+            if((caps & SND_SEQ_PORT_CAP_SUBS_WRITE) && snd_seq_connect_to(s, port, client, p) == 0) {
+                fprintf(stderr, "MIDI out to %s\n", snd_seq_port_info_get_name(pinfo));
+            }
+        }
+    }
+}
+
+// Sends now if delay_ms <= 0, else has the queue send it that many ms from now
+static void alsa_midi_send(uint8_t * bytes, uint16_t len, int32_t delay_ms) {
+    snd_seq_t *s = seq;
+    if(s == NULL) return;
+    pthread_mutex_lock(&out_lock);
+    snd_midi_event_reset_encode(encoder);
+    uint16_t i = 0;
+    while(i < len) {
+        snd_seq_event_t ev;
+        snd_seq_ev_clear(&ev);
+        long used = snd_midi_event_encode(encoder, bytes + i, len - i, &ev);
+        if(used <= 0) break;
+        i += used;
+        if(ev.type == SND_SEQ_EVENT_NONE) continue; // not a whole message yet
+        snd_seq_ev_set_source(&ev, port);
+        snd_seq_ev_set_subs(&ev);
+        if(delay_ms > 0) {
+            snd_seq_real_time_t t = { (unsigned int)(delay_ms / 1000), (unsigned int)(delay_ms % 1000) * 1000000 };
+            snd_seq_ev_schedule_real(&ev, queue, 1, &t);
+        } else {
+            snd_seq_ev_set_direct(&ev);
+        }
+        snd_seq_event_output_direct(s, &ev);
+    }
+    pthread_mutex_unlock(&out_lock);
+}
+
+void midi_out(uint8_t * bytes, uint16_t len) {
+    alsa_midi_send(bytes, len, 0);
+}
+
+void midi_out_at(uint8_t * bytes, uint16_t len, int32_t sysclock) {
+    alsa_midi_send(bytes, len, sysclock - (int32_t)amy_sysclock());
+}
+
+// The MIDI input thread, started from main
+void *run_midi(void*vargp) {
+    snd_seq_t *s = alsa_midi_open();
+    if(s == NULL) return NULL;
+    connect_hardware(s);
+    seq = s;
+
+    // Needs rtprio (e.g. the audio group in limits.conf), it's fine to run without
+    struct sched_param param = { .sched_priority = sched_get_priority_min(SCHED_FIFO) + 10 };
+    if(pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        fprintf(stderr, "MIDI in is running without realtime priority\n");
+    }
+
+    snd_midi_event_t *decoder;
+    if(snd_midi_event_new(256, &decoder) < 0) return NULL;
+    // Every message gets its status byte, convert_midi_bytes_to_messages doesn't do running status across calls
+    snd_midi_event_no_status(decoder, 1);
+    uint8_t bytes[256];
+    while(1) {
+        snd_seq_event_t *ev = NULL;
+        // Blocks. Fails with -ENOSPC if we fell behind and ALSA dropped input, just carry on
+        if(snd_seq_event_input(s, &ev) < 0 || ev == NULL) continue;
+        long len = snd_midi_event_decode(decoder, bytes, sizeof(bytes), ev);
+        if(len <= 0) continue; // not MIDI, like port subscribe notices
+        int32_t sysclock = amy_sysclock();
+        if(snd_seq_ev_is_real(ev) && ev->queue == queue) {
+            sysclock -= (int32_t)(queue_now_ms(s) - real_time_ms(&ev->time.time));
+        }
+        convert_midi_bytes_to_messages_at(bytes, len, sysclock);
+    }
+    return NULL;
+}
@@ -0,0 +1,89 @@
+// headless_display.c
+// Tulip Desktop without a window or a sound device, for benchmarks and regression runs.
+// Frames are composited into memory exactly like the SDL path does, and AMY blocks are rendered
+// per frame (1/fps of audio each) into an optional WAV file, so a run is repeatable.
+// Pass -H to tulip to use it. With -S frames only advance when python calls tulip.frame_step().
+#include "polyfills.h"
+#include "display.h"
+#include "alles.h"
+
+uint8_t headless = 0;
+uint8_t headless_step = 0;
+float headless_fps = TARGET_DESKTOP_FPS; // 0 is as fast as possible
+char * headless_wav_fn = NULL;
+
+static uint8_t *headless_bb = NULL;
+static FILE *headless_wav = NULL;
+static uint32_t headless_wav_bytes = 0;
+static float headless_samples_due = 0;
+static uint8_t headless_audio_ready = 0;
+
+static void wav_write_u32(uint8_t *p, uint32_t v) { p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24; }
+static void wav_write_u16(uint8_t *p, uint16_t v) { p[0] = v; p[1] = v >> 8; }
+
+static void headless_wav_header(uint32_t data_bytes) {
+    uint8_t h[44];
+    memcpy(h, "RIFF", 4); wav_write_u32(h+4, 36 + data_bytes);
+    memcpy(h+8, "WAVEfmt ", 8); wav_write_u32(h+16, 16);
+    wav_write_u16(h+20, 1); // PCM
+    wav_write_u16(h+22, AMY_NCHANS);
+    wav_write_u32(h+24, AMY_SAMPLE_RATE);
+    wav_write_u32(h+28, AMY_SAMPLE_RATE * AMY_NCHANS * sizeof(int16_t));
+    wav_write_u16(h+32, AMY_NCHANS * sizeof(int16_t));
+    wav_write_u16(h+34, 16);
+    memcpy(h+36, "data", 4); wav_write_u32(h+40, data_bytes);
+    fseek(headless_wav, 0, SEEK_SET);
+    fwrite(h, 1, 44, headless_wav);
+}
+
+// Called from unix_amy_init once AMY is started
+void headless_audio_init() {
+    headless_audio_ready = 1;
+    if(headless_wav_fn == NULL) return;
+    headless_wav = fopen(headless_wav_fn, "wb");
+    if(headless_wav == NULL) {
+        fprintf(stderr, "could not open %s for audio output\n", headless_wav_fn);
+        return;
+    }
+    headless_wav_header(0);
+}
+
+void headless_audio_close() {
+    if(headless_wav == NULL) return;
+    headless_wav_header(headless_wav_bytes);
+    fclose(headless_wav);
+    headless_wav = NULL;
+}
+
+// Render however many AMY blocks cover this many seconds, carrying the remainder to the next call
+static void headless_render_audio(float seconds) {
+    if(!headless_audio_ready) return;
+    headless_samples_due += seconds * AMY_SAMPLE_RATE;
+    while(headless_samples_due >= AMY_BLOCK_SIZE) {
+        int16_t *block = alles_render_block();
+        if(headless_wav) {
+            headless_wav_bytes += fwrite(block, sizeof(int16_t), AMY_BLOCK_SIZE * AMY_NCHANS, headless_wav) * sizeof(int16_t);
+        }
+        headless_samples_due -= AMY_BLOCK_SIZE;
+    }
+}
+
+void headless_display_init() {
+    display_init();
+    reported_fps = headless_fps > 0 ? headless_fps : TARGET_DESKTOP_FPS;
+    headless_bb = (uint8_t *) malloc_caps(FONT_HEIGHT*H_RES*BYTES_PER_PIXEL, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+}
+
+// One frame: composite every bounce, run the frame done logic, then render this frame's audio.
+// Returns the ms it took, like unix_display_draw(), but on the wall clock: the AMY clock is the audio we've rendered
+int headless_display_draw() {
+    int64_t tic = get_time_ms();
+    display_frame_start();
+    for(uint16_t y=0;y+FONT_HEIGHT<=V_RES;y=y+FONT_HEIGHT) {
+        display_bounce_empty(headless_bb, y*H_RES, H_RES*FONT_HEIGHT*BYTES_PER_PIXEL, NULL);
+    }
+    display_frame_done_generic();
+    // Audio always advances by one frame's worth at the nominal rate, even when running unpaced
+    headless_render_audio(1.0 / (headless_fps > 0 ? headless_fps : TARGET_DESKTOP_FPS));
+    return get_time_ms() - tic;
+}
@@ -4,6 +4,7 @@
 #include "display.h"
 #include "keyscan.h"
 #include "ui.h"
+#include "gesture.h"
 #include "lvgl.h"
 SDL_Window *window;
 SDL_Surface *window_surface;
@@ -13,6 +14,8 @@ SDL_Rect viewport;
 SDL_Rect tulip_rect;
 SDL_Texture *framebuffer;
 uint8_t *frame_bb;
+uint8_t *frame_last; // RGB332 copy of what's in the texture
+uint32_t rgb332_argb[256];
 #define BYTES_PER_PIXEL 1
 int64_t frame_ticks = 0;
 int8_t unix_display_flag = 0;
@@ -33,36 +36,7 @@ void destroy_window();
 void unix_display_init();
 
 
-// LVGL/SDL connectors for keyboard here
-
-#define KEYBOARD_BUFFER_SIZE SDL_TEXTINPUTEVENT_TEXT_SIZE
-
-static char lvgl_kb_buf[KEYBOARD_BUFFER_SIZE];
-
-
-void lvgl_keyboard_read(lv_indev_t * indev_drv, lv_indev_data_t * data)
-{
-    (void) indev_drv;      /*Unused*/
-
-    static bool dummy_read = false;
-    const size_t len = strlen(lvgl_kb_buf);
-
-    /*Send a release manually*/
-    if (dummy_read) {
-        dummy_read = false;
-        data->state = LV_INDEV_STATE_RELEASED;
-        data->continue_reading = len > 0;
-    }
-        /*Send the pressed character*/
-    else if (len > 0) {
-        dummy_read = true;
-        data->state = LV_INDEV_STATE_PRESSED;
-        data->key = lvgl_kb_buf[0];
-        memmove(lvgl_kb_buf, lvgl_kb_buf + 1, len);
-        data->continue_reading = true;
-    }
-}
-
+// LVGL/SDL connectors for keyboard here. lvgl_keyboard_read is in keyscan.c
 
 /**
  * Convert a SDL key code to it's LV_KEY_* counterpart or return '\0' if it's not a control character.
@@ -143,11 +117,9 @@ int8_t compute_viewport(uint16_t tw, uint16_t th, int8_t resize_tulip) {
     // Adjust y for bezels
     viewport.y = 0;
     if(resize_tulip) {
-        // given the sw / sh, find a better H_RES/tw than what we have. 
+        // H_RES and V_RES are fixed when Tulip is built (make TULIP_RES=WxH), so this only changes the texture size
         tulip_rect.w = (int)((float)sw / viewport_scale);
         tulip_rect.h = (int)((float)sh / viewport_scale); 
-        //H_RES = tulip_rect.w;
-        //V_RES = tulip_rect.h;
     } else {
         // just keep it
     }
@@ -171,35 +143,59 @@ int unix_display_draw() {
     check_key();
 
     frame_ticks = get_ticks_ms();
+    display_frame_start();
 
-
-
-    uint8_t *pixels;
-    int pitch;
-    SDL_LockTexture(framebuffer, NULL, (void**)&pixels, &pitch);
-    // bounce the entire screen at once to the ARGB8888 color framebuffer
+    // Only convert and upload what changed. The dirty rects cover LVGL, the TFB, sprites and scrolling,
+    // comparing against frame_last catches anything drawn straight into bg
+    display_rect_t dirty[DIRTY_RECTS];
+    uint16_t dirty_n = display_dirty_take(dirty);
     for(uint16_t y=0;y<V_RES;y=y+FONT_HEIGHT) {
         if(y+FONT_HEIGHT <= V_RES) {
             display_bounce_empty(frame_bb, y*H_RES, H_RES*FONT_HEIGHT, NULL);
-            for (uint16_t row=0;row<FONT_HEIGHT;row++) {
-                for(uint16_t x=0;x<H_RES*4;x=x+4) {
-                    uint8_t r,g,b;
-                    unpack_rgb_332_repeat(frame_bb[H_RES*row + (x/4)], &r, &g, &b);
-                    pixels[((y+row)*pitch)+x+0] = b;
-                    pixels[((y+row)*pitch)+x+1] = g;
-                    pixels[((y+row)*pitch)+x+2] = r;
-                    pixels[((y+row)*pitch)+x+3] = 0;
+            uint8_t *last = frame_last + y*H_RES;
+            int16_t x0 = H_RES;
+            int16_t x1 = -1;
+            if(dirty_n == DIRTY_ALL) {
+                x0 = 0; x1 = H_RES-1;
+            } else {
+                for(uint16_t i=0;i<dirty_n;i++) {
+                    if(dirty[i].y0 < y+FONT_HEIGHT && dirty[i].y1 >= y) {
+                        x0 = MIN(x0, dirty[i].x0);
+                        x1 = MAX(x1, dirty[i].x1);
+                    }
+                }
+                if((x0 > 0 || x1 < H_RES-1) && memcmp(frame_bb, last, H_RES*FONT_HEIGHT)) {
+                    for (uint16_t row=0;row<FONT_HEIGHT;row++) {
+                        uint8_t *a = frame_bb + H_RES*row;
+                        uint8_t *b = last + H_RES*row;
+                        if(!memcmp(a, b, H_RES)) continue;
+                        int16_t l = 0, r = H_RES-1;
+                        while(a[l] == b[l]) l++;
+                        while(a[r] == b[r]) r--;
+                        x0 = MIN(x0, l);
+                        x1 = MAX(x1, r);
+                    }
                 }
             }
+            if(x1 < x0) continue;
+
+            uint8_t *pixels;
+            int pitch;
+            SDL_Rect band = { x0, y, x1 - x0 + 1, FONT_HEIGHT };
+            SDL_LockTexture(framebuffer, &band, (void**)&pixels, &pitch);
+            for (uint16_t row=0;row<FONT_HEIGHT;row++) {
+                uint32_t *dst = (uint32_t*)(pixels + row*pitch);
+                uint8_t *src = frame_bb + H_RES*row + x0;
+                for(uint16_t x=0;x<band.w;x++) dst[x] = rgb332_argb[src[x]];
+            }
+            SDL_UnlockTexture(framebuffer);
+            memcpy(last, frame_bb, H_RES*FONT_HEIGHT);
         }
     }
 
-
     // Copy the framebuffer (and stretch if needed into the renderer)
     SDL_RenderCopy(default_renderer, framebuffer, &tulip_rect, &viewport);
 
-    SDL_UnlockTexture(framebuffer);
-
     SDL_RenderPresent(default_renderer);
 
 
@@ -250,6 +246,7 @@ void init_window() {
 
 void destroy_window() {
     free_caps(frame_bb);
+    free_caps(frame_last);
     SDL_DestroyTexture(framebuffer);
     SDL_DestroyRenderer(default_renderer);
     SDL_DestroyWindow(window);
@@ -268,14 +265,10 @@ void check_key() {
         if (e.type == SDL_QUIT) {
             unix_display_flag = -1; // tell main to quit
         } else if(e.type == SDL_TEXTINPUT) {
-            // lvgl stuff
-           const size_t len = strlen(lvgl_kb_buf) + strlen(e.text.text);
-           if (len < KEYBOARD_BUFFER_SIZE - 1)
-                strcat(lvgl_kb_buf, e.text.text);
-
             // In SDL all non ascii stuff only comes in through textinput                    
             uint8_t start = 0;
             while(e.text.text[start] != 0) {
+                lvgl_key_put((uint8_t) e.text.text[start]);
                 send_key_to_micropython((uint8_t) e.text.text[start] & 0xff);
                 start++;
             }
@@ -283,26 +276,27 @@ void check_key() {
         } else if(e.type == SDL_KEYDOWN) {
             // do LVGL stuff first
             const uint32_t ctrl_key = keycode_to_ctrl_key(e.key.keysym.sym);
-            if (ctrl_key == '\0') {
-                // do nothing?
-            } else {
-                const size_t len = strlen(lvgl_kb_buf);
-                if (len < KEYBOARD_BUFFER_SIZE - 1) {
-                    lvgl_kb_buf[len] = ctrl_key;
-                    lvgl_kb_buf[len + 1] = '\0';
-                }
+            if (ctrl_key != '\0') {
+                lvgl_key_put(ctrl_key);
             }
 
 
             last_held_mod = SDL_GetModState();
             SDL_KeyboardEvent key = e.key; 
+            // SDL scancodes are the USB HID ones, and SDL does the key repeat
+            uint16_t ascii_key = 0;
+            uint8_t scanned = 0;
             if(key.keysym.scancode == 225 || key.keysym.scancode == 229) {
             } else if(key.keysym.scancode >= 0x04 && key.keysym.scancode <= 0x94) {
-                uint16_t ascii_key = scan_ascii(key.keysym.scancode, (uint32_t)(last_held_mod | store_mod));
-                if(ascii_key < 32 || ascii_key > 255) {
-                    send_key_to_micropython(ascii_key);
-                    store_mod = 0;
-                }
+                ascii_key = scan_ascii(key.keysym.scancode, (uint32_t)(last_held_mod | store_mod));
+                scanned = 1;
+            }
+            if(key.keysym.scancode < 256) {
+                key_event(key.repeat ? KEY_EVENT_REPEAT : KEY_EVENT_DOWN, key.keysym.scancode, ascii_key);
+            }
+            if(scanned && (ascii_key < 32 || ascii_key > 255)) {
+                send_key_to_micropython(ascii_key);
+                store_mod = 0;
             }
             uint8_t skip = 0;
             uint8_t pos = 10;
@@ -327,6 +321,7 @@ void check_key() {
             }
         } else if(e.type == SDL_KEYUP) {
             SDL_KeyboardEvent key = e.key; 
+            if(key.keysym.scancode < 256) key_event(KEY_EVENT_UP, key.keysym.scancode, 0);
             for(uint8_t i=2;i<8;i++) {
                 if(key.keysym.scancode == last_scan[i]) {
                     last_scan[i] = 0;
@@ -349,6 +344,7 @@ void check_key() {
         send_touch_to_micropython(last_touch_x[0], last_touch_y[0], was_touch-1);
     }
 #endif
+    gesture_poll();
 }
 
 
@@ -382,6 +378,12 @@ void unix_display_init() {
     SDL_StartTextInput();
 
     frame_bb = (uint8_t *) malloc_caps(FONT_HEIGHT*H_RES*BYTES_PER_PIXEL,MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    frame_last = (uint8_t *) malloc_caps(H_RES*V_RES*BYTES_PER_PIXEL,MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    for(uint16_t i=0;i<256;i++) {
+        uint8_t r,g,b;
+        unpack_rgb_332_repeat(i, &r, &g, &b);
+        rgb332_argb[i] = (r << 16) | (g << 8) | b;
+    }
     SDL_StartTextInput();
 
 
@@ -56,6 +56,7 @@ void display_tfb_update(int8_t tfb_row_hint);
 void display_set_clock(uint8_t mhz) ;
 uint8_t lvgl_focused();
 
+void display_clear_bg(uint8_t pal_idx);
 void display_set_bg_pixel_pal(uint16_t x, uint16_t y, uint8_t pal_idx);
 void display_set_bg_pixel(uint16_t x, uint16_t y, uint8_t r, uint8_t g, uint8_t b);
 void display_get_bg_pixel(uint16_t x, uint16_t y, uint8_t *r, uint8_t *g, uint8_t *b);
@@ -70,8 +71,14 @@ void display_bg_bitmap_blit_alpha(uint16_t x,uint16_t y,uint16_t w,uint16_t h,ui
 
 void display_load_sprite_rgba(uint32_t mem_pos, uint32_t len, uint8_t* data);
 void display_load_sprite_raw(uint32_t mem_pos, uint32_t len, uint8_t* data);
+void display_sprite_transform(uint8_t s, float scale_x, float scale_y, float degrees, uint8_t flip);
+void display_sprite_bounds(uint8_t s, int32_t *x0, int32_t *y0, int32_t *x1, int32_t *y1);
 void display_screenshot(char * filename);
 void display_screenshot_pal(char * filename);
+uint32_t display_hash_frame(uint8_t *frame);
+#ifdef TULIP_DESKTOP
+uint32_t display_frame_hash();
+#endif
 void display_tfb_str(unsigned char*str, uint16_t len, uint8_t format, uint8_t fg_color, uint8_t bg_color);
 
 void display_tfb_new_row();
@@ -84,17 +91,33 @@ void unpack_pal_idx(uint16_t pal_idx, uint8_t *r, uint8_t *g, uint8_t *b);
 void unpack_ansi_idx(uint8_t ansi_idx, uint8_t *r, uint8_t *g, uint8_t *b);
 bool display_bounce_empty(void *bounce_buf, int pos_px, int len_bytes, void *user_ctx);
 bool display_frame_done_generic();
+void display_frame_start();
+void display_bg_line_update(uint16_t y);
 void display_swap();
 uint8_t rgb565to332(uint16_t rgb565);
 void display_teardown(void);
 
 uint8_t check_dim_xy(uint16_t x, uint16_t y);
 uint8_t check_dim_xywh(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+uint8_t color_332(uint8_t red, uint8_t green, uint8_t blue);
 uint8_t collide_mask_get(uint8_t a, uint8_t b);
 
+// Screen areas that changed since the last display_dirty_take(), for anything that wants to convert, upload or send
+// only what changed. LVGL's flushed areas, TFB rows, sprites and scrolling land here. Python drawing straight into bg
+// doesn't, so a consumer that has to be exact should still compare what it has against what it composites.
+#define DIRTY_RECTS 16
+#define DIRTY_ALL 0xffff
+typedef struct {
+    int16_t x0, y0, x1, y1; // screen px, inclusive
+} display_rect_t;
+void display_dirty_add(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+void display_dirty_all();
+uint16_t display_dirty_take(display_rect_t *rects);
+
 extern const unsigned char font_8x12_r[256][12];
 extern const unsigned char portfolio_glyph_bitmap[1792];
 
+// Most scanline spans the vector sprites can bin in a frame, see vector.h
 #define MAX_LINE_EMITS 60000
 
 // We can address this many moving things on screen
@@ -102,12 +125,21 @@ extern const unsigned char portfolio_glyph_bitmap[1792];
 // We assume we can store 16 unique 32x32 sprite tiles, you can swap these out from RAM
 #define SPRITE_RAM_BYTES (32*32*SPRITES)
 
-#ifndef TDECK
-#define H_RES 1024
-#define V_RES 600
-#else
+// The resolution profile. Everything sized by the screen is a constant, so the compositor's per pixel loops are
+// specialized for it by the compiler. Tulip CC and the T-Deck are fixed by their panels, Tulip Desktop can be
+// built for other sizes with make TULIP_RES=WxH, which sets TULIP_H_RES and TULIP_V_RES.
+#if defined(TDECK)
 #define H_RES 320
 #define V_RES 240
+#elif defined(TULIP_H_RES) && defined(TULIP_V_RES)
+#ifdef ESP_PLATFORM
+#error "TULIP_RES is for Tulip Desktop, the ESP32 boards are the size of their panel"
+#endif
+#define H_RES TULIP_H_RES
+#define V_RES TULIP_V_RES
+#else
+#define H_RES 1024
+#define V_RES 600
 #endif
 
 #ifdef TDECK
@@ -125,11 +157,23 @@ extern const unsigned char portfolio_glyph_bitmap[1792];
 #define TFB_ROWS (V_RES/FONT_HEIGHT)
 #define TFB_COLS (H_RES/FONT_WIDTH)
 
+// What a profile has to fit: the compositor fills whole 12 line bounce buffers (FONT_HEIGHT lines on desktop),
+// the TFB keeps its row and column in uint8_ts, and sprite / scroll positions are int16_t
+#if (V_RES % 12) || (V_RES % FONT_HEIGHT)
+#error "V_RES must be a multiple of 12 and of FONT_HEIGHT"
+#endif
+#if TFB_COLS > 255 || TFB_ROWS > 255 || H_RES+OFFSCREEN_X_PX > 32767 || V_RES+OFFSCREEN_Y_PX > 32767
+#error "resolution profile too large"
+#endif
+
 extern uint16_t PIXEL_CLOCK_MHZ;
 
 #ifndef MIN
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
 #endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
 
 #define CHECK_BIT(var,pos) ((var) & (1<<(pos)))
 
@@ -154,10 +198,21 @@ extern uint16_t PIXEL_CLOCK_MHZ;
 #define FORMAT_STRIKE 0x08
 
 #define SPRITE_IS_SPRITE 0x80
+// Vector sprites, drawn from a slot's lines, beziers or ellipses (vector.c) instead of sprite RAM
 #define SPRITE_IS_WIREFRAME 0x40
 #define SPRITE_IS_BEZIER 0x20
 #define SPRITE_IS_ELLIPSE 0x10
 
+// Per sprite scale, rotation and flip. The compositor maps each screen pixel in the sprite's bounding box back
+// into sprite RAM, so one frame of bitmap can be drawn at any angle and size
+#define SPRITE_FLIP_H 1
+#define SPRITE_FLIP_V 2
+typedef struct {
+    uint8_t on;             // 0: drawn 1:1, the fast path
+    int32_t a, b, c, d;     // screen px offset from the sprite's centre -> bitmap px offset, 16.16
+    uint16_t bw, bh;        // bounding box, centred where the untransformed sprite's centre is. Can be bigger than the screen
+} sprite_tf_t;
+
 extern uint8_t gpu_log;
 extern uint8_t tfb_active;
 extern uint8_t tfb_y_row; 
@@ -180,6 +235,7 @@ extern uint16_t *sprite_w_px;//[SPRITES];
 extern uint16_t *sprite_h_px;//[SPRITES]; 
 extern uint8_t *sprite_vis;//[SPRITES];
 extern uint32_t *sprite_mem;//[SPRITES];
+extern sprite_tf_t *sprite_tf;//[SPRITES];
 extern uint8_t *TFB;//[TFB_ROWS][TFB_COLS];
 extern uint8_t *TFBfg;//[TFB_ROWS][TFB_COLS];
 extern uint8_t *TFBbg;//[TFB_ROWS][TFB_COLS];
@@ -190,6 +246,5 @@ extern int16_t *x_speeds;//[V_RES];
 extern int16_t *y_speeds;//[V_RES];
 extern uint32_t **bg_lines;//[V_RES];
 extern uint16_t *TFB_pxlen;
-extern uint8_t *lines_bitmap;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,269 @@
+// displaylist.c
+// Retained BG display lists.
+// While a list is recording, the bg_* drawing calls append a compact command instead of drawing.
+// Replaying walks the commands natively, optionally shifted (e.g. into the offscreen BG area) and
+// optionally only the ones that touch a dirty rect, clipped to that rect.
+#include "displaylist.h"
+#include "surface.h"
+
+display_list_t display_lists[DISPLAY_LISTS];
+int8_t dl_recording = -1;
+
+#define BG_W (H_RES+OFFSCREEN_X_PX)
+#define BG_H (V_RES+OFFSCREEN_Y_PX)
+
+void displaylist_free(uint8_t n) {
+    if(n >= DISPLAY_LISTS) return;
+    display_list_t *dl = &display_lists[n];
+    if(dl->cmds) free_caps(dl->cmds);
+    if(dl->data) free_caps(dl->data);
+    dl->cmds = NULL; dl->data = NULL;
+    dl->count = 0; dl->cap = 0;
+    dl->data_len = 0; dl->data_cap = 0;
+}
+
+void displaylist_begin(uint8_t n) {
+    if(n >= DISPLAY_LISTS) return;
+    // Keep the allocations around, a re-recorded list is usually about the same size
+    display_lists[n].count = 0;
+    display_lists[n].data_len = 0;
+    dl_recording = n;
+}
+
+void displaylist_end() {
+    dl_recording = -1;
+}
+
+static uint8_t dl_reserve(display_list_t *dl, uint32_t data_len) {
+    if(dl->count == dl->cap) {
+        uint32_t cap = dl->cap ? dl->cap * 2 : 64;
+        dl_cmd_t *cmds = (dl_cmd_t*)realloc_caps(dl->cmds, cap * sizeof(dl_cmd_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(cmds == NULL) return 0;
+        dl->cmds = cmds;
+        dl->cap = cap;
+    }
+    if(dl->data_len + data_len > dl->data_cap) {
+        uint32_t cap = dl->data_cap ? dl->data_cap : 1024;
+        while(cap < dl->data_len + data_len) cap *= 2;
+        uint8_t *data = (uint8_t*)realloc_caps(dl->data, cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(data == NULL) return 0;
+        dl->data = data;
+        dl->data_cap = cap;
+    }
+    return 1;
+}
+
+// Same centering draw_new_str does, plus the font's box above and below the baseline
+static void dl_str_bounds(dl_cmd_t *c, const char *str) {
+    uint8_t font_no = c->a[3];
+    int16_t x = c->a[0], y = c->a[1];
+    u8g2_font_t ufont;
+    ufont.font = NULL;
+    u8g2_SetFont(&ufont, tulip_fonts[font_no]);
+    uint16_t width = displaylist_str_width(str, font_no);
+    if(c->a[6]) {
+        y = y + ((c->a[5] + u8g2_a_height(font_no))/2);
+        if(width < c->a[4]) x = x + (c->a[4] - width)/2;
+    }
+    int16_t ascent = ufont.font_info.max_char_height + ufont.font_info.y_offset;
+    c->x0 = x + (ufont.font_info.x_offset < 0 ? ufont.font_info.x_offset : 0);
+    c->x1 = x + width + ufont.font_info.max_char_width;
+    c->y0 = y - ascent;
+    c->y1 = y - ufont.font_info.y_offset + 1;
+}
+
+static void dl_points_bounds(dl_cmd_t *c, uint8_t points) {
+    c->x0 = c->x1 = c->a[0];
+    c->y0 = c->y1 = c->a[1];
+    for(uint8_t i=1;i<points;i++) {
+        if(c->a[i*2] < c->x0) c->x0 = c->a[i*2];
+        if(c->a[i*2] > c->x1) c->x1 = c->a[i*2];
+        if(c->a[i*2+1] < c->y0) c->y0 = c->a[i*2+1];
+        if(c->a[i*2+1] > c->y1) c->y1 = c->a[i*2+1];
+    }
+    c->x1++; c->y1++;
+}
+
+// Append a command to the recording list. Returns 0 if we're out of memory.
+uint8_t displaylist_record(uint8_t type, const int16_t *args, uint8_t nargs, const uint8_t *data, uint32_t data_len) {
+    if(dl_recording < 0) return 0;
+    display_list_t *dl = &display_lists[dl_recording];
+    if(!dl_reserve(dl, data_len)) {
+        fprintf(stderr, "display list %d: out of memory\n", dl_recording);
+        return 0;
+    }
+    dl_cmd_t *c = &dl->cmds[dl->count];
+    memset(c, 0, sizeof(dl_cmd_t));
+    c->type = type;
+    for(uint8_t i=0;i<nargs && i<DL_MAX_ARGS;i++) c->a[i] = args[i];
+    c->data_offset = dl->data_len;
+    c->data_len = data_len;
+    if(data_len) {
+        memcpy(dl->data + dl->data_len, data, data_len);
+        dl->data_len += data_len;
+    }
+    switch(type) {
+        case DL_PIXEL: dl_points_bounds(c, 1); break;
+        case DL_CLEAR: c->x0 = 0; c->y0 = 0; c->x1 = BG_W; c->y1 = BG_H; break;
+        case DL_LINE: dl_points_bounds(c, 2); break;
+        case DL_BEZIER: // the curve stays inside its control point hull
+        case DL_TRIANGLE: dl_points_bounds(c, 3); break;
+        case DL_RECT:
+        case DL_ROUNDRECT:
+        case DL_BITMAP:
+            c->x0 = c->a[0]; c->y0 = c->a[1]; c->x1 = c->a[0] + c->a[2]; c->y1 = c->a[1] + c->a[3];
+            break;
+        case DL_CIRCLE:
+            c->x0 = c->a[0] - c->a[2]; c->y0 = c->a[1] - c->a[2];
+            c->x1 = c->a[0] + c->a[2] + 1; c->y1 = c->a[1] + c->a[2] + 1;
+            break;
+        case DL_STR: dl_str_bounds(c, (const char*)(dl->data + c->data_offset)); break;
+        case DL_BLIT:
+            c->x0 = c->a[4]; c->y0 = c->a[5]; c->x1 = c->a[4] + c->a[2]; c->y1 = c->a[5] + c->a[3];
+            break;
+    }
+    dl->count++;
+    return 1;
+}
+
+// Decoded PNGs are stored as RGB332 bitmaps, transparent pixels become ALPHA
+uint8_t displaylist_record_rgba(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *rgba) {
+    if(dl_recording < 0) return 0;
+    display_list_t *dl = &display_lists[dl_recording];
+    uint32_t len = (uint32_t)w*h;
+    if(!dl_reserve(dl, len)) {
+        fprintf(stderr, "display list %d: out of memory\n", dl_recording);
+        return 0;
+    }
+    uint8_t *out = dl->data + dl->data_len;
+    for(uint32_t i=0;i<len;i++) {
+        out[i] = rgba[i*4+3] ? color_332(rgba[i*4], rgba[i*4+1], rgba[i*4+2]) : ALPHA;
+    }
+    // record() copies data in, so hand it the bytes we just wrote without moving data_len
+    int16_t args[4] = {x, y, w, h};
+    uint32_t data_len = dl->data_len;
+    if(!displaylist_record(DL_BITMAP, args, 4, NULL, 0)) return 0;
+    dl->cmds[dl->count-1].data_offset = data_len;
+    dl->cmds[dl->count-1].data_len = len;
+    dl->data_len += len;
+    return 1;
+}
+
+uint16_t displaylist_str_width(const char *str, uint8_t font_no) {
+    uint16_t width = 0;
+    for(const char *p = str; *p; p++) width += u8g2_glyph_width(font_no, *p);
+    return width;
+}
+
+void displaylist_bounds(uint8_t n, int16_t *x0, int16_t *y0, int16_t *x1, int16_t *y1) {
+    display_list_t *dl = &display_lists[n];
+    *x0 = *y0 = *x1 = *y1 = 0;
+    for(uint32_t i=0;i<dl->count;i++) {
+        dl_cmd_t *c = &dl->cmds[i];
+        if(i == 0 || c->x0 < *x0) *x0 = c->x0;
+        if(i == 0 || c->y0 < *y0) *y0 = c->y0;
+        if(i == 0 || c->x1 > *x1) *x1 = c->x1;
+        if(i == 0 || c->y1 > *y1) *y1 = c->y1;
+    }
+}
+
+// The pixel primitives clip themselves via draw_set_clip. Bitmaps, blits and clears we clip here.
+// They draw on t, the bg or the surface bg_target points at
+static void dl_clear(surface_t *t, uint8_t pal_idx, int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1) {
+    for(int16_t j=cy0;j<cy1;j++) {
+        memset(t->pixels + (uint32_t)j*t->w + cx0, pal_idx, cx1-cx0);
+    }
+}
+
+static void dl_bitmap(surface_t *t, const uint8_t *data, int16_t x, int16_t y, int16_t w, int16_t h, int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1) {
+    int16_t i0 = x < cx0 ? cx0 : x, i1 = x + w > cx1 ? cx1 : x + w;
+    int16_t j0 = y < cy0 ? cy0 : y, j1 = y + h > cy1 ? cy1 : y + h;
+    for(int16_t j=j0;j<j1;j++) {
+        const uint8_t *src = data + (uint32_t)(j-y)*w + (i0-x);
+        uint8_t *dst = t->pixels + (uint32_t)j*t->w + i0;
+        for(int16_t i=i0;i<i1;i++) {
+            uint8_t p = *src++;
+            if(p != ALPHA) *dst = p;
+            dst++;
+        }
+    }
+}
+
+static void dl_blit(surface_t *t, int16_t sx, int16_t sy, int16_t w, int16_t h, int16_t x, int16_t y, uint8_t alpha, int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1) {
+    if(sx < 0 || sy < 0 || sx + w > t->w || sy + h > t->h) return;
+    int16_t i0 = x < cx0 ? cx0 : x, i1 = x + w > cx1 ? cx1 : x + w;
+    int16_t j0 = y < cy0 ? cy0 : y, j1 = y + h > cy1 ? cy1 : y + h;
+    if(i1 <= i0 || j1 <= j0) return;
+    // walk rows away from the overlap so a blit onto itself doesn't smear
+    int16_t step = (y > sy) ? -1 : 1;
+    int16_t j = (step > 0) ? j0 : j1 - 1;
+    for(int16_t n=j0;n<j1;n++, j+=step) {
+        uint8_t *src = t->pixels + (uint32_t)(sy + (j-y))*t->w + sx + (i0-x);
+        uint8_t *dst = t->pixels + (uint32_t)j*t->w + i0;
+        if(alpha) {
+            for(int16_t i=i0;i<i1;i++) {
+                if(*src != ALPHA) *dst = *src;
+                src++; dst++;
+            }
+        } else {
+            memmove(dst, src, i1-i0);
+        }
+    }
+}
+
+// Replay list n shifted by ox,oy. If cw and ch are > 0, only commands touching that rect are drawn,
+// and only inside it. Returns the number of commands drawn.
+uint32_t displaylist_draw(uint8_t n, int16_t ox, int16_t oy, int16_t cx, int16_t cy, int16_t cw, int16_t ch) {
+    if(n >= DISPLAY_LISTS) return 0;
+    display_list_t *dl = &display_lists[n];
+    surface_t t = surface_target();
+    int16_t cx0 = 0, cy0 = 0, cx1 = t.w, cy1 = t.h;
+    if(cw > 0 && ch > 0) {
+        if(cx > cx0) cx0 = cx;
+        if(cy > cy0) cy0 = cy;
+        if(cx + cw < cx1) cx1 = cx + cw;
+        if(cy + ch < cy1) cy1 = cy + ch;
+    }
+    if(cx1 <= cx0 || cy1 <= cy0) return 0;
+    draw_set_clip(cx0, cy0, cx1 - cx0, cy1 - cy0);
+    uint32_t drawn = 0;
+    for(uint32_t i=0;i<dl->count;i++) {
+        dl_cmd_t *c = &dl->cmds[i];
+        if(c->x1 + ox <= cx0 || c->x0 + ox >= cx1 || c->y1 + oy <= cy0 || c->y0 + oy >= cy1) continue;
+        int16_t *a = c->a;
+        switch(c->type) {
+            case DL_PIXEL: drawPixel(a[0]+ox, a[1]+oy, a[2]); break;
+            case DL_CLEAR: dl_clear(&t, a[0], cx0, cy0, cx1, cy1); break;
+            case DL_LINE: drawLine_scanline(a[0]+ox, a[1]+oy, a[2]+ox, a[3]+oy, a[4]); break;
+            case DL_BEZIER: plotQuadBezier(a[0]+ox, a[1]+oy, a[2]+ox, a[3]+oy, a[4]+ox, a[5]+oy, a[6]); break;
+            case DL_RECT:
+                if(a[5]) fillRect(a[0]+ox, a[1]+oy, a[2], a[3], a[4]);
+                else drawRect(a[0]+ox, a[1]+oy, a[2], a[3], a[4]);
+                break;
+            case DL_ROUNDRECT:
+                if(a[6]) fillRoundRect(a[0]+ox, a[1]+oy, a[2], a[3], a[4], a[5]);
+                else drawRoundRect(a[0]+ox, a[1]+oy, a[2], a[3], a[4], a[5]);
+                break;
+            case DL_CIRCLE:
+                if(a[4]) fillCircle(a[0]+ox, a[1]+oy, a[2], a[3]);
+                else drawCircle(a[0]+ox, a[1]+oy, a[2], a[3]);
+                break;
+            case DL_TRIANGLE:
+                if(a[7]) fillTriangle(a[0]+ox, a[1]+oy, a[2]+ox, a[3]+oy, a[4]+ox, a[5]+oy, a[6]);
+                else drawTriangle(a[0]+ox, a[1]+oy, a[2]+ox, a[3]+oy, a[4]+ox, a[5]+oy, a[6]);
+                break;
+            case DL_STR:
+                draw_new_str((const char*)(dl->data + c->data_offset), a[0]+ox, a[1]+oy, a[2], a[3], a[4], a[5], a[6]);
+                break;
+            case DL_BITMAP:
+                dl_bitmap(&t, dl->data + c->data_offset, a[0]+ox, a[1]+oy, a[2], a[3], cx0, cy0, cx1, cy1);
+                break;
+            case DL_BLIT: // source stays where it is, only the destination moves
+                dl_blit(&t, a[0], a[1], a[2], a[3], a[4]+ox, a[5]+oy, a[6], cx0, cy0, cx1, cy1);
+                break;
+        }
+        drawn++;
+    }
+    draw_set_clip(0, 0, 0, 0);
+    return drawn;
+}
@@ -0,0 +1,57 @@
+// displaylist.h
+// retained lists of BG drawing commands, recorded once from python and replayed natively
+#ifndef __DISPLAYLISTH
+#define __DISPLAYLISTH
+
+#include "display.h"
+#include "bresenham.h"
+
+#define DISPLAY_LISTS 16
+#define DL_MAX_ARGS 8
+
+enum {
+    DL_PIXEL = 0,
+    DL_CLEAR,
+    DL_LINE,
+    DL_BEZIER,
+    DL_RECT,
+    DL_ROUNDRECT,
+    DL_CIRCLE,
+    DL_TRIANGLE,
+    DL_STR,
+    DL_BITMAP,
+    DL_BLIT,
+};
+
+// One recorded command. Bounds are in BG pixels before any replay offset, x1/y1 exclusive.
+// Strings and bitmaps keep their payload in the list's data arena at data_offset.
+typedef struct {
+    uint8_t type;
+    int16_t a[DL_MAX_ARGS];
+    int16_t x0, y0, x1, y1;
+    uint32_t data_offset;
+    uint32_t data_len;
+} dl_cmd_t;
+
+typedef struct {
+    dl_cmd_t *cmds;
+    uint32_t count;
+    uint32_t cap;
+    uint8_t *data;
+    uint32_t data_len;
+    uint32_t data_cap;
+} display_list_t;
+
+extern display_list_t display_lists[DISPLAY_LISTS];
+extern int8_t dl_recording;
+
+void displaylist_begin(uint8_t n);
+void displaylist_end();
+void displaylist_free(uint8_t n);
+uint8_t displaylist_record(uint8_t type, const int16_t *args, uint8_t nargs, const uint8_t *data, uint32_t data_len);
+uint8_t displaylist_record_rgba(int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *rgba);
+uint16_t displaylist_str_width(const char *str, uint8_t font_no);
+void displaylist_bounds(uint8_t n, int16_t *x0, int16_t *y0, int16_t *x1, int16_t *y1);
+uint32_t displaylist_draw(uint8_t n, int16_t ox, int16_t oy, int16_t cx, int16_t cy, int16_t cw, int16_t ch);
+
+#endif
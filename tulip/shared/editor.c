@@ -321,28 +321,23 @@ void editor_open_file(const char *filename) {
 	uint16_t c = 0;
     uint16_t new_lines = 0;
 	//dbg("opening file %s\n", filename);
-	int32_t fs = file_size(filename);
-	if(fs > 0) {
-		char * text = (char*) editor_malloc(fs+3); 
-		uint32_t bytes_read = read_file(filename, (uint8_t*)text, fs, 0);
-        //dbg("Filesize %d bytes read %d\n", fs, bytes_read);
+	tulip_map_t map;
+	if(tulip_file_map(filename, &map) && map.len > 0) {
+		// Split straight out of the mapped file, no copy of the whole thing
+		const char * text = (const char *)map.data;
+		uint32_t bytes_read = map.len;
         new_lines = 1;
-        //if(text[bytes_read-1]!='\n') { new_lines = 0; dbg("adding n\n"); text[bytes_read] = '\n'; bytes_read++; }
-		text[bytes_read] = 0; // end
-		for(uint32_t i=0;i<bytes_read;i++) if(text[i]=='\n') new_lines++;
+		for(const char *p = text; (p = memchr(p, '\n', text + bytes_read - p)) != NULL; p++) new_lines++;
 		//dbg("File %s has %d lines. %d bytes\n", filename, new_lines,bytes_read);
 		char ** incoming_text_lines = (char**)editor_malloc(sizeof(char*)*(new_lines));
 
 		uint32_t last = 0;
 		for(uint32_t i=0;i<bytes_read+1;i++) {
-			if(text[i]=='\n' || i==bytes_read) {
+			if(i==bytes_read || text[i]=='\n') {
                 //dbg("mallocing line %d\n", c);
 				incoming_text_lines[c]  = editor_malloc(i-last + 1);
-				uint16_t x;
-				for(x=0;x<i-last;x++) { 
-					incoming_text_lines[c][x] = text[last+x];
-				}
-				incoming_text_lines[c][x] = 0;
+				memcpy(incoming_text_lines[c], text + last, i-last);
+				incoming_text_lines[c][i-last] = 0;
 				last = i+1;
 				c++;
 			}
@@ -352,7 +347,7 @@ void editor_open_file(const char *filename) {
             incoming_text_lines[c] = editor_malloc(1);
             incoming_text_lines[c][0] = 0;
         }
-		editor_free(text);
+		tulip_file_unmap(&map);
 
 		//dbg("File %s read with %d lines. Inserting at position %d. existing lines %d\n", filename, new_lines, y_offset+cursor_y, lines);
 
@@ -397,27 +392,20 @@ void prompt_for_string(char * prompt,  uint8_t mode) {
 
 void editor_save() {
     if(strlen(fn)) {
-        uint32_t bytes = 0;
-        for(uint16_t i=0;i<lines;i++) { if(text_lines[i] != NULL) bytes = bytes + strlen(text_lines[i]) + 1; }
-        char * text = (char*)editor_malloc(bytes);
-        uint32_t c = 0;
+        // Stream the lines out through the file buffer instead of joining them all first
+        tulip_file_t file;
+        if(!tulip_file_open(&file, fn, "w")) {
+            dbg("Out of memory, not saving\n");
+            return;
+        }
         for(uint16_t i=0;i<lines;i++) { 
             if(text_lines[i]!=NULL) {
-                if(text_lines[i][0] != 0) {
-                    for(uint16_t j=0;j<strlen(text_lines[i]);j++) {
-                        text[c++] = text_lines[i][j];
-                    }
-                    text[c++] = '\n';
-                } else {
-                    text[c++] = '\n';
-                }
+                tulip_file_write(&file, (uint8_t*)text_lines[i], strlen(text_lines[i]));
+                tulip_file_write(&file, (uint8_t*)"\n", 1);
             }
         }
-        //display_stop();
-        write_file(fn, (uint8_t*)text, c, 0);
-        //display_start();
+        tulip_file_close(&file);
         dirty = 0;
-        editor_free(text);
         //dbg("Saved %s\n", fn);
         move_cursor(cursor_x, cursor_y);
     } else {
@@ -0,0 +1,155 @@
+// events.c
+// Python callbacks from the display, sequencer, MIDI and keyboard go through here instead of straight to
+// mp_sched_schedule. Each class gets its own ring, frame and LVGL ticks coalesce if the last one hasn't run yet,
+// and a single scheduled drain runs a batch of them highest priority first. That keeps audio timing callbacks
+// from sitting behind a pile of redundant frame callbacks in MicroPython's one FIFO.
+#include "events.h"
+#include "polyfills.h"
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+// The callbacks and args live in a root pointer so the GC sees them while they're queued
+MP_REGISTER_ROOT_POINTER(mp_obj_t tulip_event_queue[256]);
+_Static_assert(EVENT_CLASSES * EVENT_QUEUE_DEPTH * 2 == 256, "resize the tulip_event_queue root pointer");
+#define EVENT_FN(cls, slot) MP_STATE_PORT(tulip_event_queue)[((cls)*EVENT_QUEUE_DEPTH + (slot))*2]
+#define EVENT_ARG(cls, slot) MP_STATE_PORT(tulip_event_queue)[((cls)*EVENT_QUEUE_DEPTH + (slot))*2 + 1]
+
+const char * const event_class_names[EVENT_CLASSES] = { "audio", "input", "frame", "ui" };
+
+typedef struct {
+    uint16_t head;
+    uint16_t count;
+    event_stats_t stats;
+} event_ring_t;
+
+static event_ring_t event_rings[EVENT_CLASSES];
+static uint8_t events_drain_scheduled = 0;
+
+// Producers are ISRs and tasks on either core, the consumer is the MP task
+#ifdef ESP_PLATFORM
+static portMUX_TYPE events_mux = portMUX_INITIALIZER_UNLOCKED;
+#define EVENTS_LOCK() portENTER_CRITICAL_SAFE(&events_mux)
+#define EVENTS_UNLOCK() portEXIT_CRITICAL_SAFE(&events_mux)
+#else
+#define EVENTS_LOCK() mp_uint_t events_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define EVENTS_UNLOCK() MICROPY_END_ATOMIC_SECTION(events_atomic)
+#endif
+
+STATIC mp_obj_t events_drain(mp_obj_t none);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(events_drain_obj, events_drain);
+
+static void events_schedule_drain() {
+    if(__atomic_exchange_n(&events_drain_scheduled, 1, __ATOMIC_ACQ_REL)) return;
+    // If MicroPython's queue is full, the next event we get will try again
+    if(!mp_sched_schedule(MP_OBJ_FROM_PTR(&events_drain_obj), mp_const_none)) {
+        __atomic_store_n(&events_drain_scheduled, 0, __ATOMIC_RELEASE);
+    }
+}
+
+static uint8_t events_push(uint8_t cls, mp_obj_t fn, mp_obj_t arg, uint8_t coalesce) {
+    if(cls >= EVENT_CLASSES || fn == NULL) return 0;
+    uint8_t ok = 1;
+    uint8_t queued = 0;
+    event_ring_t *r = &event_rings[cls];
+    EVENTS_LOCK();
+    if(coalesce) {
+        for(uint16_t i=0;i<r->count;i++) {
+            if(EVENT_FN(cls, (r->head + i) % EVENT_QUEUE_DEPTH) == fn) {
+                r->stats.coalesced++;
+                queued = 1;
+                break;
+            }
+        }
+    }
+    if(!queued) {
+        if(r->count < EVENT_QUEUE_DEPTH) {
+            uint16_t slot = (r->head + r->count) % EVENT_QUEUE_DEPTH;
+            EVENT_FN(cls, slot) = fn;
+            EVENT_ARG(cls, slot) = arg;
+            r->count++;
+            if(r->count > r->stats.max_depth) r->stats.max_depth = r->count;
+        } else {
+            r->stats.dropped++;
+            ok = 0;
+        }
+    }
+    EVENTS_UNLOCK();
+    events_schedule_drain();
+    return ok;
+}
+
+uint8_t tulip_schedule(uint8_t cls, mp_obj_t fn, mp_obj_t arg) {
+    return events_push(cls, fn, arg, 0);
+}
+
+uint8_t tulip_schedule_coalesce(uint8_t cls, mp_obj_t fn, mp_obj_t arg) {
+    return events_push(cls, fn, arg, 1);
+}
+
+// Take the oldest event of the highest priority class that has one
+static uint8_t events_pop(mp_obj_t *fn, mp_obj_t *arg) {
+    uint8_t found = 0;
+    EVENTS_LOCK();
+    for(uint8_t cls=0;cls<EVENT_CLASSES;cls++) {
+        event_ring_t *r = &event_rings[cls];
+        if(r->count) {
+            *fn = EVENT_FN(cls, r->head);
+            *arg = EVENT_ARG(cls, r->head);
+            EVENT_FN(cls, r->head) = NULL;
+            EVENT_ARG(cls, r->head) = NULL;
+            r->head = (r->head + 1) % EVENT_QUEUE_DEPTH;
+            r->count--;
+            r->stats.dispatched++;
+            found = 1;
+            break;
+        }
+    }
+    EVENTS_UNLOCK();
+    return found;
+}
+
+// Runs on the MP task. We re-pick the highest class after every callback, so an audio event that
+// arrives while a frame callback is running goes next. After a batch we reschedule ourselves
+// so python code (and anything else in MicroPython's queue) gets a turn.
+STATIC mp_obj_t events_drain(mp_obj_t none) {
+    __atomic_store_n(&events_drain_scheduled, 0, __ATOMIC_RELEASE);
+    mp_obj_t fn, arg;
+    for(uint8_t n=0;n<EVENT_DRAIN_BATCH;n++) {
+        if(!events_pop(&fn, &arg)) return mp_const_none;
+        mp_call_function_1_protected(fn, arg);
+    }
+    if(events_pending()) events_schedule_drain();
+    return mp_const_none;
+}
+
+uint16_t events_pending() {
+    uint16_t total = 0;
+    for(uint8_t cls=0;cls<EVENT_CLASSES;cls++) total += __atomic_load_n(&event_rings[cls].count, __ATOMIC_ACQUIRE);
+    return total;
+}
+
+void events_stats(uint8_t cls, event_stats_t *out) {
+    EVENTS_LOCK();
+    *out = event_rings[cls].stats;
+    out->depth = event_rings[cls].count;
+    EVENTS_UNLOCK();
+}
+
+void events_reset_stats() {
+    EVENTS_LOCK();
+    for(uint8_t cls=0;cls<EVENT_CLASSES;cls++) {
+        memset(&event_rings[cls].stats, 0, sizeof(event_stats_t));
+        event_rings[cls].stats.max_depth = event_rings[cls].count;
+    }
+    EVENTS_UNLOCK();
+}
+
+// Forget anything queued, at soft reset the heap the callbacks point into is gone
+void events_clear() {
+    EVENTS_LOCK();
+    for(uint16_t i=0;i<EVENT_CLASSES*EVENT_QUEUE_DEPTH*2;i++) MP_STATE_PORT(tulip_event_queue)[i] = NULL;
+    memset(event_rings, 0, sizeof(event_rings));
+    EVENTS_UNLOCK();
+    __atomic_store_n(&events_drain_scheduled, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,42 @@
+// events.h
+// prioritized queue of python callbacks in front of mp_sched_schedule
+#ifndef __EVENTSH
+#define __EVENTSH
+
+#include <stdint.h>
+#include "py/runtime.h"
+
+// Drained highest priority first, so a sequencer tick never waits behind a frame callback or LVGL
+enum {
+    EVENT_AUDIO = 0,    // sequencer ticks and defers
+    EVENT_INPUT,        // MIDI, keyboard, touch, hotkeys
+    EVENT_FRAME,        // tulip.frame_callback
+    EVENT_UI,           // LVGL task handler
+    EVENT_CLASSES
+};
+
+// Slots per class. EVENT_CLASSES * EVENT_QUEUE_DEPTH * 2 must match the root pointer in events.c
+#define EVENT_QUEUE_DEPTH 32
+// Most callbacks one drain runs before handing back to the VM
+#define EVENT_DRAIN_BATCH 16
+
+typedef struct {
+    uint32_t dispatched;
+    uint32_t dropped;
+    uint32_t coalesced;
+    uint16_t depth;
+    uint16_t max_depth;
+} event_stats_t;
+
+extern const char * const event_class_names[EVENT_CLASSES];
+
+// Safe from ISRs and other tasks. Returns 0 if the class queue was full and the event was dropped
+uint8_t tulip_schedule(uint8_t cls, mp_obj_t fn, mp_obj_t arg);
+// Same, but if fn is already waiting in this class it isn't queued again. Returns 1 in that case too
+uint8_t tulip_schedule_coalesce(uint8_t cls, mp_obj_t fn, mp_obj_t arg);
+uint16_t events_pending();
+void events_stats(uint8_t cls, event_stats_t *out);
+void events_reset_stats();
+void events_clear();
+
+#endif
@@ -0,0 +1,209 @@
+// gesture.c
+// A gesture recognizer fed by send_touch_to_micropython() on the touch task, so python gets "a swipe left at
+// 2000 px/s" instead of polling tulip.touch() every frame and missing anything quicker than a frame or two.
+// Everything here but the queue is only touched from the touch task (the display thread on desktop).
+#include "gesture.h"
+#include <math.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+uint8_t touch_points = 1;
+
+static gesture_t queue[GESTURE_QUEUE];
+static uint8_t queued = 0;
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE gesture_mux = portMUX_INITIALIZER_UNLOCKED;
+#define GESTURE_LOCK() portENTER_CRITICAL_SAFE(&gesture_mux)
+#define GESTURE_UNLOCK() portEXIT_CRITICAL_SAFE(&gesture_mux)
+#else
+#define GESTURE_LOCK() mp_uint_t gesture_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define GESTURE_UNLOCK() MICROPY_END_ATOMIC_SECTION(gesture_atomic)
+#endif
+
+// This touch, from the first finger down to the last one up
+static uint8_t down_points = 0;
+static int16_t down_x, down_y;
+static int32_t down_ms;
+static uint8_t moved, long_fired, multi;
+// The last tap, for double taps
+static int32_t tap_ms;
+static int16_t tap_x, tap_y;
+static uint8_t tap_pending = 0;
+// Recent positions of the first finger, for the swipe speed
+#define GESTURE_SAMPLES 8
+typedef struct {
+    int16_t x, y;
+    int32_t ms;
+} gesture_sample_t;
+static gesture_sample_t samples[GESTURE_SAMPLES];
+static uint8_t sample_count, sample_at;
+// Pinch, relative to the spread and angle the fingers started at
+static uint8_t pinching = 0, pinch_points;
+static float pinch_spread0, pinch_last_angle, pinch_scale, pinch_turn;
+static int16_t pinch_x, pinch_y;
+
+static void gesture_push(uint8_t kind, int16_t x, int16_t y, float a, float b) {
+    GESTURE_LOCK();
+    gesture_t *g = NULL;
+    if(kind == GESTURE_PINCH && queued && queue[queued-1].kind == GESTURE_PINCH) {
+        g = &queue[queued-1];
+    } else if(queued < GESTURE_QUEUE) {
+        g = &queue[queued++];
+    }
+    if(g != NULL) {
+        g->kind = kind;
+        g->x = x; g->y = y;
+        g->a = a; g->b = b;
+    }
+    GESTURE_UNLOCK();
+    if(g != NULL) tulip_gesture_isr();
+}
+
+static inline int16_t iabs(int16_t v) {
+    return v < 0 ? -v : v;
+}
+
+static void add_sample(int16_t x, int16_t y, int32_t ms) {
+    samples[sample_at] = (gesture_sample_t){x, y, ms};
+    sample_at = (sample_at + 1) % GESTURE_SAMPLES;
+    if(sample_count < GESTURE_SAMPLES) sample_count++;
+}
+
+// px per second over the last GESTURE_VELOCITY_MS of the stroke
+static void swipe_velocity(float *vx, float *vy) {
+    gesture_sample_t *last = &samples[(sample_at + GESTURE_SAMPLES - 1) % GESTURE_SAMPLES];
+    gesture_sample_t *from = last;
+    gesture_sample_t start = {down_x, down_y, down_ms};
+    for(uint8_t i=2;i<=sample_count;i++) {
+        gesture_sample_t *s = &samples[(sample_at + GESTURE_SAMPLES - i) % GESTURE_SAMPLES];
+        from = s;
+        if(last->ms - s->ms >= GESTURE_VELOCITY_MS) break;
+    }
+    int32_t dt = last->ms - from->ms;
+    if(dt <= 0) {
+        // one sample, use the whole stroke
+        from = &start;
+        dt = last->ms - down_ms;
+        if(dt <= 0) dt = 1;
+    }
+    *vx = (last->x - from->x) * 1000.0f / dt;
+    *vy = (last->y - from->y) * 1000.0f / dt;
+}
+
+// The middle of the fingers, their average distance from it and the angle of the first one around it
+static void pinch_measure(uint8_t points, float *cx, float *cy, float *spread, float *angle) {
+    *cx = 0; *cy = 0;
+    for(uint8_t i=0;i<points;i++) { *cx += last_touch_x[i]; *cy += last_touch_y[i]; }
+    *cx /= points; *cy /= points;
+    *spread = 0;
+    for(uint8_t i=0;i<points;i++) *spread += hypotf(last_touch_x[i] - *cx, last_touch_y[i] - *cy);
+    *spread /= points;
+    *angle = atan2f(last_touch_y[0] - *cy, last_touch_x[0] - *cx) * 180.0f / (float)M_PI;
+}
+
+static void pinch_update(uint8_t points) {
+    float cx, cy, spread, angle;
+    pinch_measure(points, &cx, &cy, &spread, &angle);
+    if(!pinching || points != pinch_points) {
+        // A finger joining or leaving carries on from the scale and turn so far instead of jumping
+        if(!pinching) { pinch_scale = 1.0f; pinch_turn = 0.0f; }
+        pinch_spread0 = spread > 1.0f ? spread / pinch_scale : 1.0f;
+        pinch_last_angle = angle;
+        pinch_points = points;
+        pinching = 1;
+    }
+    float turn = angle - pinch_last_angle;
+    if(turn > 180.0f) turn -= 360.0f;
+    if(turn < -180.0f) turn += 360.0f;
+    pinch_turn += turn;
+    pinch_last_angle = angle;
+    pinch_scale = spread / pinch_spread0;
+    pinch_x = (int16_t)cx;
+    pinch_y = (int16_t)cy;
+    gesture_push(GESTURE_PINCH, pinch_x, pinch_y, pinch_scale, pinch_turn);
+}
+
+static void pinch_end() {
+    if(!pinching) return;
+    pinching = 0;
+    gesture_push(GESTURE_PINCH_END, pinch_x, pinch_y, pinch_scale, pinch_turn);
+}
+
+static void touch_up(int32_t now) {
+    pinch_end();
+    if(multi || long_fired) return;
+    int16_t x = last_touch_x[0], y = last_touch_y[0];
+    if(!moved && now - down_ms <= GESTURE_TAP_MS) {
+        if(tap_pending && down_ms - tap_ms <= GESTURE_DOUBLE_TAP_MS &&
+           iabs(x - tap_x) <= 2*GESTURE_SLOP_PX && iabs(y - tap_y) <= 2*GESTURE_SLOP_PX) {
+            tap_pending = 0;
+            gesture_push(GESTURE_DOUBLE_TAP, x, y, 0, 0);
+        } else {
+            tap_pending = 1;
+            tap_ms = now;
+            tap_x = x; tap_y = y;
+            gesture_push(GESTURE_TAP, x, y, 0, 0);
+        }
+    } else if(iabs(x - down_x) >= GESTURE_SWIPE_PX || iabs(y - down_y) >= GESTURE_SWIPE_PX) {
+        float vx, vy;
+        swipe_velocity(&vx, &vy);
+        gesture_push(GESTURE_SWIPE, down_x, down_y, vx, vy);
+    }
+}
+
+// From send_touch_to_micropython, with how many fingers are down now (0 for none)
+void gesture_touch(uint8_t points) {
+    int32_t now = get_ticks_ms();
+    if(points > 3) points = 3;
+    if(points == 0) {
+        if(down_points) touch_up(now);
+        down_points = 0;
+        return;
+    }
+    int16_t x = last_touch_x[0], y = last_touch_y[0];
+    if(down_points == 0) {
+        down_x = x; down_y = y;
+        down_ms = now;
+        moved = 0; long_fired = 0; multi = 0;
+        sample_count = 0; sample_at = 0;
+    }
+    add_sample(x, y, now);
+    if(iabs(x - down_x) > GESTURE_SLOP_PX || iabs(y - down_y) > GESTURE_SLOP_PX) moved = 1;
+    if(points >= 2) {
+        multi = 1;
+        pinch_update(points);
+    } else {
+        pinch_end();
+    }
+    down_points = points;
+    gesture_poll();
+}
+
+// Also called from the touch loop when nothing's changed, so a finger held still still becomes a long press
+void gesture_poll() {
+    if(down_points != 1 || multi || moved || long_fired) return;
+    if(get_ticks_ms() - down_ms >= GESTURE_LONG_PRESS_MS) {
+        long_fired = 1;
+        gesture_push(GESTURE_LONG_PRESS, down_x, down_y, 0, 0);
+    }
+}
+
+// From python, up to max waiting gestures, oldest first
+uint8_t gesture_take(gesture_t *out, uint8_t max) {
+    GESTURE_LOCK();
+    uint8_t n = queued < max ? queued : max;
+    memcpy(out, queue, n * sizeof(gesture_t));
+    memmove(queue, queue + n, (queued - n) * sizeof(gesture_t));
+    queued -= n;
+    GESTURE_UNLOCK();
+    return n;
+}
+
+void gesture_clear() {
+    GESTURE_LOCK();
+    queued = 0;
+    GESTURE_UNLOCK();
+}
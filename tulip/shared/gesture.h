@@ -0,0 +1,45 @@
+// gesture.h
+// taps, double taps, long presses, swipes and two or three finger pinch/rotate, recognized on the touch task
+#ifndef __GESTUREH
+#define __GESTUREH
+
+#include "polyfills.h"
+#include "display.h"
+
+enum {
+    GESTURE_TAP = 1,
+    GESTURE_DOUBLE_TAP,
+    GESTURE_LONG_PRESS,
+    GESTURE_SWIPE,          // a, b are the finger's x and y speed as it left the screen, px per second
+    GESTURE_PINCH,          // while 2 or 3 fingers are down. a is the spread over what it started at, b the turn in degrees
+    GESTURE_PINCH_END,      // the same, when the fingers come up
+};
+
+#define GESTURE_TAP_MS 250          // down to up, for a tap
+#define GESTURE_DOUBLE_TAP_MS 300   // up to the next down, for a double tap
+#define GESTURE_LONG_PRESS_MS 500
+#define GESTURE_SLOP_PX 16          // moving less than this is still holding still
+#define GESTURE_SWIPE_PX 48         // moving more than this before lifting is a swipe
+#define GESTURE_VELOCITY_MS 100     // swipe speed is over the last this long of the stroke
+
+// Queued for python until it reads them. Pinches replace the one before them if python hasn't seen it yet
+#define GESTURE_QUEUE 16
+
+typedef struct {
+    uint8_t kind;
+    int16_t x, y;       // where: the tap, the start of the swipe, the middle of the fingers
+    float a, b;
+} gesture_t;
+
+// Touch drivers set this to how many fingers are down before calling send_touch_to_micropython
+extern uint8_t touch_points;
+
+void gesture_touch(uint8_t points);
+void gesture_poll();
+uint8_t gesture_take(gesture_t *out, uint8_t max);
+void gesture_clear();
+
+// in modtulip, schedules the python callback
+void tulip_gesture_isr();
+
+#endif
@@ -1,8 +1,11 @@
 // keyscan.c
 #include "keyscan.h"
+#include "events.h"
 
 #ifndef ESP_PLATFORM
 #include <SDL.h>
+#else
+#include "freertos/FreeRTOS.h"
 #endif
 
 uint8_t keyboard_send_keys_to_micropython = 1;
@@ -16,6 +19,29 @@ uint8_t last_scan[8] = {0,0,0,0,0,0,0,0};
 // Keep track of key_remaps
 key_remap key_remaps[MAX_KEY_REMAPS];
 
+// Filled on the keyboard task (the display thread on desktop), taken on the MP task
+static key_event_t key_events[KEY_EVENT_QUEUE];
+static uint8_t key_events_queued = 0;
+static uint16_t key_chars[KEY_CHAR_QUEUE];
+static uint8_t key_chars_queued = 0;
+static uint32_t lvgl_keys[KEY_LVGL_QUEUE];
+static uint16_t lvgl_keys_head = 0, lvgl_keys_queued = 0;
+// Bit per scan code held down. The modifiers are 0xe0-0xe7, so the top byte is the KEY_MOD_ mask
+static uint32_t key_held[8];
+// The last key down that makes a char repeats until it comes up
+static uint8_t repeat_scan = 0;
+static uint16_t repeat_code = 0;
+static uint32_t repeat_next_ms = 0;
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE keys_mux = portMUX_INITIALIZER_UNLOCKED;
+#define KEYS_LOCK() portENTER_CRITICAL_SAFE(&keys_mux)
+#define KEYS_UNLOCK() portEXIT_CRITICAL_SAFE(&keys_mux)
+#else
+#define KEYS_LOCK() mp_uint_t keys_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define KEYS_UNLOCK() MICROPY_END_ATOMIC_SECTION(keys_atomic)
+#endif
+
 
 // Go _FROM_ cp437 to utf8 bytes
 const uint8_t cp437_to_utf8[] = {
@@ -398,19 +424,145 @@ uint16_t scan_ascii(uint8_t code, uint32_t modifier) {
     return 0;
 }
 
+// From the keyboard drivers for every key down, up and OS repeat, before any chars it makes are sent.
+// A full queue drops the event but the held keys are still right
+void key_event(uint8_t kind, uint8_t scan, uint16_t code) {
+    uint32_t now = get_ticks_ms();
+    uint8_t queued = 0;
+    KEYS_LOCK();
+    if(kind == KEY_EVENT_DOWN) {
+        key_held[scan >> 5] |= 1u << (scan & 31);
+        if(code && scan < KEY_LEFTCTRL) {
+            repeat_scan = scan;
+            repeat_code = code;
+            repeat_next_ms = now + KEY_REPEAT_TRIGGER_MS;
+        }
+    } else if(kind == KEY_EVENT_UP) {
+        key_held[scan >> 5] &= ~(1u << (scan & 31));
+        if(scan == repeat_scan) repeat_scan = 0;
+    }
+    if(key_events_queued < KEY_EVENT_QUEUE) {
+        key_event_t *e = &key_events[key_events_queued++];
+        e->ms = now;
+        e->code = (kind == KEY_EVENT_UP) ? 0 : code;
+        e->scan = scan;
+        e->mods = key_held[7] & 0xff;
+        e->kind = kind;
+        queued = 1;
+    }
+    KEYS_UNLOCK();
+    if(queued) tulip_key_event_isr();
+}
+
+// For keyboards the OS doesn't repeat for, called from their task loop. Returns a char to send again or 0
+uint16_t key_repeat_poll() {
+    uint32_t now = get_ticks_ms();
+    uint16_t code = 0;
+    uint8_t scan = 0;
+    KEYS_LOCK();
+    if(repeat_scan && (int32_t)(now - repeat_next_ms) >= 0) {
+        repeat_next_ms = now + KEY_REPEAT_INTER_MS;
+        code = repeat_code;
+        scan = repeat_scan;
+    }
+    KEYS_UNLOCK();
+    if(code) key_event(KEY_EVENT_REPEAT, scan, code);
+    return code;
+}
+
+uint8_t key_events_take(key_event_t *out, uint8_t max) {
+    KEYS_LOCK();
+    uint8_t n = key_events_queued < max ? key_events_queued : max;
+    memcpy(out, key_events, n * sizeof(key_event_t));
+    memmove(key_events, key_events + n, (key_events_queued - n) * sizeof(key_event_t));
+    key_events_queued -= n;
+    KEYS_UNLOCK();
+    return n;
+}
+
+uint8_t key_chars_take(uint16_t *out, uint8_t max) {
+    KEYS_LOCK();
+    uint8_t n = key_chars_queued < max ? key_chars_queued : max;
+    memcpy(out, key_chars, n * sizeof(uint16_t));
+    memmove(key_chars, key_chars + n, (key_chars_queued - n) * sizeof(uint16_t));
+    key_chars_queued -= n;
+    KEYS_UNLOCK();
+    return n;
+}
+
+// 32 bytes, bit (scan & 7) of byte (scan >> 3). Returns the KEY_MOD_ bits
+uint8_t keys_held(uint8_t *bitmap) {
+    KEYS_LOCK();
+    for(uint8_t i=0;i<8;i++) {
+        bitmap[i*4+0] = key_held[i];
+        bitmap[i*4+1] = key_held[i] >> 8;
+        bitmap[i*4+2] = key_held[i] >> 16;
+        bitmap[i*4+3] = key_held[i] >> 24;
+    }
+    uint8_t mods = key_held[7] & 0xff;
+    KEYS_UNLOCK();
+    return mods;
+}
+
+// A char or LV_KEY_ for LVGL's keyboard input device, from the keyboard task
+void lvgl_key_put(uint32_t key) {
+    KEYS_LOCK();
+    if(lvgl_keys_queued < KEY_LVGL_QUEUE) {
+        lvgl_keys[(lvgl_keys_head + lvgl_keys_queued) % KEY_LVGL_QUEUE] = key;
+        lvgl_keys_queued++;
+    }
+    KEYS_UNLOCK();
+}
+
+void lvgl_keyboard_read(lv_indev_t * indev_drv, lv_indev_data_t * data) {
+    (void) indev_drv;     // unused
+
+    static bool dummy_read = false;
+    KEYS_LOCK();
+    uint16_t len = lvgl_keys_queued;
+    uint32_t key = lvgl_keys[lvgl_keys_head];
+    if(!dummy_read && len > 0) {
+        lvgl_keys_head = (lvgl_keys_head + 1) % KEY_LVGL_QUEUE;
+        lvgl_keys_queued--;
+    }
+    KEYS_UNLOCK();
+
+    // Send a release manually
+    if (dummy_read) {
+        dummy_read = false;
+        data->state = LV_INDEV_STATE_RELEASED;
+        data->continue_reading = len > 0;
+    }
+        // Send the pressed character 
+    else if (len > 0) {
+        dummy_read = true;
+        data->state = LV_INDEV_STATE_PRESSED;
+        data->key = key;
+        data->continue_reading = true;
+    }
+}
+
 extern int16_t lvgl_is_repl;
 extern mp_obj_t keyboard_callback, ui_quit_callback, ui_switch_callback;
 
 void send_key_to_micropython(uint16_t c) {
     // handle the global system hotkeys before anything else. we have two, ctrl-tab and ctrl-q 
     if(c==17) {
-        mp_sched_schedule(ui_quit_callback, NULL);
+        tulip_schedule(EVENT_INPUT, ui_quit_callback, NULL);
     } else if (c==263) {
-        mp_sched_schedule(ui_switch_callback, NULL);
+        tulip_schedule(EVENT_INPUT, ui_switch_callback, NULL);
     } else {
-        // Call the callback if set
-        if(keyboard_callback != NULL) 
-            mp_sched_schedule(keyboard_callback, mp_obj_new_int(c));
+        // Queue it for the callback if set. One scheduled call runs it for every char waiting
+        if(keyboard_callback != NULL) {
+            uint8_t queued = 0;
+            KEYS_LOCK();
+            if(key_chars_queued < KEY_CHAR_QUEUE) {
+                key_chars[key_chars_queued++] = c;
+                queued = 1;
+            }
+            KEYS_UNLOCK();
+            if(queued) tulip_keyboard_isr();
+        }
 
         // If something is taking in chars from LVGL (text area etc), don't send the char to MP
         if (c==mp_interrupt_char) {
@@ -19,6 +19,7 @@
 #include "py/runtime.h"
 #include "py/mphal.h"
 #include "display.h"
+#include "polyfills.h"
 
 extern uint8_t keyboard_send_keys_to_micropython;
 extern int8_t keyboard_grab_ui_focus;
@@ -43,6 +44,42 @@ extern key_remap key_remaps[MAX_KEY_REMAPS];
 extern uint8_t last_held_code;
 extern uint16_t last_held_modifier;
 
+// How long you hold down a key before it starts repeating
+#define KEY_REPEAT_TRIGGER_MS 500
+// How often (in ms) to repeat a key once held
+#define KEY_REPEAT_INTER_MS 90
+
+// Key downs, ups and repeats, queued on the keyboard task until python takes them with tulip.key_events()
+enum {
+    KEY_EVENT_UP = 0,
+    KEY_EVENT_DOWN,
+    KEY_EVENT_REPEAT,
+};
+
+typedef struct {
+    uint32_t ms;        // get_ticks_ms() when it happened
+    uint16_t code;      // what scan_ascii made of it, 0 for none (and for ups)
+    uint8_t scan;
+    uint8_t mods;       // KEY_MOD_ bits held at the time
+    uint8_t kind;
+} key_event_t;
+
+#define KEY_EVENT_QUEUE 64
+// Chars waiting for the keyboard_callback, and for LVGL
+#define KEY_CHAR_QUEUE 64
+#define KEY_LVGL_QUEUE 128
+
+void key_event(uint8_t kind, uint8_t scan, uint16_t code);
+uint16_t key_repeat_poll();
+uint8_t key_events_take(key_event_t *out, uint8_t max);
+uint8_t key_chars_take(uint16_t *out, uint8_t max);
+uint8_t keys_held(uint8_t *bitmap);
+void lvgl_key_put(uint32_t key);
+
+// in modtulip, schedule the python callbacks
+void tulip_keyboard_isr();
+void tulip_key_event_isr();
+
 
 /**
  * Modifier masks - used for the first byte in the HID report.
@@ -0,0 +1,193 @@
+// lvgl_png.c
+// An LVGL image decoder for PNGs that goes straight to the display's RGB332, with an A8 plane after it when the
+// PNG has any transparency. LVGL's own lodepng decoder makes ARGB8888 and converts it at every draw, 4x the RAM
+// and a lot of the draw time for icons. Decoded images go in LVGL's image cache (an LRU bounded by
+// LV_CACHE_DEF_SIZE, in the arena, so SPIRAM on the ESP) so an icon on screen is only decoded once.
+// Decoding runs on the LVGL draw threads, which can't read files through the VFS, so python hands us the PNG
+// bytes and lvgl_png_source() keeps one copy of them per distinct PNG in the arena. That also gives each image a
+// source pointer that never changes, which is what the cache is keyed on. Each python source object holds a
+// reference, the widgets they're set on keep those alive, and a copy nothing refers to is freed.
+
+#include "lvgl_png.h"
+#include <string.h>
+#include <stddef.h>
+#include "lodepng.h"
+#include "display.h"
+
+typedef struct lvgl_png_s {
+    struct lvgl_png_s *next;
+    uint32_t hash;
+    uint32_t refs;          // python objects handing out this source
+    lv_image_dsc_t dsc;     // data points just past the struct
+} lvgl_png_t;
+
+// Only touched from the MP task
+static lvgl_png_t *pngs = NULL;
+
+static const uint8_t png_magic[8] = {0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a};
+
+static uint32_t be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+uint8_t lvgl_png_is_png(const uint8_t *data, uint32_t len) {
+    // magic, then IHDR has to be the first chunk
+    return len >= 33 && memcmp(data, png_magic, 8) == 0 && memcmp(data + 12, "IHDR", 4) == 0;
+}
+
+// Gray+alpha and RGBA PNGs have alpha, so does anything with a tRNS chunk (which has to come before IDAT)
+static uint8_t png_has_alpha(const uint8_t *data, uint32_t len) {
+    uint8_t color_type = data[25];
+    if(color_type == 4 || color_type == 6) return 1;
+    uint32_t at = 8;
+    while(at + 8 <= len) {
+        uint32_t chunk_len = be32(data + at);
+        const uint8_t *type = data + at + 4;
+        if(memcmp(type, "tRNS", 4) == 0) return 1;
+        if(memcmp(type, "IDAT", 4) == 0) return 0;
+        if(chunk_len > len) return 0;
+        at += 12 + chunk_len;
+    }
+    return 0;
+}
+
+static lv_result_t decoder_info(lv_image_decoder_t *decoder, const void *src, lv_image_header_t *header) {
+    LV_UNUSED(decoder);
+    if(lv_image_src_get_type(src) != LV_IMAGE_SRC_VARIABLE) return LV_RESULT_INVALID;
+    const lv_image_dsc_t *img = src;
+    if(!lvgl_png_is_png(img->data, img->data_size)) return LV_RESULT_INVALID;
+    header->w = be32(img->data + 16);
+    header->h = be32(img->data + 20);
+    header->cf = png_has_alpha(img->data, img->data_size) ? LV_COLOR_FORMAT_RGB332A8 : LV_COLOR_FORMAT_RGB332;
+    return LV_RESULT_OK;
+}
+
+static lv_draw_buf_t *decode_png(const uint8_t *data, uint32_t len) {
+    unsigned char *rgba = NULL;
+    unsigned w, h;
+    unsigned error = lodepng_decode_memory(&rgba, &w, &h, data, len, LCT_RGBA, 8);
+    if(error) {
+        LV_LOG_WARN("error %u: %s", error, lodepng_error_text(error));
+        if(rgba != NULL) free_caps(rgba);
+        return NULL;
+    }
+    lv_color_format_t cf = png_has_alpha(data, len) ? LV_COLOR_FORMAT_RGB332A8 : LV_COLOR_FORMAT_RGB332;
+    lv_draw_buf_t *decoded = lv_draw_buf_create(w, h, cf, 0);
+    if(decoded == NULL) {
+        free_caps(rgba);
+        return NULL;
+    }
+    uint32_t stride = decoded->header.stride;
+    uint8_t *alpha = decoded->data + stride * h;
+    const uint8_t *s = rgba;
+    for(uint32_t y=0;y<h;y++) {
+        uint8_t *c = decoded->data + y * stride;
+        uint8_t *a = alpha + y * stride;
+        for(uint32_t x=0;x<w;x++, s+=4) {
+            c[x] = color_332(s[0], s[1], s[2]);
+            if(cf == LV_COLOR_FORMAT_RGB332A8) a[x] = s[3];
+        }
+    }
+    free_caps(rgba);
+    return decoded;
+}
+
+static lv_result_t decoder_open(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+    if(dsc->src_type != LV_IMAGE_SRC_VARIABLE) return LV_RESULT_INVALID;
+    const lv_image_dsc_t *img = dsc->src;
+    lv_draw_buf_t *decoded = decode_png(img->data, img->data_size);
+    if(decoded == NULL) return LV_RESULT_INVALID;
+
+    lv_draw_buf_t *adjusted = lv_image_decoder_post_process(dsc, decoded);
+    if(adjusted == NULL) {
+        lv_draw_buf_destroy(decoded);
+        return LV_RESULT_INVALID;
+    }
+    if(adjusted != decoded) {
+        lv_draw_buf_destroy(decoded);
+        decoded = adjusted;
+    }
+    dsc->decoded = decoded;
+
+    if(dsc->args.no_cache || !lv_image_cache_is_enabled()) return LV_RESULT_OK;
+
+    lv_image_cache_data_t search_key;
+    search_key.src_type = dsc->src_type;
+    search_key.src = dsc->src;
+    search_key.slot.size = decoded->data_size;
+    lv_cache_entry_t *entry = lv_image_decoder_add_to_cache(decoder, &search_key, decoded, NULL);
+    if(entry == NULL) return LV_RESULT_INVALID;
+    dsc->cache_entry = entry;
+    return LV_RESULT_OK;
+}
+
+static void decoder_close(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc) {
+    LV_UNUSED(decoder);
+    if(dsc->args.no_cache || !lv_image_cache_is_enabled())
+        lv_draw_buf_destroy((lv_draw_buf_t *)dsc->decoded);
+    else
+        lv_cache_release(dsc->cache, dsc->cache_entry, NULL);
+}
+
+// After lv_init. Decoders made later are tried first, so this goes ahead of the built in ones
+void lvgl_png_init() {
+    lv_image_decoder_t *dec = lv_image_decoder_create();
+    lv_image_decoder_set_info_cb(dec, decoder_info);
+    lv_image_decoder_set_open_cb(dec, decoder_open);
+    lv_image_decoder_set_close_cb(dec, decoder_close);
+    pngs = NULL;
+}
+
+// Free the copies nobody holds anymore, and their decoded images, so a later PNG at the same address can't
+// pick up a stale cache entry
+static void png_sweep() {
+    lvgl_png_t **link = &pngs;
+    while(*link != NULL) {
+        lvgl_png_t *p = *link;
+        if(p->refs) {
+            link = &p->next;
+            continue;
+        }
+        *link = p->next;
+        lv_image_cache_drop(&p->dsc);
+        lv_free(p);
+    }
+}
+
+// An image source for these PNG bytes, with a reference taken for the caller. The same PNG twice gets the same
+// source, and so shares a cache entry. NULL if it's not a PNG or the arena is full
+const lv_image_dsc_t *lvgl_png_source(const uint8_t *data, uint32_t len) {
+    if(!lvgl_png_is_png(data, len)) return NULL;
+    png_sweep();
+    uint32_t hash = 2166136261u; // FNV-1a
+    for(uint32_t i=0;i<len;i++) hash = (hash ^ data[i]) * 16777619u;
+    for(lvgl_png_t *p = pngs; p != NULL; p = p->next) {
+        if(p->hash == hash && p->dsc.data_size == len && memcmp(p->dsc.data, data, len) == 0) {
+            p->refs++;
+            return &p->dsc;
+        }
+    }
+    lvgl_png_t *p = lv_malloc(sizeof(lvgl_png_t) + len);
+    if(p == NULL) return NULL;
+    uint8_t *copy = (uint8_t*)(p + 1);
+    memcpy(copy, data, len);
+    lv_memzero(&p->dsc, sizeof(p->dsc));
+    p->dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+    p->dsc.header.w = be32(data + 16);
+    p->dsc.header.h = be32(data + 20);
+    p->dsc.header.cf = png_has_alpha(data, len) ? LV_COLOR_FORMAT_RGB332A8 : LV_COLOR_FORMAT_RGB332;
+    p->dsc.data = copy;
+    p->dsc.data_size = len;
+    p->hash = hash;
+    p->refs = 1;
+    p->next = pngs;
+    pngs = p;
+    return &p->dsc;
+}
+
+// Drop a reference from lvgl_png_source. This comes from a GC finaliser, which can run in the middle of an LVGL
+// call, so the copy itself is only freed by the next lvgl_png_source
+void lvgl_png_release(const lv_image_dsc_t *dsc) {
+    lvgl_png_t *p = (lvgl_png_t*)((uint8_t*)dsc - offsetof(lvgl_png_t, dsc));
+    if(p->refs) p->refs--;
+}
@@ -0,0 +1,13 @@
+// lvgl_png.h
+// PNGs for LVGL images, decoded straight to RGB332 and cached
+#ifndef __LVGL_PNGH
+#define __LVGL_PNGH
+
+#include "lvgl.h"
+
+void lvgl_png_init();
+uint8_t lvgl_png_is_png(const uint8_t *data, uint32_t len);
+const lv_image_dsc_t *lvgl_png_source(const uint8_t *data, uint32_t len);
+void lvgl_png_release(const lv_image_dsc_t *dsc);
+
+#endif
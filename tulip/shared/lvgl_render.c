@@ -0,0 +1,143 @@
+// lvgl_render.c
+// LVGL's display refresh on its own thread (a task on core 0 on Tulip CC), so python keeps running while LVGL draws.
+// The MP task still runs lv_task_handler, so timers, input, animations and every python callback stay on it, and
+// it lays out the screens. Then it hands the refresh to the render thread and goes back to python. LVGL isn't
+// thread safe, so until that refresh is done anything on the MP task that touches LVGL calls lvgl_render_wait()
+// first. The binding does that for every call from python (see LV_MP_WAIT in lv_conf.h).
+// Nothing changes the layout while a refresh runs, so the only python it could reach is a draw event callback.
+// Those can't run off the MP task: the first one turns the render thread off for good, and the MP task refreshes
+// in lv_task_handler again like it used to.
+
+#include "lvgl_render.h"
+#include "src/display/lv_display_private.h"
+#include "perf.h"
+#ifdef ESP_PLATFORM
+#include "tasks.h"
+#include "freertos/semphr.h"
+#else
+#include <pthread.h>
+#endif
+
+static lv_display_t *render_display = NULL;
+static volatile uint8_t rendering = 0;
+static volatile uint8_t render_sync = 0;    // a draw event wanted python, refresh on the MP task from now on
+static uint8_t render_sync_was = 0;
+
+static void render_refresh() {
+    int64_t tic = get_time_us();
+    _lv_display_refr_timer(NULL);
+    perf_record(PERF_LVGL_RENDER, (uint32_t)tic, (uint32_t)(get_time_us() - tic));
+}
+
+#ifdef ESP_PLATFORM
+TaskHandle_t lvgl_render_handle;
+static SemaphoreHandle_t render_done;
+static uint8_t render_owed = 0; // MP task only, a refresh was handed off that we haven't taken render_done for
+
+static void render_task(void *pvParameters) {
+    while(1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        render_refresh();
+        rendering = 0;
+        xSemaphoreGive(render_done);
+    }
+}
+
+static uint8_t render_on_thread() {
+    return xTaskGetCurrentTaskHandle() == lvgl_render_handle;
+}
+
+void lvgl_render_wait() {
+    if(!render_owed) return;
+    xSemaphoreTake(render_done, portMAX_DELAY);
+    render_owed = 0;
+}
+
+static void render_start() {
+    rendering = 1;
+    render_owed = 1;
+    xTaskNotifyGive(lvgl_render_handle);
+}
+
+static void render_thread_start() {
+    render_done = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(&render_task, LVGL_RENDER_TASK_NAME, LVGL_RENDER_TASK_STACK_SIZE / sizeof(StackType_t), NULL, LVGL_RENDER_TASK_PRIORITY, &lvgl_render_handle, LVGL_RENDER_TASK_COREID);
+}
+#else
+static pthread_t render_thread;
+static pthread_mutex_t render_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_go = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t render_done = PTHREAD_COND_INITIALIZER;
+
+static void *render_worker(void *vargp) {
+    while(1) {
+        pthread_mutex_lock(&render_lock);
+        while(!rendering) pthread_cond_wait(&render_go, &render_lock);
+        pthread_mutex_unlock(&render_lock);
+        render_refresh();
+        pthread_mutex_lock(&render_lock);
+        rendering = 0;
+        pthread_cond_signal(&render_done);
+        pthread_mutex_unlock(&render_lock);
+    }
+    return NULL;
+}
+
+static uint8_t render_on_thread() {
+    return pthread_equal(pthread_self(), render_thread);
+}
+
+void lvgl_render_wait() {
+    pthread_mutex_lock(&render_lock);
+    while(rendering) pthread_cond_wait(&render_done, &render_lock);
+    pthread_mutex_unlock(&render_lock);
+}
+
+static void render_start() {
+    pthread_mutex_lock(&render_lock);
+    rendering = 1;
+    pthread_cond_signal(&render_go);
+    pthread_mutex_unlock(&render_lock);
+}
+
+static void render_thread_start() {
+    pthread_create(&render_thread, NULL, render_worker, NULL);
+    pthread_detach(render_thread);
+}
+#endif
+
+// From setup_lvgl, once the display is made. The refresh stops being an LVGL timer, lvgl_task_handler starts it
+void lvgl_render_init() {
+    render_display = lv_display_get_default();
+    lv_display_delete_refr_timer(render_display);
+    render_thread_start();
+}
+
+// Whether the binding can call python here. Off the MP task it can't, and that means python wants to draw
+uint8_t lvgl_render_python_ok() {
+    if(!render_on_thread()) return 1;
+    render_sync = 1;
+    return 0;
+}
+
+// On the MP task every frame. If the last refresh is still drawing, this frame's LVGL work waits for the next
+void lvgl_task_handler() {
+    if(rendering) return;
+    lvgl_render_wait();
+    lv_task_handler();
+    if(render_sync) {
+        // Draw that frame again now python can see the draw events
+        if(!render_sync_was) lv_obj_invalidate(lv_display_get_screen_active(render_display));
+        render_sync_was = 1;
+        render_refresh();
+        return;
+    }
+    // Lay out here, where layout events can reach python, so the refresh finds nothing to lay out
+    lv_obj_update_layout(lv_display_get_screen_active(render_display));
+    if(lv_display_get_screen_prev(render_display)) lv_obj_update_layout(lv_display_get_screen_prev(render_display));
+    lv_obj_update_layout(lv_display_get_layer_bottom(render_display));
+    lv_obj_update_layout(lv_display_get_layer_top(render_display));
+    lv_obj_update_layout(lv_display_get_layer_sys(render_display));
+    if(render_display->inv_p == 0) return;
+    render_start();
+}
@@ -0,0 +1,13 @@
+// lvgl_render.h
+// LVGL's display refresh on its own thread, so python keeps running while LVGL draws
+#ifndef __LVGL_RENDERH
+#define __LVGL_RENDERH
+
+#include "lvgl.h"
+
+void lvgl_render_init();
+void lvgl_task_handler();
+void lvgl_render_wait();
+uint8_t lvgl_render_python_ok();
+
+#endif
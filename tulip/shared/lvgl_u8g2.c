@@ -10,7 +10,29 @@
 // will make this less nasty asap
 #define MAX_FONT_W 50
 #define MAX_FONT_H 80
-uint8_t databuf[MAX_FONT_W*MAX_FONT_H];
+// LVGL's draw units each render text on their own thread, so the one glyph buffer is shared under a lock.
+// It remembers which glyph it holds, and the bitmap cb draws it again if another thread got in between
+static uint8_t databuf[MAX_FONT_W*MAX_FONT_H];
+static lv_mutex_t databuf_lock;
+static uint8_t databuf_ready = 0;
+static uint32_t databuf_font_no = UINT32_MAX;
+static uint32_t databuf_letter = UINT32_MAX;
+
+// Draw a glyph into databuf, call with databuf_lock held
+static int16_t draw_glyph(uint32_t font_no, uint32_t unicode_letter, u8g2_font_decode_t *font_decode) {
+    u8g2_font_t ufont;
+    ufont.font = NULL; 
+    ufont.font_decode.fg_color = 1; 
+    ufont.font_decode.is_transparent = 1; 
+    ufont.font_decode.dir = 0;
+    u8g2_SetFont(&ufont, tulip_fonts[font_no]);
+    for(uint16_t i=0;i<(MAX_FONT_H*MAX_FONT_W);i++) { databuf[i] = 0; }
+    int16_t adv = u8g2_DrawGlyph_target(&ufont, unicode_letter, databuf);
+    *font_decode = u8g2_GetGlyphInfo(&ufont, unicode_letter);
+    databuf_font_no = font_no;
+    databuf_letter = unicode_letter;
+    return adv;
+}
 
 
 /* Get info about glyph of `unicode_letter` in `font` font.
@@ -31,15 +53,10 @@ bool my_get_glyph_dsc_cb(const lv_font_t * font, lv_font_glyph_dsc_t * dsc_out,
     }
 
     uint32_t font_no = *((uint32_t*)(font->user_data));
-    u8g2_font_t ufont;
-    ufont.font = NULL; 
-    ufont.font_decode.fg_color = 1; 
-    ufont.font_decode.is_transparent = 1; 
-    ufont.font_decode.dir = 0;
-    u8g2_SetFont(&ufont, tulip_fonts[font_no]);
-    for(uint16_t i=0;i<(MAX_FONT_H*MAX_FONT_W);i++) { databuf[i] = 0; }
-    int16_t adv = u8g2_DrawGlyph_target(&ufont, unicode_letter, databuf);
-    u8g2_font_decode_t font_decode = u8g2_GetGlyphInfo(&ufont, unicode_letter);
+    u8g2_font_decode_t font_decode;
+    lv_mutex_lock(&databuf_lock);
+    int16_t adv = draw_glyph(font_no, unicode_letter, &font_decode);
+    lv_mutex_unlock(&databuf_lock);
     
     // debug
        
@@ -62,13 +79,23 @@ bool my_get_glyph_dsc_cb(const lv_font_t * font, lv_font_glyph_dsc_t * dsc_out,
 
 const void * my_get_glyph_bitmap_cb(lv_font_glyph_dsc_t * g_dsc, lv_draw_buf_t * draw_buf)
 {
+    uint32_t font_no = *((uint32_t*)(g_dsc->resolved_font->user_data));
+    uint32_t unicode_letter = g_dsc->gid.index;
+    u8g2_font_decode_t font_decode;
+    lv_mutex_lock(&databuf_lock);
+    if(databuf_font_no != font_no || databuf_letter != unicode_letter) draw_glyph(font_no, unicode_letter, &font_decode);
     for(uint16_t i=0;i<g_dsc->box_w*g_dsc->box_h;i++) draw_buf->data[i] = 0;
     memcpy(draw_buf->data, databuf, g_dsc->box_w*g_dsc->box_h);
+    lv_mutex_unlock(&databuf_lock);
     return draw_buf;
 }
 
 //uint32_t font_no= 5;
 void get_lvgl_font_from_tulip(uint32_t font_no, lv_font_t * outfont) {
+    if(!databuf_ready) {
+        lv_mutex_init(&databuf_lock);
+        databuf_ready = 1;
+    }
     u8g2_font_t ufont;
     ufont.font = NULL; 
     ufont.font_decode.fg_color = 1; 
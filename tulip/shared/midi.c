@@ -1,8 +1,11 @@
 // midi.c
 #include "midi.h"
 #include "polyfills.h"
+#include "perf.h"
+#include "events.h"
 uint8_t last_midi[MIDI_QUEUE_DEPTH][MAX_MIDI_BYTES_PER_MESSAGE];
 uint8_t last_midi_len[MIDI_QUEUE_DEPTH];
+int32_t last_midi_time[MIDI_QUEUE_DEPTH];
 int16_t midi_queue_head = 0;
 int16_t midi_queue_tail = 0;
 extern mp_obj_t midi_callback;
@@ -10,19 +13,21 @@ extern mp_obj_t midi_callback;
 #define DEBUG_MIDI 0
 
 
-static inline void push_midi_message_into_fifo(uint8_t *data, int len) {
+static inline void push_midi_message_into_fifo(uint8_t *data, int len, int32_t sysclock) {
     for(uint32_t i = 0; i < (uint32_t)len; i++) {
         if(i < MAX_MIDI_BYTES_PER_MESSAGE) {
             last_midi[midi_queue_tail][i] = data[i];
         }
     }
     last_midi_len[midi_queue_tail] = (uint16_t)len;
+    last_midi_time[midi_queue_tail] = sysclock;
     midi_queue_tail = (midi_queue_tail + 1) % MIDI_QUEUE_DEPTH;
     if (midi_queue_tail == midi_queue_head) {
         // Queue wrap, drop oldest item.
         midi_queue_head = (midi_queue_head + 1) % MIDI_QUEUE_DEPTH;
         fprintf(stderr, "dropped midi message\n");
     }
+    perf_record(PERF_MIDI_DEPTH, (uint32_t)get_time_us(), (midi_queue_tail - midi_queue_head + MIDI_QUEUE_DEPTH) % MIDI_QUEUE_DEPTH);
 }
 
 
@@ -30,15 +35,20 @@ uint8_t current_midi_status = 0;
 uint8_t midi_message[3];
 uint8_t midi_message_i = 0;
 
-void callback_midi_message_received(uint8_t *data, size_t len) {
-    push_midi_message_into_fifo(data, len);
-    if(midi_callback!=NULL) mp_sched_schedule(midi_callback, mp_const_none);
+void callback_midi_message_received(uint8_t *data, size_t len, int32_t sysclock) {
+    push_midi_message_into_fifo(data, len, sysclock);
+    if(midi_callback!=NULL) tulip_schedule(EVENT_INPUT, midi_callback, mp_const_none);
     current_midi_status = 0;
     midi_message_i = 0;
 }
 
 
 void convert_midi_bytes_to_messages(uint8_t * data, size_t len) {
+    convert_midi_bytes_to_messages_at(data, len, amy_sysclock());
+}
+
+// For backends that know when the bytes arrived better than now
+void convert_midi_bytes_to_messages_at(uint8_t * data, size_t len, int32_t sysclock) {
     // i take any amount of bytes and add messages to the fifo
     for(size_t i=0;i<len;i++) {
         uint8_t byte = data[i];
@@ -50,7 +60,7 @@ void convert_midi_bytes_to_messages(uint8_t * data, size_t len) {
             midi_message_i = 1;
             midi_message[0] = byte;
             if(byte == 0xF6 || byte == 0xF8 || byte == 0xFA || byte == 0xFB || byte == 0xFC || byte == 0xFF) {
-                callback_midi_message_received(midi_message, 1);                
+                callback_midi_message_received(midi_message, 1, sysclock);                
             } else {
                 // skip.. sysex... 
             }
@@ -59,12 +69,12 @@ void convert_midi_bytes_to_messages(uint8_t * data, size_t len) {
             if(status == 0x80 || status == 0x90 || status == 0xA0 || status == 0xB0 || status == 0xE0) {
                 midi_message[midi_message_i++] = byte;
                 if(midi_message_i >= 3) { 
-                    callback_midi_message_received(midi_message, 3);
+                    callback_midi_message_received(midi_message, 3, sysclock);
                 }
             } else if(status == 0xC0 || status == 0xD0) {
                 midi_message[midi_message_i++] = byte;
                 if(midi_message_i >= 2) { 
-                    callback_midi_message_received(midi_message, 2);
+                    callback_midi_message_received(midi_message, 2, sysclock);
                 }
             } else {
                 // fs or a 0 -- skip. the only F that has data we don't care about right now
@@ -79,6 +89,13 @@ void midi_local(uint8_t * bytes, uint16_t len) {
     convert_midi_bytes_to_messages(bytes, len);
 }
 
+#ifndef ALSA_MIDI
+// Only the ALSA backend can schedule, everywhere else it goes out now
+void midi_out_at(uint8_t * bytes, uint16_t len, int32_t sysclock) {
+    midi_out(bytes, len);
+}
+#endif
+
 #ifdef ESP_PLATFORM
 QueueHandle_t uart_queue;
 
@@ -138,6 +155,8 @@ void run_midi() {
 // midi out is in virtualmidi 
 #ifdef MACOS
 // defined in virtualmidi.m
+#elif defined(ALSA_MIDI)
+// defined in desktop/alsamidi.c
 #else
 void midi_out(uint8_t * bytes, uint16_t len) {
     // nothing yet
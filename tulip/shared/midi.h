@@ -10,6 +10,7 @@ extern QueueHandle_t uart_queue;
 #include "py/mphal.h"
 #include "py/runtime.h"
 void convert_midi_bytes_to_messages(uint8_t * data, size_t len);
+void convert_midi_bytes_to_messages_at(uint8_t * data, size_t len, int32_t sysclock);
 extern mp_obj_t midi_callback;
 
 
@@ -18,10 +19,12 @@ extern mp_obj_t midi_callback;
 #define MIDI_QUEUE_DEPTH 48
 extern uint8_t last_midi[MIDI_QUEUE_DEPTH][MAX_MIDI_BYTES_PER_MESSAGE];
 extern uint8_t last_midi_len[MIDI_QUEUE_DEPTH];
+extern int32_t last_midi_time[MIDI_QUEUE_DEPTH]; // AMY sysclock ms each message arrived
 extern int16_t midi_queue_tail;
 extern int16_t midi_queue_head;
 
 void midi_out(uint8_t * bytes, uint16_t len);
+void midi_out_at(uint8_t * bytes, uint16_t len, int32_t sysclock);
 void midi_local(uint8_t * bytes, uint16_t len);
 
 #ifdef ESP_PLATFORM
@@ -8,8 +8,24 @@
 #include "py/mphal.h"
 #include "display.h"
 #include "bresenham.h"
+#include "displaylist.h"
+#include "perf.h"
+#include "bench.h"
+#include "capture.h"
+#include "events.h"
+#include "vector.h"
+#include "copper.h"
+#include "tilemap.h"
+#include "lvgl_png.h"
+#include "lvgl_render.h"
+#include "surface.h"
+#include "motion.h"
+#include "collide.h"
+#include "gesture.h"
 #include "extmod/vfs.h"
 #include "py/stream.h"
+#include "py/objarray.h"
+#include "py/binary.h"
 #include "alles.h"
 #include "midi.h"
 #include "ui.h"
@@ -102,6 +118,225 @@ STATIC mp_obj_t tulip_gpu_log(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_gpu_log_obj, 0, 0, tulip_gpu_log);
 
+// tulip.perf(True) # clear and start recording perf counters
+// tulip.perf(False) # stop recording
+// stats = tulip.perf() # {"frame": (last, mean, max, samples), ...} over the last PERF_RING_SIZE samples
+STATIC mp_obj_t tulip_perf(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 1) {
+        if(mp_obj_is_true(args[0])) perf_start(); else perf_stop();
+        return mp_const_none;
+    }
+    // Work the stats out before making any objects, so nothing can raise while samples is ours
+    perf_sample_t *samples = (perf_sample_t*)malloc_caps(PERF_RING_SIZE * sizeof(perf_sample_t), MALLOC_CAP_SPIRAM);
+    if(samples == NULL) mp_raise_OSError(MP_ENOMEM);
+    uint32_t last[PERF_CHANNELS], max[PERF_CHANNELS];
+    uint16_t count[PERF_CHANNELS];
+    float mean[PERF_CHANNELS];
+    for(uint8_t ch=0;ch<PERF_CHANNELS;ch++) {
+        uint16_t n = perf_snapshot(ch, samples);
+        uint64_t sum = 0;
+        max[ch] = 0;
+        for(uint16_t i=0;i<n;i++) {
+            sum += samples[i].value;
+            if(samples[i].value > max[ch]) max[ch] = samples[i].value;
+        }
+        last[ch] = n ? samples[n-1].value : 0;
+        mean[ch] = n ? (float)sum / (float)n : 0;
+        count[ch] = n;
+    }
+    free_caps(samples);
+    mp_obj_t dict = mp_obj_new_dict(PERF_CHANNELS);
+    for(uint8_t ch=0;ch<PERF_CHANNELS;ch++) {
+        mp_obj_t tuple[4];
+        tuple[0] = mp_obj_new_int_from_uint(last[ch]);
+        tuple[1] = mp_obj_new_float(mean[ch]);
+        tuple[2] = mp_obj_new_int_from_uint(max[ch]);
+        tuple[3] = mp_obj_new_int(count[ch]);
+        mp_obj_dict_store(dict, mp_obj_new_str(perf_names[ch], strlen(perf_names[ch])), mp_obj_new_tuple(4, tuple));
+    }
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_perf_obj, 0, 1, tulip_perf);
+
+// tulip.perf_trace("trace.json") # write the recorded counters as Chrome trace / Perfetto JSON
+STATIC mp_obj_t tulip_perf_trace(size_t n_args, const mp_obj_t *args) {
+    int32_t written = perf_write_trace(mp_obj_str_get_str(args[0]));
+    if(written < 0) mp_raise_OSError(MP_ENOMEM);
+    return mp_obj_new_int(written);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_perf_trace_obj, 1, 1, tulip_perf_trace);
+
+// stats = tulip.event_stats() # {"audio": (depth, max_depth, dispatched, dropped, coalesced), ...}
+// tulip.event_stats(True) # same, then reset the counters
+STATIC mp_obj_t tulip_event_stats(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t dict = mp_obj_new_dict(EVENT_CLASSES);
+    for(uint8_t cls=0;cls<EVENT_CLASSES;cls++) {
+        event_stats_t stats;
+        events_stats(cls, &stats);
+        mp_obj_t tuple[5];
+        tuple[0] = mp_obj_new_int(stats.depth);
+        tuple[1] = mp_obj_new_int(stats.max_depth);
+        tuple[2] = mp_obj_new_int_from_uint(stats.dispatched);
+        tuple[3] = mp_obj_new_int_from_uint(stats.dropped);
+        tuple[4] = mp_obj_new_int_from_uint(stats.coalesced);
+        mp_obj_dict_store(dict, mp_obj_new_str(event_class_names[cls], strlen(event_class_names[cls])), mp_obj_new_tuple(5, tuple));
+    }
+    if(n_args > 0 && mp_obj_is_true(args[0])) events_reset_stats();
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_event_stats_obj, 0, 1, tulip_event_stats);
+
+// parts = tulip.amy_render_stats() # [(first_osc, last_osc+1, cost, last_us, max_us, blocks), ...] one per core
+// tulip.amy_render_stats(True) # same, then reset max_us and blocks
+STATIC mp_obj_t tulip_amy_render_stats(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for(uint8_t p=0;p<ALLES_RENDER_PARTITIONS;p++) {
+        alles_partition_t part = alles_partitions[p];
+        mp_obj_t tuple[6];
+        tuple[0] = mp_obj_new_int(part.start);
+        tuple[1] = mp_obj_new_int(part.end);
+        tuple[2] = mp_obj_new_int_from_uint(part.cost);
+        tuple[3] = mp_obj_new_int_from_uint(part.last_us);
+        tuple[4] = mp_obj_new_int_from_uint(part.max_us);
+        tuple[5] = mp_obj_new_int_from_uint(part.blocks);
+        mp_obj_list_append(list, mp_obj_new_tuple(6, tuple));
+    }
+    if(n_args > 0 && mp_obj_is_true(args[0])) alles_partition_reset_stats();
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_amy_render_stats_obj, 0, 1, tulip_amy_render_stats);
+
+// (used, free, biggest_free, frag_pct, max_used, pools, failed) = tulip.lv_mem() # LVGL's arena, outside the python heap
+STATIC mp_obj_t tulip_lv_mem(void) {
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    uint32_t pools, failed;
+    lv_mem_arena_info(&pools, &failed);
+    mp_obj_t tuple[7];
+    tuple[0] = mp_obj_new_int_from_uint(mon.total_size - mon.free_size);
+    tuple[1] = mp_obj_new_int_from_uint(mon.free_size);
+    tuple[2] = mp_obj_new_int_from_uint(mon.free_biggest_size);
+    tuple[3] = mp_obj_new_int(mon.frag_pct);
+    tuple[4] = mp_obj_new_int_from_uint(mon.max_used);
+    tuple[5] = mp_obj_new_int(pools);
+    tuple[6] = mp_obj_new_int_from_uint(failed);
+    return mp_obj_new_tuple(7, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(tulip_lv_mem_obj, tulip_lv_mem);
+
+// What tulip.lv_png returns. Its buffer is the pointer to the source, which is how the LVGL binding takes a
+// pointer argument, and it holds a reference to the source until the GC finalises it
+typedef struct _tulip_lv_png_src_obj_t {
+    mp_obj_base_t base;
+    const lv_image_dsc_t *dsc;
+} tulip_lv_png_src_obj_t;
+
+STATIC mp_obj_t tulip_lv_png_src_del(mp_obj_t self_in) {
+    tulip_lv_png_src_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if(self->dsc != NULL) lvgl_png_release(self->dsc);
+    self->dsc = NULL;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(tulip_lv_png_src_del_obj, tulip_lv_png_src_del);
+
+STATIC mp_int_t tulip_lv_png_src_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    tulip_lv_png_src_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if(flags & MP_BUFFER_WRITE) return 1;
+    bufinfo->buf = (void*)&self->dsc;
+    bufinfo->len = sizeof(self->dsc);
+    bufinfo->typecode = BYTEARRAY_TYPECODE;
+    return 0;
+}
+
+STATIC const mp_rom_map_elem_t tulip_lv_png_src_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&tulip_lv_png_src_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(tulip_lv_png_src_locals_dict, tulip_lv_png_src_locals_dict_table);
+
+STATIC MP_DEFINE_CONST_OBJ_TYPE(
+    tulip_lv_png_src_type,
+    MP_QSTR_lv_png,
+    MP_TYPE_FLAG_NONE,
+    buffer, tulip_lv_png_src_get_buffer,
+    locals_dict, &tulip_lv_png_src_locals_dict
+    );
+
+// src = tulip.lv_png(bytes) / tulip.lv_png(filename) # an LVGL image source, decoded to RGB332 and cached when drawn
+// Anything with the buffer protocol (bytearray, memoryview) works as the PNG's bytes
+STATIC mp_obj_t tulip_lv_png(size_t n_args, const mp_obj_t *args) {
+    // Made first, so nothing allocates once the file is mapped or a reference is held
+    tulip_lv_png_src_obj_t *src = m_new_obj_with_finaliser(tulip_lv_png_src_obj_t);
+    src->base.type = &tulip_lv_png_src_type;
+    src->dsc = NULL;
+    // Sweeping old sources drops them from the image cache, which the refresh reads
+    lvgl_render_wait();
+    mp_buffer_info_t bufinfo;
+    tulip_map_t map = {0};
+    if(mp_obj_is_str(args[0])) {
+        if(!tulip_file_map(mp_obj_str_get_str(args[0]), &map)) mp_raise_OSError(MP_ENOENT);
+        bufinfo.buf = map.data;
+        bufinfo.len = map.len;
+    } else {
+        mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    }
+    if(!lvgl_png_is_png((uint8_t*)bufinfo.buf, bufinfo.len)) {
+        tulip_file_unmap(&map);
+        mp_raise_ValueError(MP_ERROR_TEXT("not a PNG"));
+    }
+    src->dsc = lvgl_png_source((uint8_t*)bufinfo.buf, bufinfo.len);
+    tulip_file_unmap(&map);
+    if(src->dsc == NULL) mp_raise_OSError(MP_ENOMEM);
+    return MP_OBJ_FROM_PTR(src);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_lv_png_obj, 1, 1, tulip_lv_png);
+
+// The python object bg_target is drawing into, so the GC keeps it while we do
+MP_REGISTER_ROOT_POINTER(mp_obj_t tulip_bg_target);
+
+// Python can grow or shrink the bg_target buffer (a bytearray that's been appended to) and move it,
+// so every call that draws gets its pixels again first
+STATIC void bg_target_refresh() {
+    mp_obj_t obj = MP_STATE_PORT(tulip_bg_target);
+    if(obj == MP_OBJ_NULL) return;
+    mp_buffer_info_t bufinfo;
+    if(!mp_get_buffer(obj, &bufinfo, MP_BUFFER_WRITE) || bufinfo.len < (size_t)draw_target.w*draw_target.h) {
+        surface_set_target(NULL, 0, 0);
+        MP_STATE_PORT(tulip_bg_target) = MP_OBJ_NULL;
+        mp_raise_ValueError(MP_ERROR_TEXT("bg_target pixels are smaller than w*h now, drawing on the bg again"));
+    }
+    draw_target.pixels = (uint8_t*)bufinfo.buf;
+}
+
+// tulip.bench_list() # [(name, unit), ...] of the native benchmarks
+STATIC mp_obj_t tulip_bench_list(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for(uint16_t i=0;i<bench_count;i++) {
+        mp_obj_t tuple[2];
+        tuple[0] = mp_obj_new_str(benches[i].name, strlen(benches[i].name));
+        tuple[1] = mp_obj_new_str(benches[i].unit, strlen(benches[i].unit));
+        mp_obj_list_append(list, mp_obj_new_tuple(2, tuple));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bench_list_obj, 0, 0, tulip_bench_list);
+
+// (iters, total_us, units) = tulip.bench_run(name, iters=0) # 0 iters uses the benchmark's default
+STATIC mp_obj_t tulip_bench_run(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
+    int16_t i = bench_find(mp_obj_str_get_str(args[0]));
+    if(i < 0) mp_raise_ValueError(MP_ERROR_TEXT("no such benchmark"));
+    uint32_t iters = 0;
+    if(n_args > 1) iters = mp_obj_get_int(args[1]);
+    bench_result_t result;
+    if(!bench_run(i, iters, &result)) mp_raise_OSError(MP_ENOMEM);
+    mp_obj_t tuple[3];
+    tuple[0] = mp_obj_new_int(result.iters);
+    tuple[1] = mp_obj_new_int_from_ll(result.total_us);
+    tuple[2] = mp_obj_new_int_from_ull(result.units);
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bench_run_obj, 1, 2, tulip_bench_run);
+
 
 
 STATIC mp_obj_t tulip_tfb_save(size_t n_args, const mp_obj_t *args) {
@@ -153,62 +388,81 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_ticks_ms_obj, 0, 0, tulip_ticks
 // tulip.bg_pixel(x,y, pal_idx)
 // (r,g,b) = tulip.bg_pixel(x,y)
 STATIC mp_obj_t tulip_bg_pixel(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     if(n_args == 3) { // set
         // Set the pixel
         uint8_t pal_idx = mp_obj_get_int(args[2]);
-        display_set_bg_pixel_pal(x,y,pal_idx);
+        if(dl_recording >= 0) {
+            int16_t a[3] = {x, y, pal_idx};
+            displaylist_record(DL_PIXEL, a, 3, NULL, 0);
+            return mp_const_none;
+        }
+        drawPixel(x,y,pal_idx);
         return mp_const_none; 
     } else { // get the pixel
-        return mp_obj_new_int( display_get_bg_pixel_pal(x,y)); 
+        return mp_obj_new_int(getPixel(x,y)); 
     }
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_pixel_obj, 2, 3, tulip_bg_pixel);
 
 
 
-// This version of bg_clear is 2.5x as fast as the old one, as it's just copying within SPIRAM.
 // tulip.bg_clear(pal_idx)
 // tulip.bg_clear() # uses default
 STATIC mp_obj_t tulip_bg_clear(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint8_t pal_idx = bg_pal_color;
     if(n_args == 1) {
         pal_idx = mp_obj_get_int(args[0]);
     }
-    // Set a single pixel
-    display_set_bg_pixel_pal(0,0,pal_idx);
-    // Copy that pixel
-    for (uint16_t j = 0; j < V_RES+OFFSCREEN_Y_PX; j++) {
-        for (uint16_t i = 0; i < H_RES+OFFSCREEN_X_PX; i++) {
-            (bg)[(((j*(H_RES+OFFSCREEN_X_PX) + i)*BYTES_PER_PIXEL) + 0)] = (bg)[0];
-        }
-    }    
+    if(dl_recording >= 0) {
+        int16_t a[1] = {pal_idx};
+        displaylist_record(DL_CLEAR, a, 1, NULL, 0);
+        return mp_const_none;
+    }
+    if(draw_target.pixels) {
+        surface_clear(&draw_target, pal_idx);
+        return mp_const_none;
+    }
+    display_clear_bg(pal_idx);
     return mp_const_none; 
 }
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_clear_obj, 0, 1, tulip_bg_clear);
 
 
-// tulip.bg_bitmap(x, y, w, h, bitmap)  --> sets or gets bitmap to fb ram
+// tulip.bg_bitmap(x, y, w, h, bitmap)  --> sets or gets bitmap to fb ram (or the bg_target)
+// bitmap can be anything with the buffer protocol: bytes, a bytearray, a Surface's pixels
 STATIC mp_obj_t tulip_bg_bitmap(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     uint16_t w = mp_obj_get_int(args[2]);
     uint16_t h = mp_obj_get_int(args[3]);
+    surface_t target = surface_target();
     if(n_args == 5) {
         // Set the rect with bitmap pixels
         mp_buffer_info_t bufinfo;
-        if (mp_obj_get_type(args[4]) == &mp_type_bytes) {
-            mp_get_buffer(args[4], &bufinfo, MP_BUFFER_READ);
-            display_set_bg_bitmap_raw(x, y, w, h, (uint8_t*)bufinfo.buf);
+        if (mp_get_buffer(args[4], &bufinfo, MP_BUFFER_READ) && bufinfo.len >= (size_t)w*h) {
+            if(dl_recording >= 0) {
+                int16_t a[4] = {x, y, w, h};
+                displaylist_record(DL_BITMAP, a, 4, (uint8_t*)bufinfo.buf, w*h);
+                return mp_const_none;
+            }
+            surface_t src = {(uint8_t*)bufinfo.buf, w, h};
+            surface_blit(&src, 0, 0, w, h, &target, x, y, 1);
         }
         return mp_const_none; 
     } else {
-        // return a bitmap
-        uint8_t bitmap[w*h*BYTES_PER_PIXEL];  
-        display_get_bg_bitmap_raw(x,y,w,h, bitmap);
-        return mp_obj_new_bytes(bitmap, w*h*BYTES_PER_PIXEL);
+        // return a bitmap, straight into the bytes object. Anything off the edge is 0
+        vstr_t vstr;
+        vstr_init_len(&vstr, (size_t)w*h);
+        memset(vstr.buf, 0, vstr.len);
+        surface_t dst = {(uint8_t*)vstr.buf, w, h};
+        surface_blit(&target, x, y, w, h, &dst, 0, 0, 0);
+        return mp_obj_new_bytes_from_vstr(&vstr);
     }
 }
 
@@ -217,12 +471,22 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_bitmap_obj, 4, 5, tulip_bg_b
 
 // tulip.bg_blit(x, y, w, h, x1, y1)  --> copies bitmap ram
 STATIC mp_obj_t tulip_bg_blit(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     uint16_t w = mp_obj_get_int(args[2]);
     uint16_t h = mp_obj_get_int(args[3]);
     uint16_t x1 = mp_obj_get_int(args[4]);
     uint16_t y1 = mp_obj_get_int(args[5]);
+    if(dl_recording >= 0) {
+        int16_t a[7] = {x, y, w, h, x1, y1, n_args > 6};
+        displaylist_record(DL_BLIT, a, 7, NULL, 0);
+        return mp_const_none;
+    }
+    if(draw_target.pixels) {
+        surface_blit(&draw_target, x, y, w, h, &draw_target, x1, y1, n_args > 6);
+        return mp_const_none;
+    }
     if(n_args > 6) {
         display_bg_bitmap_blit_alpha(x,y,w,h,x1,y1);
     } else {
@@ -234,6 +498,65 @@ STATIC mp_obj_t tulip_bg_blit(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_blit_obj, 6, 7, tulip_bg_blit);
 
 
+// Pixels of a w*h surface passed in from python, as a writable buffer
+STATIC surface_t surface_from_obj(mp_obj_t pixels, mp_obj_t w_in, mp_obj_t h_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(pixels, &bufinfo, MP_BUFFER_WRITE);
+    mp_int_t w = mp_obj_get_int(w_in);
+    mp_int_t h = mp_obj_get_int(h_in);
+    if(w <= 0 || h <= 0 || w > 0xffff || h > 0xffff || bufinfo.len < (size_t)w*h) {
+        mp_raise_ValueError(MP_ERROR_TEXT("surface pixels must be at least w*h bytes"));
+    }
+    surface_t s = {(uint8_t*)bufinfo.buf, w, h};
+    return s;
+}
+
+// tulip.bg_target(pixels, w, h) # bg_ drawing, text, bg_png etc now go into these w*h pixels
+// tulip.bg_target() # back to the bg
+STATIC mp_obj_t tulip_bg_target(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0 || args[0] == mp_const_none) {
+        surface_set_target(NULL, 0, 0);
+        MP_STATE_PORT(tulip_bg_target) = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+    if(n_args != 3) mp_raise_TypeError(MP_ERROR_TEXT("bg_target(pixels, w, h)"));
+    surface_t s = surface_from_obj(args[0], args[1], args[2]);
+    MP_STATE_PORT(tulip_bg_target) = args[0];
+    surface_set_target(s.pixels, s.w, s.h);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_target_obj, 0, 3, tulip_bg_target);
+
+
+// tulip.surface_blit(pixels, w, h, x, y, [alpha], [sx, sy, sw, sh]) # draw a surface (or part of it) on the bg_target
+// tulip.surface_blit(None, 0, 0, x, y, [alpha], [sx, sy, sw, sh]) # the source is the bg itself, to grab into a surface
+STATIC mp_obj_t tulip_surface_blit(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
+    if(dl_recording >= 0) mp_raise_ValueError(MP_ERROR_TEXT("surface_blit can't be recorded"));
+    surface_t src;
+    if(args[0] == mp_const_none) src = surface_bg();
+    else src = surface_from_obj(args[0], args[1], args[2]);
+    int16_t x = mp_obj_get_int(args[3]);
+    int16_t y = mp_obj_get_int(args[4]);
+    uint8_t alpha = (n_args > 5) ? mp_obj_is_true(args[5]) : 0;
+    int16_t sx = 0, sy = 0, sw = src.w, sh = src.h;
+    if(n_args == 10) {
+        sx = mp_obj_get_int(args[6]);
+        sy = mp_obj_get_int(args[7]);
+        sw = mp_obj_get_int(args[8]);
+        sh = mp_obj_get_int(args[9]);
+    } else if(n_args > 6) {
+        mp_raise_TypeError(MP_ERROR_TEXT("source rect needs sx, sy, sw, sh"));
+    }
+    surface_t dst = surface_target();
+    surface_blit(&src, sx, sy, sw, sh, &dst, x, y, alpha);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_surface_blit_obj, 5, 10, tulip_surface_blit);
+
+
 
 extern int8_t memorypcm_load(mp_obj_t bytes, uint32_t samplerate, uint8_t midinote, uint32_t loopstart, uint32_t loopend);
 extern void memorypcm_unload_patch(uint8_t patch);
@@ -269,6 +592,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_unload_patch_obj, 0, 1, tulip_u
 // tulip.bg_png(bytes, x,y)
 // tulip.bg_png(filename, x,y)
 STATIC mp_obj_t tulip_bg_png(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     unsigned error;
     unsigned char* image;
     unsigned width, height;
@@ -276,23 +600,25 @@ STATIC mp_obj_t tulip_bg_png(size_t n_args, const mp_obj_t *args) {
     uint16_t y = mp_obj_get_int(args[2]);
 
     mp_buffer_info_t bufinfo;
-    uint8_t file = 0;
+    tulip_map_t map = {0};
     if (mp_obj_get_type(args[0]) == &mp_type_bytes) {
         mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ);
     } else {
-        uint32_t fs = file_size(mp_obj_str_get_str(args[0]));
-        bufinfo.buf = malloc_caps(fs, MALLOC_CAP_SPIRAM);
-        bufinfo.len = fs;
-        read_file(mp_obj_str_get_str(args[0]), (uint8_t *)bufinfo.buf, -1, 1);
-        file = 1;
+        if(!tulip_file_map(mp_obj_str_get_str(args[0]), &map)) mp_raise_OSError(MP_ENOENT);
+        bufinfo.buf = map.data;
+        bufinfo.len = map.len;
     }
     error = lodepng_decode_memory(&image, &width, &height, (uint8_t*)bufinfo.buf, bufinfo.len, LCT_RGBA, 8);
     if(error) printf("error %u: %s\n", error, lodepng_error_text(error));
-    display_set_bg_bitmap_rgba(x,y,width,height,image);
-    free_caps(image);
-    if(file) {
-        free_caps(bufinfo.buf);
+    if(dl_recording >= 0) {
+        if(!error) displaylist_record_rgba(x, y, width, height, image);
+    } else if(draw_target.pixels) {
+        if(!error) surface_set_rgba(&draw_target, x, y, width, height, image);
+    } else {
+        display_set_bg_bitmap_rgba(x,y,width,height,image);
     }
+    free_caps(image);
+    tulip_file_unmap(&map);
     return mp_const_none;
 }
 
@@ -365,6 +691,192 @@ STATIC mp_obj_t tulip_bg_scroll_y_offset(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_scroll_y_offset_obj, 2, 2, tulip_bg_scroll_y_offset);
 
 
+// tulip.copper([(y0, y1, palette, flags), (y0, y1, palette, flags, x_offset, y_offset, x_speed, y_speed), ...])
+// tulip.copper() # back to no table
+// Each entry covers lines y0 up to y1, later ones win. y_offset is the first line's, the rest follow on. Goes live at the next frame
+STATIC mp_obj_t tulip_copper(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0 || args[0] == mp_const_none) {
+        copper_off();
+        return mp_const_none;
+    }
+    mp_obj_t *items;
+    size_t count;
+    mp_obj_get_array(args[0], &count, &items);
+    copper_line_t *lines = m_new(copper_line_t, V_RES);
+    copper_scroll_t *scroll = m_new(copper_scroll_t, V_RES);
+    memset(lines, 0, V_RES*sizeof(copper_line_t));
+    memset(scroll, 0, V_RES*sizeof(copper_scroll_t));
+    for(size_t i=0;i<count;i++) {
+        mp_obj_t *e;
+        size_t n;
+        mp_obj_get_array(items[i], &n, &e);
+        if(n != 4 && n != 8) mp_raise_ValueError(MP_ERROR_TEXT("copper entries are (y0, y1, palette, flags) with an optional x_offset, y_offset, x_speed, y_speed"));
+        int32_t first = mp_obj_get_int(e[0]);
+        int32_t y0 = MAX(first, 0);
+        int32_t y1 = MIN(mp_obj_get_int(e[1]), V_RES);
+        int32_t palette = mp_obj_get_int(e[2]);
+        if(palette < 0 || palette >= COPPER_PALETTES) mp_raise_ValueError(MP_ERROR_TEXT("palette out of range"));
+        uint8_t flags = mp_obj_get_int(e[3]) & (COPPER_NO_TFB | COPPER_NO_SPRITES | COPPER_NO_TILES);
+        copper_scroll_t sc = { 0, 0, 0, 0 };
+        if(n == 8) {
+            flags |= COPPER_SCROLL;
+            sc.x_offset = mp_obj_get_int(e[4]);
+            sc.y_offset = mp_obj_get_int(e[5]);
+            sc.x_speed = mp_obj_get_int(e[6]);
+            sc.y_speed = mp_obj_get_int(e[7]);
+        }
+        for(int32_t y=y0;y<y1;y++) {
+            lines[y].palette = palette;
+            lines[y].flags = flags;
+            scroll[y] = sc;
+            scroll[y].y_offset += y - first;
+        }
+    }
+    copper_set(lines, scroll);
+    m_del(copper_line_t, lines, V_RES);
+    m_del(copper_scroll_t, scroll, V_RES);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_copper_obj, 0, 1, tulip_copper);
+
+// tulip.copper_palette(1, lut) # lut is 256 bytes, pal_idx in -> pal_idx out
+// lut = tulip.copper_palette(1)
+STATIC mp_obj_t tulip_copper_palette(size_t n_args, const mp_obj_t *args) {
+    int32_t n = mp_obj_get_int(args[0]);
+    if(n < 1 || n >= COPPER_PALETTES) mp_raise_ValueError(MP_ERROR_TEXT("palette out of range"));
+    if(n_args == 1) return mp_obj_new_bytes(copper_luts + n*256, 256);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_READ);
+    if(bufinfo.len < 256) mp_raise_ValueError(MP_ERROR_TEXT("lut must be 256 bytes"));
+    copper_palette(n, (uint8_t*)bufinfo.buf);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_copper_palette_obj, 1, 2, tulip_copper_palette);
+
+
+// tulip.tile_bitmap(data, tile_w, tile_h) # RGB332 tiles one after another, each tile_w*tile_h bytes
+STATIC mp_obj_t tulip_tile_bitmap(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    uint8_t tile_w = mp_obj_get_int(args[1]);
+    uint8_t tile_h = mp_obj_get_int(args[2]);
+    if(tile_w == 0 || tile_h == 0) mp_raise_ValueError(MP_ERROR_TEXT("tiles must be at least 1x1"));
+    uint32_t count = bufinfo.len / (tile_w * tile_h);
+    if(count == 0 || count > TILE_INDEX_MASK) mp_raise_ValueError(MP_ERROR_TEXT("wrong number of tiles"));
+    if(!tilemap_tiles((uint8_t*)bufinfo.buf, tile_w, tile_h, count)) mp_raise_OSError(MP_ENOMEM);
+    return mp_obj_new_int(count);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_bitmap_obj, 3, 3, tulip_tile_bitmap);
+
+// tiles = tulip.tile_png(pngdata, tile_w, tile_h)
+// tiles = tulip.tile_png("sheet.png", tile_w, tile_h) # cut left to right, top to bottom
+STATIC mp_obj_t tulip_tile_png(size_t n_args, const mp_obj_t *args) {
+    unsigned char* image;
+    unsigned width, height;
+    uint8_t tile_w = mp_obj_get_int(args[1]);
+    uint8_t tile_h = mp_obj_get_int(args[2]);
+    if(tile_w == 0 || tile_h == 0) mp_raise_ValueError(MP_ERROR_TEXT("tiles must be at least 1x1"));
+    mp_buffer_info_t bufinfo;
+    tulip_map_t map = {0};
+    if (mp_obj_get_type(args[0]) == &mp_type_bytes) {
+        mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ);
+    } else {
+        if(!tulip_file_map(mp_obj_str_get_str(args[0]), &map)) mp_raise_OSError(MP_ENOENT);
+        bufinfo.buf = map.data;
+        bufinfo.len = map.len;
+    }
+    unsigned error = lodepng_decode_memory(&image, &width, &height, (uint8_t*)bufinfo.buf, bufinfo.len, LCT_RGBA, 8);
+    tulip_file_unmap(&map);
+    if(error) {
+        printf("error %u: %s\n", error, lodepng_error_text(error));
+        return mp_obj_new_int(0);
+    }
+    int32_t count = tilemap_tiles_rgba(image, width, height, tile_w, tile_h);
+    free_caps(image);
+    if(count < 0) mp_raise_OSError(MP_ENOMEM);
+    return mp_obj_new_int(count);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_png_obj, 3, 3, tulip_tile_png);
+
+// tulip.tile_map(map, map_w, map_h) # map_w*map_h tile numbers, an array('H') or a list. | TILE_FLIP_H, TILE_FLIP_V
+STATIC mp_obj_t tulip_tile_map(size_t n_args, const mp_obj_t *args) {
+    uint16_t map_w = mp_obj_get_int(args[1]);
+    uint16_t map_h = mp_obj_get_int(args[2]);
+    uint32_t n = (uint32_t)map_w * map_h;
+    if(n == 0) mp_raise_ValueError(MP_ERROR_TEXT("map must be at least 1x1"));
+    mp_buffer_info_t bufinfo;
+    uint8_t ok;
+    if(mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ) && (bufinfo.typecode == 'H' || bufinfo.typecode == 'h')) {
+        if(bufinfo.len < n*sizeof(uint16_t)) mp_raise_ValueError(MP_ERROR_TEXT("map is smaller than map_w*map_h"));
+        ok = tilemap_map((uint16_t*)bufinfo.buf, map_w, map_h);
+    } else {
+        mp_obj_t *items;
+        size_t len;
+        mp_obj_get_array(args[0], &len, &items);
+        if(len < n) mp_raise_ValueError(MP_ERROR_TEXT("map is smaller than map_w*map_h"));
+        uint16_t *m = m_new(uint16_t, n);
+        for(uint32_t i=0;i<n;i++) m[i] = mp_obj_get_int(items[i]);
+        ok = tilemap_map(m, map_w, map_h);
+        m_del(uint16_t, m, n);
+    }
+    if(!ok) mp_raise_OSError(MP_ENOMEM);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_map_obj, 3, 3, tulip_tile_map);
+
+// tulip.tile_set(x, y, tile) # one map entry
+// tile = tulip.tile_set(x, y)
+STATIC mp_obj_t tulip_tile_set(size_t n_args, const mp_obj_t *args) {
+    uint16_t x = mp_obj_get_int(args[0]);
+    uint16_t y = mp_obj_get_int(args[1]);
+    if(n_args == 2) return mp_obj_new_int(tilemap_get(x, y));
+    tilemap_set(x, y, mp_obj_get_int(args[2]));
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_set_obj, 2, 3, tulip_tile_set);
+
+// tulip.tile_scroll(x, y, x_speed, y_speed) # the map pixel at the layer's top left, from the next frame
+// (x, y) = tulip.tile_scroll()
+STATIC mp_obj_t tulip_tile_scroll(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        mp_obj_t tuple[2];
+        tuple[0] = mp_obj_new_int(tilemap.x);
+        tuple[1] = mp_obj_new_int(tilemap.y);
+        return mp_obj_new_tuple(2, tuple);
+    }
+    int16_t x_speed = (n_args > 2) ? mp_obj_get_int(args[2]) : 0;
+    int16_t y_speed = (n_args > 3) ? mp_obj_get_int(args[3]) : 0;
+    tilemap_scroll(mp_obj_get_int(args[0]), mp_obj_get_int(args[1]), x_speed, y_speed);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_scroll_obj, 0, 4, tulip_tile_scroll);
+
+// tulip.tile_on() # whole screen
+// tulip.tile_on(top, bottom) # just screen rows top up to bottom
+STATIC mp_obj_t tulip_tile_on(size_t n_args, const mp_obj_t *args) {
+    int16_t top = (n_args > 0) ? mp_obj_get_int(args[0]) : 0;
+    int16_t bottom = (n_args > 1) ? mp_obj_get_int(args[1]) : V_RES;
+    tilemap_show(top, bottom);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_on_obj, 0, 2, tulip_tile_on);
+
+STATIC mp_obj_t tulip_tile_off(size_t n_args, const mp_obj_t *args) {
+    tilemap_hide();
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_tile_off_obj, 0, 0, tulip_tile_off);
+
+
 
 // tulip.tfb_str(x,y, str, [format], [fg_color], [bg_color])
 // (str, format, fg, bg) = tulip.tfb_str(x,y)
@@ -449,14 +961,19 @@ mp_obj_t midi_callback = NULL;
 mp_obj_t frame_callback = NULL; 
 mp_obj_t frame_arg = NULL; 
 mp_obj_t touch_callback = NULL; 
+mp_obj_t motion_callback = NULL;
+mp_obj_t gesture_callback = NULL;
 mp_obj_t keyboard_callback = NULL;
+mp_obj_t key_event_callback = NULL;
 mp_obj_t ui_quit_callback = NULL;
 mp_obj_t ui_switch_callback = NULL;
 
 
 STATIC mp_obj_t mp_lv_task_handler(mp_obj_t arg)
 {  
-    lv_task_handler();
+    int64_t tic = get_time_us();
+    lvgl_task_handler();
+    perf_record(PERF_LVGL, (uint32_t)tic, (uint32_t)(get_time_us() - tic));
     //lv_timer_handler_brian();
     //if(lv_tick_counter++ % 100 == 0) {
     //    fprintf(stderr, "%d ticks, brian %d %2.4f bs/tick\n", lv_tick_counter, brian_counter, (float)(brian_counter)/(float)(lv_tick_counter));
@@ -466,12 +983,12 @@ STATIC mp_obj_t mp_lv_task_handler(mp_obj_t arg)
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_lv_task_handler_obj, mp_lv_task_handler);
 
 void tulip_frame_isr() {
-    // schedule lvgl task
-    mp_sched_schedule((mp_obj_t)&mp_lv_task_handler_obj, mp_const_none);
+    // schedule lvgl task. If the last one hasn't run yet, there's no point in queueing another
+    tulip_schedule_coalesce(EVENT_UI, (mp_obj_t)&mp_lv_task_handler_obj, mp_const_none);
 
     if(frame_callback != NULL) {
-        // Schedule the python callback given to run asap
-        mp_sched_schedule(frame_callback, frame_arg);
+        // Schedule the python callback given to run asap, behind any audio or input events
+        tulip_schedule_coalesce(EVENT_FRAME, frame_callback, frame_arg);
 #ifdef ESP_PLATFORM
         //mp_hal_wake_main_task_from_isr();
 #endif
@@ -479,9 +996,49 @@ void tulip_frame_isr() {
 }
 
 
+// From motion_frame_done when a sprite hit an edge or finished animating. Once a frame at most, python asks which
+void tulip_motion_isr() {
+    if(motion_callback != NULL) {
+        tulip_schedule_coalesce(EVENT_FRAME, motion_callback, mp_const_none);
+    }
+}
+
+
+// From the touch task when a gesture is queued. Coalesced, python takes them all with tulip.gestures()
+void tulip_gesture_isr() {
+    if(gesture_callback != NULL) {
+        tulip_schedule_coalesce(EVENT_INPUT, gesture_callback, mp_const_none);
+    }
+}
+
+
+// Runs keyboard_callback(c) for every char queued since the last time, from one scheduled call
+STATIC mp_obj_t keyboard_drain(mp_obj_t none) {
+    uint16_t chars[KEY_CHAR_QUEUE];
+    uint8_t n = key_chars_take(chars, KEY_CHAR_QUEUE);
+    for(uint8_t i=0;i<n && keyboard_callback != NULL;i++) {
+        mp_call_function_1_protected(keyboard_callback, mp_obj_new_int(chars[i]));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(keyboard_drain_obj, keyboard_drain);
+
+// From send_key_to_micropython when it queued a char for the keyboard_callback
+void tulip_keyboard_isr() {
+    tulip_schedule_coalesce(EVENT_INPUT, (mp_obj_t)&keyboard_drain_obj, mp_const_none);
+}
+
+// From key_event. Coalesced, python takes them all with tulip.key_events()
+void tulip_key_event_isr() {
+    if(key_event_callback != NULL) {
+        tulip_schedule_coalesce(EVENT_INPUT, key_event_callback, mp_const_none);
+    }
+}
+
+
 void tulip_touch_isr(uint8_t up) {
     if(touch_callback != NULL) {
-        mp_sched_schedule(touch_callback, mp_obj_new_int(up)); 
+        tulip_schedule(EVENT_INPUT, touch_callback, mp_obj_new_int(up));
     }
 }
 
@@ -619,6 +1176,19 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_frame_callback_obj, 0, 2, tulip
 
 
 
+// tulip.motion_callback(cb) # cb(None) runs after a frame where sprites hit an edge or finished animating
+// tulip.motion_callback() -- stops
+STATIC mp_obj_t tulip_motion_callback(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        motion_callback = NULL;
+    } else {
+        motion_callback = args[0];
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_motion_callback_obj, 0, 1, tulip_motion_callback);
+
+
 STATIC mp_obj_t tulip_touch_callback(size_t n_args, const mp_obj_t *args) {
     if(n_args == 0) {
         touch_callback = NULL;
@@ -629,6 +1199,33 @@ STATIC mp_obj_t tulip_touch_callback(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_touch_callback_obj, 0, 1, tulip_touch_callback);
 
+// tulip.gesture_callback(cb) # cb(None) runs when there are gestures waiting in tulip.gestures()
+// tulip.gesture_callback() -- stops
+STATIC mp_obj_t tulip_gesture_callback(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        gesture_callback = NULL;
+    } else {
+        gesture_clear();
+        gesture_callback = args[0];
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_gesture_callback_obj, 0, 1, tulip_gesture_callback);
+
+// tulip.key_event_callback(cb) # cb(None) runs when there are key downs / ups waiting in tulip.key_events()
+// tulip.key_event_callback() -- stops
+STATIC mp_obj_t tulip_key_event_callback(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        key_event_callback = NULL;
+    } else {
+        key_event_t drop[KEY_EVENT_QUEUE];
+        key_events_take(drop, KEY_EVENT_QUEUE);
+        key_event_callback = args[0];
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_key_event_callback_obj, 0, 1, tulip_key_event_callback);
+
 STATIC mp_obj_t tulip_keyboard_callback(size_t n_args, const mp_obj_t *args) {
     if(n_args == 0) {
         keyboard_callback = NULL;
@@ -664,25 +1261,38 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_ui_switch_callback_obj, 0, 1, t
 
 
 
+// m = tulip.midi_in()
+// (m, time) = tulip.midi_in(True) # with the AMY sysclock ms it arrived
 STATIC mp_obj_t tulip_midi_in(size_t n_args, const mp_obj_t *args) {
     if(midi_queue_head != midi_queue_tail) {
         int16_t prev_head = midi_queue_head;
         // Step on the head, hope no-one notices before we pop it.
         midi_queue_head = (midi_queue_head + 1) % MIDI_QUEUE_DEPTH;
-        return mp_obj_new_bytes(last_midi[prev_head],
+        mp_obj_t m = mp_obj_new_bytes(last_midi[prev_head],
                                 last_midi_len[prev_head]);
+        if(n_args > 0 && mp_obj_is_true(args[0])) {
+            mp_obj_t tuple[2];
+            tuple[0] = m;
+            tuple[1] = mp_obj_new_int(last_midi_time[prev_head]);
+            return mp_obj_new_tuple(2, tuple);
+        }
+        return m;
     } 
     return mp_const_none;
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_midi_in_obj, 0, 0, tulip_midi_in);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_midi_in_obj, 0, 1, tulip_midi_in);
 
 
+// tulip.midi_out(m)
+// tulip.midi_out(m, time) # at this AMY sysclock ms
 STATIC mp_obj_t tulip_midi_out(size_t n_args, const mp_obj_t *args) {
+    uint8_t at = (n_args > 1 && args[1] != mp_const_none);
+    int32_t sysclock = at ? mp_obj_get_int(args[1]) : 0;
     if(mp_obj_get_type(args[0]) == &mp_type_bytes) {
         mp_buffer_info_t bufinfo;
         mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ);
-        midi_out((uint8_t*)bufinfo.buf, bufinfo.len);
+        if(at) midi_out_at((uint8_t*)bufinfo.buf, bufinfo.len, sysclock); else midi_out((uint8_t*)bufinfo.buf, bufinfo.len);
     } else {
         mp_obj_t *items;
         size_t len;
@@ -691,13 +1301,13 @@ STATIC mp_obj_t tulip_midi_out(size_t n_args, const mp_obj_t *args) {
         for(uint16_t i=0;i<(uint16_t)len;i++) {
             b[i] = mp_obj_get_int(items[i]);
         }
-        midi_out(b, len);
+        if(at) midi_out_at(b, len, sysclock); else midi_out(b, len);
         free_caps(b);
     }
     return mp_const_none;
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_midi_out_obj, 1, 1, tulip_midi_out);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_midi_out_obj, 1, 2, tulip_midi_out);
 
 
 // Send a message on the "local bus", as if it was received from physical midi in
@@ -731,21 +1341,19 @@ STATIC mp_obj_t tulip_sprite_png(size_t n_args, const mp_obj_t *args) {
     unsigned width, height;
     uint16_t mem_pos = mp_obj_get_int(args[1]);
     mp_buffer_info_t bufinfo;
-    uint8_t file = 0;
+    tulip_map_t map = {0};
     if (mp_obj_get_type(args[0]) == &mp_type_bytes) {
         mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ);
     } else {
-        uint32_t fs = file_size(mp_obj_str_get_str(args[0]));
-        bufinfo.buf = malloc_caps(fs, MALLOC_CAP_SPIRAM);
-        bufinfo.len = fs;
-        read_file(mp_obj_str_get_str(args[0]), (uint8_t *)bufinfo.buf, -1, 1);
-        file = 1;
+        if(!tulip_file_map(mp_obj_str_get_str(args[0]), &map)) mp_raise_OSError(MP_ENOENT);
+        bufinfo.buf = map.data;
+        bufinfo.len = map.len;
     }
     error = lodepng_decode_memory(&image, &width, &height, (uint8_t*)bufinfo.buf, bufinfo.len, LCT_RGBA, 8);
     if(error) printf("error %u: %s\n", error, lodepng_error_text(error));
     display_load_sprite_rgba(mem_pos, width*height*BYTES_PER_PIXEL, image);
     free_caps(image);
-    if(file) free_caps(bufinfo.buf);
+    tulip_file_unmap(&map);
     mp_obj_t tuple[3];
     tuple[0] = mp_obj_new_int(width);
     tuple[1] = mp_obj_new_int(height);
@@ -756,13 +1364,12 @@ STATIC mp_obj_t tulip_sprite_png(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_png_obj, 2, 2, tulip_sprite_png);
 
 
-//bytes = sprite_bitmap(bitmap, mem_pos) 
+//bytes = sprite_bitmap(bitmap, mem_pos) # bitmap is bytes, a bytearray, a Surface's pixels...
 //buffer_of_bytes = sprite_bitmap(mem_pos, length)
 STATIC mp_obj_t tulip_sprite_bitmap(size_t n_args, const mp_obj_t *args) {
-    if (mp_obj_get_type(args[0]) == &mp_type_bytes) {
+    mp_buffer_info_t bufinfo;
+    if (mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ)) {
         uint16_t mem_pos = mp_obj_get_int(args[1]);
-        mp_buffer_info_t bufinfo;
-        mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ);
         display_load_sprite_raw(mem_pos, bufinfo.len, bufinfo.buf);
         return mp_obj_new_int(bufinfo.len);
     } 
@@ -782,6 +1389,8 @@ STATIC mp_obj_t tulip_sprite_register(size_t n_args, const mp_obj_t *args) {
     uint32_t mem_pos = mp_obj_get_int(args[1]);
     if(spriteno < SPRITES) {
         sprite_mem[spriteno] = mem_pos;
+        sprite_tf[spriteno].on = 0;
+        vector_clear(spriteno);
     }
     if(n_args > 2) {
         uint16_t width = mp_obj_get_int(args[2]);
@@ -796,6 +1405,103 @@ STATIC mp_obj_t tulip_sprite_register(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_register_obj, 2, 4, tulip_sprite_register);
 
+// sprite_transform(34, scale, degrees, flip) # scale is a number or (x,y), flip is 1 for horizontal, 2 for vertical, 3 both
+STATIC mp_obj_t tulip_sprite_transform(size_t n_args, const mp_obj_t *args) {
+    uint16_t spriteno = mp_obj_get_int(args[0]);
+    float scale_x = 1, scale_y = 1, degrees = 0;
+    uint8_t flip = 0;
+    if(n_args > 1) {
+        if(mp_obj_is_type(args[1], &mp_type_tuple) || mp_obj_is_type(args[1], &mp_type_list)) {
+            mp_obj_t *items;
+            mp_obj_get_array_fixed_n(args[1], 2, &items);
+            scale_x = mp_obj_get_float(items[0]);
+            scale_y = mp_obj_get_float(items[1]);
+        } else {
+            scale_x = scale_y = mp_obj_get_float(args[1]);
+        }
+    }
+    if(n_args > 2) degrees = mp_obj_get_float(args[2]);
+    if(n_args > 3) flip = mp_obj_get_int(args[3]);
+    if(scale_x <= 0 || scale_y <= 0) {
+        mp_raise_ValueError(MP_ERROR_TEXT("scale must be > 0"));
+    }
+    if(spriteno >= SPRITES) {
+        fprintf(stderr, "transform bad spriteno %d\n", spriteno);
+        return mp_const_none;
+    }
+    display_sprite_transform(spriteno, scale_x, scale_y, degrees, flip);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_transform_obj, 1, 4, tulip_sprite_transform);
+
+
+// Shared by sprite_lines, sprite_beziers and sprite_ellipses. prims is a list of tuples, or an array('h') of them flattened
+STATIC mp_obj_t sprite_vector(uint8_t kind, uint8_t len, const mp_obj_t *args) {
+    uint16_t spriteno = mp_obj_get_int(args[0]);
+    if(spriteno >= SPRITES) {
+        fprintf(stderr, "vector bad spriteno %d\n", spriteno);
+        return mp_const_none;
+    }
+    mp_buffer_info_t bufinfo;
+    int32_t segs;
+    if(mp_get_buffer(args[1], &bufinfo, MP_BUFFER_READ) && bufinfo.typecode == 'h') {
+        if(bufinfo.len % (len*sizeof(int16_t))) mp_raise_ValueError(MP_ERROR_TEXT("array length isn't a whole number of shapes"));
+        segs = vector_set(spriteno, kind, (int16_t*)bufinfo.buf, bufinfo.len / (len*sizeof(int16_t)));
+    } else {
+        mp_obj_t *items;
+        size_t count;
+        mp_obj_get_array(args[1], &count, &items);
+        // On the GC heap, so a bad shape raising halfway through doesn't leak it
+        int16_t *prims = m_new(int16_t, count*len);
+        for(size_t i=0;i<count;i++) {
+            mp_obj_t *p;
+            mp_obj_get_array_fixed_n(items[i], len, &p);
+            for(uint8_t j=0;j<len;j++) prims[i*len+j] = mp_obj_get_int(p[j]);
+        }
+        segs = vector_set(spriteno, kind, prims, count);
+        m_del(int16_t, prims, count*len);
+    }
+    if(segs < 0) mp_raise_OSError(MP_ENOMEM);
+    if(spriteno_activated < spriteno+1) spriteno_activated = spriteno+1;
+    if(sprite_vis[spriteno]) sprite_vis[spriteno] = kind;
+    return mp_obj_new_int(segs);
+}
+
+// segments = sprite_lines(12, [(x0,y0,x1,y1,pal_idx), ...])
+STATIC mp_obj_t tulip_sprite_lines(size_t n_args, const mp_obj_t *args) {
+    return sprite_vector(SPRITE_IS_WIREFRAME, VECTOR_LINE_LEN, args);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_lines_obj, 2, 2, tulip_sprite_lines);
+
+// segments = sprite_beziers(12, [(x0,y0,cx,cy,x1,y1,pal_idx), ...])
+STATIC mp_obj_t tulip_sprite_beziers(size_t n_args, const mp_obj_t *args) {
+    return sprite_vector(SPRITE_IS_BEZIER, VECTOR_BEZIER_LEN, args);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_beziers_obj, 2, 2, tulip_sprite_beziers);
+
+// segments = sprite_ellipses(12, [(cx,cy,rx,ry,pal_idx), ...])
+STATIC mp_obj_t tulip_sprite_ellipses(size_t n_args, const mp_obj_t *args) {
+    return sprite_vector(SPRITE_IS_ELLIPSE, VECTOR_ELLIPSE_LEN, args);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_ellipses_obj, 2, 2, tulip_sprite_ellipses);
+
+// (segments, spans, dropped) = sprite_vector_stats() # for the frame on screen
+STATIC mp_obj_t tulip_sprite_vector_stats(size_t n_args, const mp_obj_t *args) {
+    uint32_t segs, spans, dropped;
+    vector_stats(&segs, &spans, &dropped);
+    mp_obj_t tuple[3];
+    tuple[0] = mp_obj_new_int(segs);
+    tuple[1] = mp_obj_new_int(spans);
+    tuple[2] = mp_obj_new_int(dropped);
+    return mp_obj_new_tuple(3, tuple);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_vector_stats_obj, 0, 0, tulip_sprite_vector_stats);
+
 
 //sprite_move(34, x,y)
 STATIC mp_obj_t tulip_sprite_move(size_t n_args, const mp_obj_t *args) {
@@ -806,6 +1512,7 @@ STATIC mp_obj_t tulip_sprite_move(size_t n_args, const mp_obj_t *args) {
         if(check_dim_xy(x,y)) {
             sprite_x_px[spriteno] = x;
             sprite_y_px[spriteno] = y;
+            motion_moveto(spriteno, x, y);
         } else {
             fprintf(stderr, "bad sprite xy %d %d\n", x,y);
         }
@@ -817,9 +1524,113 @@ STATIC mp_obj_t tulip_sprite_move(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_move_obj, 3, 3, tulip_sprite_move);
 
+// px per frame (or per frame per frame) to 16.16
+STATIC int32_t motion_fix(mp_obj_t o) {
+    mp_float_t f = mp_obj_get_float(o);
+    if(!(f >= -MOTION_MAX_V && f <= MOTION_MAX_V)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("velocity and acceleration must be within 4096 px per frame"));
+    }
+    return (int32_t)(f * 65536.0f);
+}
+
+STATIC int16_t motion_bound(mp_obj_t o) {
+    mp_int_t b = mp_obj_get_int(o);
+    if(b < -MOTION_MAX_PX || b > MOTION_MAX_PX) {
+        mp_raise_ValueError(MP_ERROR_TEXT("bounds must be within 16383 px"));
+    }
+    return b;
+}
+
+STATIC mp_obj_t motion_float(int32_t v) {
+    return mp_obj_new_float_from_f((float)v / 65536.0f);
+}
+
+// tulip.sprite_motion(spriteno, vx, vy, [ax, ay], [edge], [x0, y0, x1, y1]) # px per frame, moved every frame from here on
+// (x, y, vx, vy) = tulip.sprite_motion(spriteno) # None if it's not moving
+STATIC mp_obj_t tulip_sprite_motion(size_t n_args, const mp_obj_t *args) {
+    uint16_t spriteno = mp_obj_get_int(args[0]);
+    if(spriteno >= SPRITES) mp_raise_ValueError(MP_ERROR_TEXT("bad sprite number"));
+    if(n_args == 1) {
+        int32_t x, y, vx, vy;
+        if(!motion_get(spriteno, &x, &y, &vx, &vy)) return mp_const_none;
+        mp_obj_t tuple[4] = {motion_float(x), motion_float(y), motion_float(vx), motion_float(vy)};
+        return mp_obj_new_tuple(4, tuple);
+    }
+    if(n_args == 2 || n_args == 4 || (n_args > 6 && n_args < 10)) {
+        mp_raise_TypeError(MP_ERROR_TEXT("sprite_motion(spriteno, vx, vy, [ax, ay], [edge], [x0, y0, x1, y1])"));
+    }
+    int32_t ax = 0, ay = 0;
+    uint8_t edge = MOTION_STOP;
+    int16_t x0 = 0, y0 = 0, x1 = H_RES, y1 = V_RES;
+    if(n_args > 4) { ax = motion_fix(args[3]); ay = motion_fix(args[4]); }
+    if(n_args > 5) edge = mp_obj_get_int(args[5]);
+    if(n_args > 6) {
+        x0 = motion_bound(args[6]); y0 = motion_bound(args[7]);
+        x1 = motion_bound(args[8]); y1 = motion_bound(args[9]);
+    }
+    if(edge > MOTION_FREE) mp_raise_ValueError(MP_ERROR_TEXT("bad edge"));
+    motion_start(spriteno, motion_fix(args[1]), motion_fix(args[2]), ax, ay, edge, x0, y0, x1, y1);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_motion_obj, 1, 10, tulip_sprite_motion);
+
+// tulip.sprite_motion_off(spriteno) # stays where it is
+STATIC mp_obj_t tulip_sprite_motion_off(size_t n_args, const mp_obj_t *args) {
+    motion_stop(mp_obj_get_int(args[0]));
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_motion_off_obj, 1, 1, tulip_sprite_motion_off);
+
+// tulip.sprite_anim(spriteno, mem_pos, frames, period, [frame_bytes], [loop]) # frames in sprite RAM from mem_pos, period display frames each
+// frame = tulip.sprite_anim(spriteno) # -1 if it's not animating
+STATIC mp_obj_t tulip_sprite_anim(size_t n_args, const mp_obj_t *args) {
+    uint16_t spriteno = mp_obj_get_int(args[0]);
+    if(spriteno >= SPRITES) mp_raise_ValueError(MP_ERROR_TEXT("bad sprite number"));
+    if(n_args == 1) return mp_obj_new_int(motion_frame(spriteno));
+    if(n_args < 4) mp_raise_TypeError(MP_ERROR_TEXT("sprite_anim(spriteno, mem_pos, frames, period, [frame_bytes], [loop])"));
+    uint32_t mem_pos = mp_obj_get_int(args[1]);
+    uint16_t frames = mp_obj_get_int(args[2]);
+    uint16_t period = mp_obj_get_int(args[3]);
+    uint32_t frame_bytes = (uint32_t)sprite_w_px[spriteno] * sprite_h_px[spriteno];
+    if(n_args > 4) frame_bytes = mp_obj_get_int(args[4]);
+    uint8_t loop = (n_args > 5) ? mp_obj_is_true(args[5]) : 1;
+    if(frames == 0 || mem_pos + frames * frame_bytes > SPRITE_RAM_BYTES) {
+        mp_raise_ValueError(MP_ERROR_TEXT("frames don't fit in sprite RAM"));
+    }
+    motion_animate(spriteno, mem_pos, frame_bytes, frames, period, loop);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_anim_obj, 1, 6, tulip_sprite_anim);
+
+// tulip.sprite_anim_off(spriteno) # stays on the frame it's showing
+STATIC mp_obj_t tulip_sprite_anim_off(size_t n_args, const mp_obj_t *args) {
+    motion_animate_stop(mp_obj_get_int(args[0]));
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_sprite_anim_off_obj, 1, 1, tulip_sprite_anim_off);
+
+// [(spriteno, events), ...] = tulip.motion_events() # what happened since last time, see tulip.Motion
+STATIC mp_obj_t tulip_motion_events(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for(uint8_t s=0;s<SPRITES;s++) {
+        uint8_t events = motion_take_events(s);
+        if(events) {
+            mp_obj_t tuple[2] = {mp_obj_new_int(s), mp_obj_new_int(events)};
+            mp_obj_list_append(list, mp_obj_new_tuple(2, tuple));
+        }
+    }
+    return list;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_motion_events_obj, 0, 0, tulip_motion_events);
+
 STATIC mp_obj_t tulip_sprite_on(size_t n_args, const mp_obj_t *args) {
     uint16_t spriteno = mp_obj_get_int(args[0]);
-    if(spriteno < SPRITES) sprite_vis[spriteno] = SPRITE_IS_SPRITE;        
+    if(spriteno < SPRITES) sprite_vis[spriteno] = vector_kind(spriteno) ? vector_kind(spriteno) : SPRITE_IS_SPRITE;
     return mp_const_none;
 }
 
@@ -864,6 +1675,56 @@ STATIC mp_obj_t tulip_collisions(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_collisions_obj, 0, 0, tulip_collisions);
 
+// pairs = tulip.collide(result) # result is array('I', [0]*33). result[s] has bit b set if sprite s touches sprite b,
+// result[32] has bit s set if sprite s touches a wall color. Works from sprite positions, not from what was drawn
+STATIC mp_obj_t tulip_collide(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+    if(bufinfo.len < COLLIDE_RESULT_WORDS * sizeof(uint32_t)) {
+        mp_raise_ValueError(MP_ERROR_TEXT("result needs 33 32-bit words"));
+    }
+    uint32_t result[COLLIDE_RESULT_WORDS];
+    uint32_t pairs = collide_run(result);
+    memcpy(bufinfo.buf, result, sizeof(result));
+    return mp_obj_new_int(pairs);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_collide_obj, 1, 1, tulip_collide);
+
+// tulip.collide_walls(pal_idxes) # BG colors sprites can hit, bytes or a list
+// tulip.collide_walls() # no walls
+STATIC mp_obj_t tulip_collide_walls(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        collide_set_walls(NULL, 0);
+        return mp_const_none;
+    }
+    mp_buffer_info_t bufinfo;
+    if(mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ)) {
+        collide_set_walls((uint8_t*)bufinfo.buf, bufinfo.len);
+        return mp_const_none;
+    }
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(args[0], &len, &items);
+    uint8_t pal_idxes[256];
+    if(len > 256) len = 256;
+    for(size_t i=0;i<len;i++) pal_idxes[i] = mp_obj_get_int(items[i]);
+    collide_set_walls(pal_idxes, len);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_collide_walls_obj, 0, 1, tulip_collide_walls);
+
+// tulip.collide_sprites(mask) # bit per sprite that collide looks at, 0xffffffff (all of them) to start
+// mask = tulip.collide_sprites()
+STATIC mp_obj_t tulip_collide_sprites(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) return mp_obj_new_int_from_uint(collide_get_sprites());
+    collide_set_sprites(mp_obj_get_int_truncated(args[0]));
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_collide_sprites_obj, 0, 1, tulip_collide_sprites);
+
 
 
 extern void editor_start(const char * filename);
@@ -931,6 +1792,109 @@ STATIC mp_obj_t tulip_int_screenshot(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_int_screenshot_obj, 1, 1, tulip_int_screenshot);
 
+STATIC int8_t capture_format_arg(mp_obj_t arg) {
+    const char *format = mp_obj_str_get_str(arg);
+    if(strcmp(format, "png") == 0) return CAPTURE_PNG;
+    if(strcmp(format, "bmp") == 0) return CAPTURE_BMP;
+    if(strcmp(format, "rle") == 0) return CAPTURE_RLE;
+    mp_raise_ValueError(MP_ERROR_TEXT("format must be png, bmp or rle"));
+}
+
+// tulip.capture(filename) # write the next frame to filename in the background, without blanking the screen
+// tulip.capture(filename, "rle") # format is png, bmp or rle (RLE8 BMP), or from the filename if not given
+STATIC mp_obj_t tulip_capture(size_t n_args, const mp_obj_t *args) {
+    const char *filename = mp_obj_str_get_str(args[0]);
+    int8_t format = (n_args > 1) ? capture_format_arg(args[1]) : capture_format_for(filename);
+    if(format < 0) mp_raise_ValueError(MP_ERROR_TEXT("filename should end in .png or .bmp, or give a format"));
+    return mp_obj_new_bool(capture_request(filename, format));
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_capture_obj, 1, 2, tulip_capture);
+
+// tulip.capture_pending() # how many captures haven't been written yet
+STATIC mp_obj_t tulip_capture_pending(size_t n_args, const mp_obj_t *args) {
+    return mp_obj_new_int(capture_pending());
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_capture_pending_obj, 0, 0, tulip_capture_pending);
+
+// tulip.record(prefix, fps=10, format="rle") # write frames to prefix00000.bmp, prefix00001.bmp ...
+// (frames, dropped) = tulip.record() # stop
+STATIC mp_obj_t tulip_record(size_t n_args, const mp_obj_t *args) {
+    if(n_args == 0) {
+        uint32_t frames, dropped;
+        capture_record_stop(&frames, &dropped);
+        mp_obj_t tuple[2];
+        tuple[0] = mp_obj_new_int(frames);
+        tuple[1] = mp_obj_new_int(dropped);
+        return mp_obj_new_tuple(2, tuple);
+    }
+    float fps = 10;
+    uint8_t format = CAPTURE_RLE;
+    if(n_args > 1) fps = mp_obj_get_float(args[1]);
+    if(n_args > 2) format = capture_format_arg(args[2]);
+    return mp_obj_new_bool(capture_record_start(mp_obj_str_get_str(args[0]), fps, format));
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_record_obj, 0, 3, tulip_record);
+
+#ifdef TULIP_DESKTOP
+extern uint8_t headless;
+extern uint8_t headless_step;
+extern int headless_display_draw();
+#endif
+
+// hash = tulip.screenshot_hash() # hash of what's on screen now, BG, TFB and sprites
+STATIC mp_obj_t tulip_screenshot_hash(size_t n_args, const mp_obj_t *args) {
+    lvgl_render_wait();
+#ifdef TULIP_DESKTOP
+    // Stepped frames only draw in frame_step, so composite this one here
+    if(headless && headless_step) return mp_obj_new_int_from_uint(display_frame_hash());
+#endif
+    // Otherwise hash the next frame the display scans out
+    int8_t slot = capture_peek_request();
+    if(slot < 0) mp_raise_OSError(MP_ENOMEM);
+    uint8_t *frame = NULL;
+    int64_t start = get_time_ms();
+    nlr_buf_t nlr;
+    if(nlr_push(&nlr) == 0) {
+        while((frame = capture_peek_frame(slot)) == NULL) {
+            if(get_time_ms() - start > 1000) mp_raise_OSError(MP_ETIMEDOUT); // the display isn't running
+            mp_hal_delay_ms(1);
+        }
+        nlr_pop();
+    } else {
+        capture_peek_release(slot);
+        nlr_jump(nlr.ret_val);
+    }
+    uint32_t hash = display_hash_frame(frame);
+    capture_peek_release(slot);
+    return mp_obj_new_int_from_uint(hash);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_screenshot_hash_obj, 0, 0, tulip_screenshot_hash);
+
+#ifdef TULIP_DESKTOP
+
+// tulip.frame_step(n) # headless -S mode only: draw n frames (and their audio), running callbacks after each
+STATIC mp_obj_t tulip_frame_step(size_t n_args, const mp_obj_t *args) {
+    if(!headless || !headless_step) {
+        mp_raise_ValueError(MP_ERROR_TEXT("frame_step needs tulip started with -H -S"));
+    }
+    int32_t frames = 1;
+    if(n_args > 0) frames = mp_obj_get_int(args[0]);
+    for(int32_t i=0;i<frames;i++) {
+        headless_display_draw();
+        mp_handle_pending(true);
+        // So the next frame has all of this frame's LVGL in it, like when LVGL drew on this thread
+        lvgl_render_wait();
+    }
+    return mp_obj_new_int(vsync_count);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_frame_step_obj, 0, 1, tulip_frame_step);
+#endif
+
 
 
 
@@ -1017,8 +1981,16 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_rgb332_565_obj, 1, 1, tulip_rgb
 
 
 
+// (mod, key0, ... key5) = tulip.keys()
+// mods = tulip.keys(buf) # fills a 32 byte buf with a bit per scan code held, bit (scan & 7) of byte (scan >> 3)
 extern uint8_t last_scan[8];
 STATIC mp_obj_t tulip_keys(size_t n_args, const mp_obj_t *args) {
+    if(n_args > 0) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+        if(bufinfo.len < 32) mp_raise_ValueError(MP_ERROR_TEXT("buffer must be at least 32 bytes"));
+        return mp_obj_new_int(keys_held((uint8_t*)bufinfo.buf));
+    }
     mp_obj_t tuple[7];
     tuple[0] = mp_obj_new_int(last_scan[0]);
     for(uint8_t i=0;i<6;i++) tuple[i+1] = mp_obj_new_int(last_scan[i+2]);
@@ -1026,7 +1998,22 @@ STATIC mp_obj_t tulip_keys(size_t n_args, const mp_obj_t *args) {
 
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_keys_obj, 0, 0, tulip_keys);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_keys_obj, 0, 1, tulip_keys);
+
+// [(kind, scan, code, mods, ms), ...] = tulip.key_events() # since last time, oldest first, see tulip.Keys
+STATIC mp_obj_t tulip_key_events(size_t n_args, const mp_obj_t *args) {
+    key_event_t e[KEY_EVENT_QUEUE];
+    uint8_t n = key_events_take(e, KEY_EVENT_QUEUE);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for(uint8_t i=0;i<n;i++) {
+        mp_obj_t tuple[5] = {mp_obj_new_int(e[i].kind), mp_obj_new_int(e[i].scan), mp_obj_new_int(e[i].code),
+                             mp_obj_new_int(e[i].mods), mp_obj_new_int_from_uint(e[i].ms)};
+        mp_obj_list_append(list, mp_obj_new_tuple(5, tuple));
+    }
+    return list;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_key_events_obj, 0, 0, tulip_key_events);
 
 extern int16_t last_touch_x[3];
 extern int16_t last_touch_y[3];
@@ -1072,6 +2059,21 @@ STATIC mp_obj_t tulip_touch_delta(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_touch_delta_obj, 0, 2, tulip_touch_delta);
 
+// [(kind, x, y, a, b), ...] = tulip.gestures() # recognized since last time, oldest first, see tulip.Gesture
+STATIC mp_obj_t tulip_gestures(size_t n_args, const mp_obj_t *args) {
+    gesture_t g[GESTURE_QUEUE];
+    uint8_t n = gesture_take(g, GESTURE_QUEUE);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for(uint8_t i=0;i<n;i++) {
+        mp_obj_t tuple[5] = {mp_obj_new_int(g[i].kind), mp_obj_new_int(g[i].x), mp_obj_new_int(g[i].y),
+                             mp_obj_new_float_from_f(g[i].a), mp_obj_new_float_from_f(g[i].b)};
+        mp_obj_list_append(list, mp_obj_new_tuple(5, tuple));
+    }
+    return list;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_gestures_obj, 0, 0, tulip_gestures);
+
 
 STATIC mp_obj_t tulip_key_remap(size_t n_args, const mp_obj_t *args) {
     for(uint8_t i=0;i<MAX_KEY_REMAPS;i++) {
@@ -1162,6 +2164,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_app_path_obj, 0, 0, tulip_app_p
 
 
 STATIC mp_obj_t tulip_bg_bezier(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x0 = mp_obj_get_int(args[0]);
     uint16_t y0 = mp_obj_get_int(args[1]);
     uint16_t x1 = mp_obj_get_int(args[2]);
@@ -1169,6 +2172,11 @@ STATIC mp_obj_t tulip_bg_bezier(size_t n_args, const mp_obj_t *args) {
     uint16_t x2 = mp_obj_get_int(args[4]);
     uint16_t y2 = mp_obj_get_int(args[5]);
     uint16_t pal_idx = mp_obj_get_int(args[6]);
+    if(dl_recording >= 0) {
+        int16_t a[7] = {x0, y0, x1, y1, x2, y2, pal_idx};
+        displaylist_record(DL_BEZIER, a, 7, NULL, 0);
+        return mp_const_none;
+    }
     plotQuadBezier(x0,y0,x1,y1,x2,y2,pal_idx);
     return mp_const_none;
 }
@@ -1178,11 +2186,17 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_bezier_obj, 7, 7, tulip_bg_b
 
 
 STATIC mp_obj_t tulip_bg_line(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     int16_t x0 = mp_obj_get_int(args[0]);
     int16_t y0 = mp_obj_get_int(args[1]);
     int16_t x1 = mp_obj_get_int(args[2]);
     int16_t y1 = mp_obj_get_int(args[3]);
     uint8_t pal_idx = mp_obj_get_int(args[4]);
+    if(dl_recording >= 0) {
+        int16_t a[5] = {x0, y0, x1, y1, pal_idx};
+        displaylist_record(DL_LINE, a, 5, NULL, 0);
+        return mp_const_none;
+    }
     drawLine_scanline(x0,y0,x1,y1,pal_idx);
     return mp_const_none;
 }
@@ -1190,12 +2204,18 @@ STATIC mp_obj_t tulip_bg_line(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_line_obj, 5, 5, tulip_bg_line);
 
 STATIC mp_obj_t tulip_bg_roundrect(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     uint16_t w = mp_obj_get_int(args[2]);
     uint16_t h = mp_obj_get_int(args[3]);
     uint16_t r = mp_obj_get_int(args[4]);
     uint16_t pal_idx = mp_obj_get_int(args[5]);
+    if(dl_recording >= 0) {
+        int16_t a[7] = {x, y, w, h, r, pal_idx, n_args > 6 && mp_obj_get_int(args[6]) > 0};
+        displaylist_record(DL_ROUNDRECT, a, 7, NULL, 0);
+        return mp_const_none;
+    }
     if(n_args > 6) {
         if(mp_obj_get_int(args[6])>0) {
             fillRoundRect(x,y,w,h,r,pal_idx);
@@ -1210,11 +2230,17 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_roundrect_obj, 6, 7, tulip_b
 
 
 STATIC mp_obj_t tulip_bg_rect(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     uint16_t w = mp_obj_get_int(args[2]);
     uint16_t h = mp_obj_get_int(args[3]);
     uint16_t pal_idx = mp_obj_get_int(args[4]);
+    if(dl_recording >= 0) {
+        int16_t a[6] = {x, y, w, h, pal_idx, n_args > 5 && mp_obj_get_int(args[5]) > 0};
+        displaylist_record(DL_RECT, a, 6, NULL, 0);
+        return mp_const_none;
+    }
     if(n_args > 5) {
         if(mp_obj_get_int(args[5])>0) {
             fillRect(x,y,w,h,pal_idx);
@@ -1228,10 +2254,16 @@ STATIC mp_obj_t tulip_bg_rect(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_rect_obj, 5, 6, tulip_bg_rect);
 
 STATIC mp_obj_t tulip_bg_circle(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x = mp_obj_get_int(args[0]);
     uint16_t y = mp_obj_get_int(args[1]);
     uint16_t r = mp_obj_get_int(args[2]);
     uint16_t pal_idx = mp_obj_get_int(args[3]);
+    if(dl_recording >= 0) {
+        int16_t a[5] = {x, y, r, pal_idx, n_args > 4 && mp_obj_get_int(args[4]) > 0};
+        displaylist_record(DL_CIRCLE, a, 5, NULL, 0);
+        return mp_const_none;
+    }
     if(n_args > 4) {
         if(mp_obj_get_int(args[4])>0) {
             fillCircle(x,y,r,pal_idx);
@@ -1246,6 +2278,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_circle_obj, 4, 5, tulip_bg_c
 
 
 STATIC mp_obj_t tulip_bg_triangle(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t x0 = mp_obj_get_int(args[0]);
     uint16_t y0 = mp_obj_get_int(args[1]);
     uint16_t x1 = mp_obj_get_int(args[2]);
@@ -1253,6 +2286,11 @@ STATIC mp_obj_t tulip_bg_triangle(size_t n_args, const mp_obj_t *args) {
     uint16_t x2 = mp_obj_get_int(args[4]);
     uint16_t y2 = mp_obj_get_int(args[5]);
     uint16_t pal_idx = mp_obj_get_int(args[6]);
+    if(dl_recording >= 0) {
+        int16_t a[8] = {x0, y0, x1, y1, x2, y2, pal_idx, n_args > 7 && mp_obj_get_int(args[7]) > 0};
+        displaylist_record(DL_TRIANGLE, a, 8, NULL, 0);
+        return mp_const_none;
+    }
     if(n_args > 7) {
         if(mp_obj_get_int(args[7])>0) {
             fillTriangle(x0, y0, x1, y1, x2, y2, pal_idx);
@@ -1265,33 +2303,80 @@ STATIC mp_obj_t tulip_bg_triangle(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_triangle_obj, 7, 8, tulip_bg_triangle);
 
+// tulip.bg_fill(x, y, pal_idx, [clip_x, clip_y, clip_w, clip_h])
+// tulip.bg_fill(x, y, pattern, pattern_w, pattern_h, [clip_x, clip_y, clip_w, clip_h])
 STATIC mp_obj_t tulip_bg_fill(size_t n_args, const mp_obj_t *args) {
-    uint16_t x0 = mp_obj_get_int(args[0]);
-    uint16_t y0 = mp_obj_get_int(args[1]);
-    uint16_t pal_idx = mp_obj_get_int(args[2]);
-    fill(x0,y0,pal_idx);
+    bg_target_refresh();
+    int16_t x0 = mp_obj_get_int(args[0]);
+    int16_t y0 = mp_obj_get_int(args[1]);
+    if(mp_obj_is_int(args[2])) {
+        uint8_t pal_idx = mp_obj_get_int(args[2]);
+        if(n_args == 7) {
+            fill_region(x0, y0, pal_idx, NULL, 0, 0, mp_obj_get_int(args[3]), mp_obj_get_int(args[4]), 
+                mp_obj_get_int(args[5]), mp_obj_get_int(args[6]));
+        } else if(n_args == 3) {
+            fill(x0, y0, pal_idx);
+        } else {
+            mp_raise_ValueError(MP_ERROR_TEXT("bg_fill takes x, y, pal_idx and an optional clip rect"));
+        }
+    } else {
+        if(n_args != 5 && n_args != 9) {
+            mp_raise_ValueError(MP_ERROR_TEXT("bg_fill with a pattern takes x, y, pattern, w, h and an optional clip rect"));
+        }
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_READ);
+        uint16_t pw = mp_obj_get_int(args[3]);
+        uint16_t ph = mp_obj_get_int(args[4]);
+        if(pw == 0 || ph == 0 || bufinfo.len < (size_t)pw*ph) {
+            mp_raise_ValueError(MP_ERROR_TEXT("pattern must be at least w*h bytes"));
+        }
+        if(n_args == 9) {
+            fill_region(x0, y0, 0, (uint8_t*)bufinfo.buf, pw, ph, mp_obj_get_int(args[5]), mp_obj_get_int(args[6]), 
+                mp_obj_get_int(args[7]), mp_obj_get_int(args[8]));
+        } else {
+            fill_region(x0, y0, 0, (uint8_t*)bufinfo.buf, pw, ph, 0, 0, 0, 0);
+        }
+    }
     return mp_const_none;
 }
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_fill_obj, 3, 3, tulip_bg_fill);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_fill_obj, 3, 9, tulip_bg_fill);
 
 STATIC mp_obj_t tulip_bg_char(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     uint16_t c = mp_obj_get_int(args[0]);
     uint16_t x = mp_obj_get_int(args[1]);
     uint16_t y = mp_obj_get_int(args[2]);
     uint16_t pal_idx = mp_obj_get_int(args[3]);
     uint16_t font_no = mp_obj_get_int(args[4]);
+    if(dl_recording >= 0) {
+        char str[2] = {c, 0};
+        int16_t a[7] = {x, y, pal_idx, font_no, 0, 0, 0};
+        displaylist_record(DL_STR, a, 7, (uint8_t*)str, 2);
+        return mp_obj_new_int(u8g2_glyph_width(font_no, c));
+    }
     return mp_obj_new_int(draw_new_char(c, x, y, pal_idx, font_no));
 }
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_char_obj, 5, 5, tulip_bg_char);
 
 STATIC mp_obj_t tulip_bg_str(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
     const char *str =  mp_obj_str_get_str(args[0]);
     uint16_t x = mp_obj_get_int(args[1]);
     uint16_t y = mp_obj_get_int(args[2]);
     uint16_t pal_idx = mp_obj_get_int(args[3]);
     uint16_t font_no = mp_obj_get_int(args[4]);
+    if(dl_recording >= 0) {
+        int16_t a[7] = {x, y, pal_idx, font_no, 0, 0, 0};
+        if(n_args>5) {
+            a[4] = mp_obj_get_int(args[5]);
+            a[5] = mp_obj_get_int(args[6]);
+            a[6] = 1;
+        }
+        displaylist_record(DL_STR, a, 7, (const uint8_t*)str, strlen(str)+1);
+        return mp_obj_new_int(displaylist_str_width(str, font_no));
+    }
     if(n_args>5) {
         uint16_t w = mp_obj_get_int(args[5]);
         uint16_t h = mp_obj_get_int(args[6]);        
@@ -1302,6 +2387,86 @@ STATIC mp_obj_t tulip_bg_str(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_bg_str_obj, 5, 7, tulip_bg_str);
 
+// tulip.dl_begin(n) # bg_ drawing calls after this are recorded into display list n instead of drawn
+STATIC mp_obj_t tulip_dl_begin(size_t n_args, const mp_obj_t *args) {
+    int16_t n = mp_obj_get_int(args[0]);
+    if(n < 0 || n >= DISPLAY_LISTS) mp_raise_ValueError(MP_ERROR_TEXT("display list out of range"));
+    displaylist_begin(n);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_dl_begin_obj, 1, 1, tulip_dl_begin);
+
+// tulip.dl_end() # stop recording, bg_ calls draw again
+STATIC mp_obj_t tulip_dl_end(size_t n_args, const mp_obj_t *args) {
+    displaylist_end();
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_dl_end_obj, 0, 0, tulip_dl_end);
+
+// tulip.dl_draw(n)
+// tulip.dl_draw(n, x_offset, y_offset)
+// tulip.dl_draw(n, x_offset, y_offset, [(x,y,w,h), ...]) # only redraw what touches these rects
+STATIC mp_obj_t tulip_dl_draw(size_t n_args, const mp_obj_t *args) {
+    bg_target_refresh();
+    int16_t n = mp_obj_get_int(args[0]);
+    if(n < 0 || n >= DISPLAY_LISTS) mp_raise_ValueError(MP_ERROR_TEXT("display list out of range"));
+    if(n_args == 2) mp_raise_ValueError(MP_ERROR_TEXT("dl_draw needs both x and y offsets"));
+    int16_t ox = 0, oy = 0;
+    if(n_args > 2) {
+        ox = mp_obj_get_int(args[1]);
+        oy = mp_obj_get_int(args[2]);
+    }
+    uint32_t drawn = 0;
+    if(n_args > 3) {
+        size_t len;
+        mp_obj_t *rects;
+        mp_obj_get_array(args[3], &len, &rects);
+        for(size_t i=0;i<len;i++) {
+            mp_obj_t *r;
+            mp_obj_get_array_fixed_n(rects[i], 4, &r);
+            int16_t w = mp_obj_get_int(r[2]);
+            int16_t h = mp_obj_get_int(r[3]);
+            if(w > 0 && h > 0) drawn += displaylist_draw(n, ox, oy, mp_obj_get_int(r[0]), mp_obj_get_int(r[1]), w, h);
+        }
+    } else {
+        drawn = displaylist_draw(n, ox, oy, 0, 0, 0, 0);
+    }
+    return mp_obj_new_int(drawn);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_dl_draw_obj, 1, 4, tulip_dl_draw);
+
+// tulip.dl_free(n)
+STATIC mp_obj_t tulip_dl_free(size_t n_args, const mp_obj_t *args) {
+    int16_t n = mp_obj_get_int(args[0]);
+    if(n < 0 || n >= DISPLAY_LISTS) mp_raise_ValueError(MP_ERROR_TEXT("display list out of range"));
+    if(dl_recording == n) displaylist_end();
+    displaylist_free(n);
+    return mp_const_none;
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_dl_free_obj, 1, 1, tulip_dl_free);
+
+// (commands, bytes, x, y, w, h) = tulip.dl_info(n)
+STATIC mp_obj_t tulip_dl_info(size_t n_args, const mp_obj_t *args) {
+    int16_t n = mp_obj_get_int(args[0]);
+    if(n < 0 || n >= DISPLAY_LISTS) mp_raise_ValueError(MP_ERROR_TEXT("display list out of range"));
+    int16_t x0, y0, x1, y1;
+    displaylist_bounds(n, &x0, &y0, &x1, &y1);
+    mp_obj_t tuple[6];
+    tuple[0] = mp_obj_new_int(display_lists[n].count);
+    tuple[1] = mp_obj_new_int(display_lists[n].count * sizeof(dl_cmd_t) + display_lists[n].data_len);
+    tuple[2] = mp_obj_new_int(x0);
+    tuple[3] = mp_obj_new_int(y0);
+    tuple[4] = mp_obj_new_int(x1 - x0);
+    tuple[5] = mp_obj_new_int(y1 - y0);
+    return mp_obj_new_tuple(6, tuple);
+}
+
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(tulip_dl_info_obj, 1, 1, tulip_dl_info);
+
 
 STATIC mp_obj_t tulip_build_strings(size_t n_args, const mp_obj_t *args) {
     mp_obj_t tuple[3];
@@ -1349,10 +2514,23 @@ STATIC const mp_rom_map_elem_t tulip_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_bg_scroll_y_speed), MP_ROM_PTR(&tulip_bg_scroll_y_speed_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_scroll_x_offset), MP_ROM_PTR(&tulip_bg_scroll_x_offset_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_scroll_y_offset), MP_ROM_PTR(&tulip_bg_scroll_y_offset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_copper), MP_ROM_PTR(&tulip_copper_obj) },
+    { MP_ROM_QSTR(MP_QSTR_copper_palette), MP_ROM_PTR(&tulip_copper_palette_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_bitmap), MP_ROM_PTR(&tulip_tile_bitmap_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_png), MP_ROM_PTR(&tulip_tile_png_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_map), MP_ROM_PTR(&tulip_tile_map_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_set), MP_ROM_PTR(&tulip_tile_set_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_scroll), MP_ROM_PTR(&tulip_tile_scroll_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_on), MP_ROM_PTR(&tulip_tile_on_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tile_off), MP_ROM_PTR(&tulip_tile_off_obj) },
     { MP_ROM_QSTR(MP_QSTR_tfb_str), MP_ROM_PTR(&tulip_tfb_str_obj) },
     { MP_ROM_QSTR(MP_QSTR_frame_callback), MP_ROM_PTR(&tulip_frame_callback_obj) },
     { MP_ROM_QSTR(MP_QSTR_touch_callback), MP_ROM_PTR(&tulip_touch_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_motion_callback), MP_ROM_PTR(&tulip_motion_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gesture_callback), MP_ROM_PTR(&tulip_gesture_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_motion_events), MP_ROM_PTR(&tulip_motion_events_obj) },
     { MP_ROM_QSTR(MP_QSTR_keyboard_callback), MP_ROM_PTR(&tulip_keyboard_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_key_event_callback), MP_ROM_PTR(&tulip_key_event_callback_obj) },
     { MP_ROM_QSTR(MP_QSTR_ui_quit_callback), MP_ROM_PTR(&tulip_ui_quit_callback_obj) },
     { MP_ROM_QSTR(MP_QSTR_ui_switch_callback), MP_ROM_PTR(&tulip_ui_switch_callback_obj) },
     { MP_ROM_QSTR(MP_QSTR_defer), MP_ROM_PTR(&tulip_defer_obj) },
@@ -1369,19 +2547,37 @@ STATIC const mp_rom_map_elem_t tulip_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_midi_local), MP_ROM_PTR(&tulip_midi_local_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_bitmap), MP_ROM_PTR(&tulip_bg_bitmap_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_blit), MP_ROM_PTR(&tulip_bg_blit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bg_target), MP_ROM_PTR(&tulip_bg_target_obj) },
+    { MP_ROM_QSTR(MP_QSTR_surface_blit), MP_ROM_PTR(&tulip_surface_blit_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_png), MP_ROM_PTR(&tulip_sprite_png_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_bitmap), MP_ROM_PTR(&tulip_sprite_bitmap_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_register), MP_ROM_PTR(&tulip_sprite_register_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_transform), MP_ROM_PTR(&tulip_sprite_transform_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_lines), MP_ROM_PTR(&tulip_sprite_lines_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_beziers), MP_ROM_PTR(&tulip_sprite_beziers_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_ellipses), MP_ROM_PTR(&tulip_sprite_ellipses_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_vector_stats), MP_ROM_PTR(&tulip_sprite_vector_stats_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_move), MP_ROM_PTR(&tulip_sprite_move_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_motion), MP_ROM_PTR(&tulip_sprite_motion_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_motion_off), MP_ROM_PTR(&tulip_sprite_motion_off_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_anim), MP_ROM_PTR(&tulip_sprite_anim_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sprite_anim_off), MP_ROM_PTR(&tulip_sprite_anim_off_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_on), MP_ROM_PTR(&tulip_sprite_on_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_off), MP_ROM_PTR(&tulip_sprite_off_obj) },
     { MP_ROM_QSTR(MP_QSTR_sprite_clear), MP_ROM_PTR(&tulip_sprite_clear_obj) },
     { MP_ROM_QSTR(MP_QSTR_collisions), MP_ROM_PTR(&tulip_collisions_obj) },
+    { MP_ROM_QSTR(MP_QSTR_collide), MP_ROM_PTR(&tulip_collide_obj) },
+    { MP_ROM_QSTR(MP_QSTR_collide_walls), MP_ROM_PTR(&tulip_collide_walls_obj) },
+    { MP_ROM_QSTR(MP_QSTR_collide_sprites), MP_ROM_PTR(&tulip_collide_sprites_obj) },
     { MP_ROM_QSTR(MP_QSTR_run_editor), MP_ROM_PTR(&tulip_run_editor_obj) },
     { MP_ROM_QSTR(MP_QSTR_deinit_editor), MP_ROM_PTR(&tulip_deinit_editor_obj) },
     { MP_ROM_QSTR(MP_QSTR_key_editor), MP_ROM_PTR(&tulip_key_editor_obj) },
     { MP_ROM_QSTR(MP_QSTR_activate_editor), MP_ROM_PTR(&tulip_activate_editor_obj) },
     { MP_ROM_QSTR(MP_QSTR_int_screenshot), MP_ROM_PTR(&tulip_int_screenshot_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture), MP_ROM_PTR(&tulip_capture_obj) },
+    { MP_ROM_QSTR(MP_QSTR_capture_pending), MP_ROM_PTR(&tulip_capture_pending_obj) },
+    { MP_ROM_QSTR(MP_QSTR_record), MP_ROM_PTR(&tulip_record_obj) },
+    { MP_ROM_QSTR(MP_QSTR_screenshot_hash), MP_ROM_PTR(&tulip_screenshot_hash_obj) },
     { MP_ROM_QSTR(MP_QSTR_multicast_start), MP_ROM_PTR(&tulip_multicast_start_obj) },
     { MP_ROM_QSTR(MP_QSTR_alles_send), MP_ROM_PTR(&tulip_alles_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_alles_map), MP_ROM_PTR(&tulip_alles_map_obj) },
@@ -1389,8 +2585,10 @@ STATIC const mp_rom_map_elem_t tulip_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_rgb332_565), MP_ROM_PTR(&tulip_rgb332_565_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_quartet), MP_ROM_PTR(&tulip_set_quartet_obj) },
     { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&tulip_keys_obj) },
+    { MP_ROM_QSTR(MP_QSTR_key_events), MP_ROM_PTR(&tulip_key_events_obj) },
     { MP_ROM_QSTR(MP_QSTR_touch), MP_ROM_PTR(&tulip_touch_obj) },
     { MP_ROM_QSTR(MP_QSTR_touch_delta), MP_ROM_PTR(&tulip_touch_delta_obj) },
+    { MP_ROM_QSTR(MP_QSTR_gestures), MP_ROM_PTR(&tulip_gestures_obj) },
     { MP_ROM_QSTR(MP_QSTR_key_remap), MP_ROM_PTR(&tulip_key_remap_obj) },
     { MP_ROM_QSTR(MP_QSTR_key_remaps_clear), MP_ROM_PTR(&tulip_key_remaps_clear_obj) },
     { MP_ROM_QSTR(MP_QSTR_key_wait), MP_ROM_PTR(&tulip_key_wait_obj) },
@@ -1410,7 +2608,20 @@ STATIC const mp_rom_map_elem_t tulip_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_bg_rect), MP_ROM_PTR(&tulip_bg_rect_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_char), MP_ROM_PTR(&tulip_bg_char_obj) },
     { MP_ROM_QSTR(MP_QSTR_bg_str), MP_ROM_PTR(&tulip_bg_str_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dl_begin), MP_ROM_PTR(&tulip_dl_begin_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dl_end), MP_ROM_PTR(&tulip_dl_end_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dl_draw), MP_ROM_PTR(&tulip_dl_draw_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dl_free), MP_ROM_PTR(&tulip_dl_free_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dl_info), MP_ROM_PTR(&tulip_dl_info_obj) },
     { MP_ROM_QSTR(MP_QSTR_gpu_log), MP_ROM_PTR(&tulip_gpu_log_obj) },
+    { MP_ROM_QSTR(MP_QSTR_perf), MP_ROM_PTR(&tulip_perf_obj) },
+    { MP_ROM_QSTR(MP_QSTR_perf_trace), MP_ROM_PTR(&tulip_perf_trace_obj) },
+    { MP_ROM_QSTR(MP_QSTR_event_stats), MP_ROM_PTR(&tulip_event_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_amy_render_stats), MP_ROM_PTR(&tulip_amy_render_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_lv_mem), MP_ROM_PTR(&tulip_lv_mem_obj) },
+    { MP_ROM_QSTR(MP_QSTR_lv_png), MP_ROM_PTR(&tulip_lv_png_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bench_list), MP_ROM_PTR(&tulip_bench_list_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bench_run), MP_ROM_PTR(&tulip_bench_run_obj) },
     { MP_ROM_QSTR(MP_QSTR_screen_size), MP_ROM_PTR(&tulip_screen_size_obj) },
     { MP_ROM_QSTR(MP_QSTR_board), MP_ROM_PTR(&tulip_board_obj) }, 
     { MP_ROM_QSTR(MP_QSTR_set_screen_as_repl), MP_ROM_PTR(&tulip_set_screen_as_repl_obj) },
@@ -1421,6 +2632,9 @@ STATIC const mp_rom_map_elem_t tulip_module_globals_table[] = {
 #ifndef ESP_PLATFORM
     { MP_ROM_QSTR(MP_QSTR_app_path), MP_ROM_PTR(&tulip_app_path_obj) },
 #endif
+#ifdef TULIP_DESKTOP
+    { MP_ROM_QSTR(MP_QSTR_frame_step), MP_ROM_PTR(&tulip_frame_step_obj) },
+#endif
 
 };
 
@@ -0,0 +1,206 @@
+// motion.c
+// Sprite motion and animation in C, stepped from display_frame_done_generic(). Python sets a sprite going with a
+// velocity, acceleration and what to do at its bounds, and/or a run of frames in sprite RAM to cycle through, and
+// then only hears about it when something happens (an edge, an animation ending) through one callback a frame.
+#include "motion.h"
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+static motion_t motion[SPRITES];
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE motion_mux = portMUX_INITIALIZER_UNLOCKED;
+#define MOTION_LOCK() portENTER_CRITICAL_SAFE(&motion_mux)
+#define MOTION_UNLOCK() portEXIT_CRITICAL_SAFE(&motion_mux)
+#else
+#define MOTION_LOCK() mp_uint_t motion_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define MOTION_UNLOCK() MICROPY_END_ATOMIC_SECTION(motion_atomic)
+#endif
+
+#define FIX(px) ((int32_t)(px) << 16)
+
+// Starts from wherever the sprite is now
+void motion_start(uint8_t s, int32_t vx, int32_t vy, int32_t ax, int32_t ay, uint8_t edge,
+                  int16_t bx0, int16_t by0, int16_t bx1, int16_t by1) {
+    if(s >= SPRITES) return;
+    MOTION_LOCK();
+    motion_t *m = &motion[s];
+    if(!m->moving) {
+        m->x = FIX(sprite_x_px[s]);
+        m->y = FIX(sprite_y_px[s]);
+    }
+    m->vx = vx; m->vy = vy;
+    m->ax = ax; m->ay = ay;
+    m->edge = edge;
+    m->bx0 = bx0; m->by0 = by0;
+    m->bx1 = bx1; m->by1 = by1;
+    m->moving = 1;
+    MOTION_UNLOCK();
+}
+
+void motion_stop(uint8_t s) {
+    if(s >= SPRITES) return;
+    MOTION_LOCK();
+    motion[s].moving = 0;
+    MOTION_UNLOCK();
+}
+
+// 0 if the sprite isn't moving
+uint8_t motion_get(uint8_t s, int32_t *x, int32_t *y, int32_t *vx, int32_t *vy) {
+    if(s >= SPRITES) return 0;
+    MOTION_LOCK();
+    motion_t *m = &motion[s];
+    uint8_t moving = m->moving;
+    *x = m->x; *y = m->y;
+    *vx = m->vx; *vy = m->vy;
+    MOTION_UNLOCK();
+    return moving;
+}
+
+// sprite_move on a moving sprite puts it there and it carries on from there
+void motion_moveto(uint8_t s, uint16_t x, uint16_t y) {
+    if(s >= SPRITES) return;
+    MOTION_LOCK();
+    motion[s].x = FIX(x);
+    motion[s].y = FIX(y);
+    MOTION_UNLOCK();
+}
+
+void motion_animate(uint8_t s, uint32_t frame0, uint32_t frame_bytes, uint16_t frames, uint16_t period, uint8_t loop) {
+    if(s >= SPRITES || frames == 0) return;
+    if(frame0 + (uint32_t)frames * frame_bytes > SPRITE_RAM_BYTES) return;
+    MOTION_LOCK();
+    motion_t *m = &motion[s];
+    m->frame0 = frame0;
+    m->frame_bytes = frame_bytes;
+    m->frames = frames;
+    m->frame = 0;
+    m->period = period ? period : 1;
+    m->tick = 0;
+    m->loop = loop;
+    m->animating = 1;
+    sprite_mem[s] = frame0;
+    MOTION_UNLOCK();
+}
+
+void motion_animate_stop(uint8_t s) {
+    if(s >= SPRITES) return;
+    MOTION_LOCK();
+    motion[s].animating = 0;
+    MOTION_UNLOCK();
+}
+
+// The frame showing, -1 if it isn't animating
+int32_t motion_frame(uint8_t s) {
+    if(s >= SPRITES) return -1;
+    MOTION_LOCK();
+    int32_t frame = motion[s].animating ? motion[s].frame : -1;
+    MOTION_UNLOCK();
+    return frame;
+}
+
+// Edges hit and animations ended since last time
+uint8_t motion_take_events(uint8_t s) {
+    if(s >= SPRITES) return 0;
+    MOTION_LOCK();
+    uint8_t events = motion[s].events;
+    motion[s].events = 0;
+    MOTION_UNLOCK();
+    return events;
+}
+
+// From display_reset_sprites
+void motion_reset() {
+    MOTION_LOCK();
+    memset(motion, 0, sizeof(motion));
+    MOTION_UNLOCK();
+}
+
+// One axis of one sprite for one frame. lo and hi are the bounds, size the sprite's size on this axis, all 16.16.
+// Returns 1 if it hit the low edge, 2 the high edge, 0 neither
+static uint8_t motion_axis(uint8_t edge, int32_t *p, int32_t *v, int32_t a, int32_t lo, int32_t hi, int32_t size, int32_t bg_size) {
+    *v += a;
+    if(*v > FIX(MOTION_MAX_V)) *v = FIX(MOTION_MAX_V);
+    if(*v < -FIX(MOTION_MAX_V)) *v = -FIX(MOTION_MAX_V);
+    int32_t was = *p;
+    *p += *v;
+    if(edge == MOTION_WRAP) {
+        // the sprite's top left wraps around lo..hi
+        int32_t span = hi - lo;
+        if(span <= 0) return 0;
+        if(*p < lo) {
+            *p = hi - ((lo - *p) % span);
+            if(*p >= hi) *p -= span;
+            return 1;
+        }
+        if(*p >= hi) { *p = lo + ((*p - hi) % span); return 2; }
+        return 0;
+    }
+    if(edge == MOTION_FREE) {
+        lo = 0;
+        hi = bg_size;
+        size = FIX(1);
+    }
+    // the whole sprite stays inside lo..hi
+    int32_t max = hi - size;
+    if(max < lo) max = lo;
+    uint8_t hit = 0;
+    if(*p < lo) {
+        *p = lo;
+        hit = (was > lo || edge == MOTION_BOUNCE) ? 1 : 0;
+    } else if(*p > max) {
+        *p = max;
+        hit = (was < max || edge == MOTION_BOUNCE) ? 2 : 0;
+    } else {
+        return 0;
+    }
+    if(edge == MOTION_BOUNCE) *v = -*v;
+    else *v = 0;
+    return edge == MOTION_FREE ? 0 : hit;
+}
+
+// From display_frame_done_generic, an ISR on the ESP
+void motion_frame_done() {
+    uint8_t news = 0;
+    MOTION_LOCK();
+    for(uint8_t s=0;s<SPRITES;s++) {
+        motion_t *m = &motion[s];
+        if(m->animating) {
+            if(++m->tick >= m->period) {
+                m->tick = 0;
+                if(m->frame + 1 < m->frames) {
+                    m->frame++;
+                } else if(m->loop) {
+                    m->frame = 0;
+                } else {
+                    m->animating = 0;
+                    m->events |= MOTION_ANIM_DONE;
+                    news = 1;
+                }
+                sprite_mem[s] = m->frame0 + m->frame * m->frame_bytes;
+            }
+        }
+        if(m->moving) {
+            uint8_t hx = motion_axis(m->edge, &m->x, &m->vx, m->ax, FIX(m->bx0), FIX(m->bx1), FIX(sprite_w_px[s]), FIX(H_RES+OFFSCREEN_X_PX));
+            uint8_t hy = motion_axis(m->edge, &m->y, &m->vy, m->ay, FIX(m->by0), FIX(m->by1), FIX(sprite_h_px[s]), FIX(V_RES+OFFSCREEN_Y_PX));
+            uint8_t events = (hx == 1 ? MOTION_HIT_LEFT : 0) | (hx == 2 ? MOTION_HIT_RIGHT : 0) |
+                             (hy == 1 ? MOTION_HIT_TOP : 0) | (hy == 2 ? MOTION_HIT_BOTTOM : 0);
+            if(events) {
+                m->events |= events;
+                news = 1;
+            }
+            // Bounds can be set past the BG, sprite x,y can't be
+            int32_t px = m->x >> 16, py = m->y >> 16;
+            if(px < 0) px = 0;
+            if(py < 0) py = 0;
+            if(px >= H_RES+OFFSCREEN_X_PX) px = H_RES+OFFSCREEN_X_PX-1;
+            if(py >= V_RES+OFFSCREEN_Y_PX) py = V_RES+OFFSCREEN_Y_PX-1;
+            sprite_x_px[s] = px;
+            sprite_y_px[s] = py;
+        }
+    }
+    MOTION_UNLOCK();
+    if(news) tulip_motion_isr();
+}
@@ -0,0 +1,56 @@
+// motion.h
+// sprite velocity, acceleration, edges and frame animation, stepped every frame without python
+#ifndef __MOTIONH
+#define __MOTIONH
+
+#include "display.h"
+#include "polyfills.h"
+
+// What happens when a moving sprite reaches its bounds
+#define MOTION_STOP 0       // stays inside, that axis stops
+#define MOTION_WRAP 1       // comes back in on the other side
+#define MOTION_BOUNCE 2     // stays inside, that axis reverses
+#define MOTION_FREE 3       // keeps going. Still never leaves the BG, which sprite x,y can't
+
+// Event flags, set per sprite until python reads them
+#define MOTION_HIT_LEFT 1
+#define MOTION_HIT_RIGHT 2
+#define MOTION_HIT_TOP 4
+#define MOTION_HIT_BOTTOM 8
+#define MOTION_ANIM_DONE 16
+
+// Positions, velocities (px per frame) and accelerations (px per frame per frame) are 16.16 fixed point,
+// frame done is an ISR on the ESP and can't use the FPU
+// Limits that keep that in an int32, sums and spans included
+#define MOTION_MAX_PX 16383     // bounds go from -MOTION_MAX_PX to MOTION_MAX_PX
+#define MOTION_MAX_V 4096       // px per frame either way, for velocity and acceleration. Accelerating stops there
+typedef struct {
+    uint8_t moving;
+    uint8_t edge;
+    int32_t x, y, vx, vy, ax, ay;
+    int16_t bx0, by0, bx1, by1;     // bounds, bx1 and by1 not included
+    uint8_t animating;
+    uint8_t loop;
+    uint32_t frame0;                // sprite_mem of the first frame
+    uint32_t frame_bytes;           // from one frame to the next
+    uint16_t frames, frame;
+    uint16_t period, tick;          // frames shown for period display frames each
+    uint8_t events;
+} motion_t;
+
+void motion_start(uint8_t s, int32_t vx, int32_t vy, int32_t ax, int32_t ay, uint8_t edge,
+                  int16_t bx0, int16_t by0, int16_t bx1, int16_t by1);
+void motion_stop(uint8_t s);
+uint8_t motion_get(uint8_t s, int32_t *x, int32_t *y, int32_t *vx, int32_t *vy);
+void motion_moveto(uint8_t s, uint16_t x, uint16_t y);
+void motion_animate(uint8_t s, uint32_t frame0, uint32_t frame_bytes, uint16_t frames, uint16_t period, uint8_t loop);
+void motion_animate_stop(uint8_t s);
+int32_t motion_frame(uint8_t s);
+uint8_t motion_take_events(uint8_t s);
+void motion_reset();
+void motion_frame_done();
+
+// in modtulip, schedules the python callback
+void tulip_motion_isr();
+
+#endif
@@ -0,0 +1,89 @@
+// perf.c
+// Performance counters for the display, audio and the VM, and a Chrome trace / Perfetto JSON dump.
+// Writers call perf_record() from wherever they are (ISR, display task, audio task, MP),
+// each channel has exactly one writer so the rings need no locks.
+#include "perf.h"
+#include <inttypes.h>
+#include "tulip_helpers.h"
+
+perf_ring_t perf_rings[PERF_CHANNELS];
+uint8_t perf_active = 0;
+
+const char * const perf_names[PERF_CHANNELS] = {
+    "frame", "compositor", "tfb", "lvgl", "lvgl_render", "amy", "seq_late", "midi_queue", "sched_queue", "gc"
+};
+
+const uint8_t perf_is_counter[PERF_CHANNELS] = {
+    0, 0, 0, 0, 0, 0, 0, 1, 1, 0
+};
+
+void perf_start() {
+    for(uint8_t i=0;i<PERF_CHANNELS;i++) perf_rings[i].head = 0;
+    perf_active = 1;
+}
+
+void perf_stop() {
+    perf_active = 0;
+}
+
+// Copy out the samples still in the ring, oldest first. Anything the writer
+// overwrote while we were copying is dropped. Returns the number copied.
+uint16_t perf_snapshot(uint8_t ch, perf_sample_t *out) {
+    perf_ring_t *r = &perf_rings[ch];
+    uint32_t end = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t start = end > PERF_RING_SIZE ? end - PERF_RING_SIZE : 0;
+    for(uint32_t i=start;i<end;i++) out[i-start] = r->samples[i & (PERF_RING_SIZE-1)];
+    uint32_t after = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    uint32_t valid_from = after > PERF_RING_SIZE ? after - PERF_RING_SIZE : 0;
+    if(valid_from > start) {
+        uint32_t skip = valid_from - start;
+        if(skip >= end - start) return 0;
+        memmove(out, out + skip, (end - start - skip) * sizeof(perf_sample_t));
+        start = valid_from;
+    }
+    return end - start;
+}
+
+static void perf_emit(tulip_file_t *f, const char *s) {
+    tulip_file_write(f, (const uint8_t*)s, strlen(s));
+}
+
+// Writes everything in the rings as a Chrome trace (load it in chrome://tracing or ui.perfetto.dev.)
+// Durations are "X" events on one track per channel, queue depths are "C" counters.
+// Returns the number of samples written, -1 if there's no RAM for the file buffer.
+// A bad filename raises OSError from the open, the samples are on the GC heap so they don't leak when it does
+int32_t perf_write_trace(const char *filename) {
+    perf_sample_t *samples = m_new(perf_sample_t, PERF_RING_SIZE);
+    tulip_file_t file;
+    tulip_file_t *w = &file;
+    if(!tulip_file_open(w, filename, "w")) {
+        m_del(perf_sample_t, samples, PERF_RING_SIZE);
+        return -1;
+    }
+    char line[160];
+    int32_t written = 0;
+    uint8_t first = 1;
+    perf_emit(w, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(uint8_t ch=0;ch<PERF_CHANNELS;ch++) {
+        snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", ch, perf_names[ch]);
+        perf_emit(w, line);
+        first = 0;
+        uint16_t n = perf_snapshot(ch, samples);
+        for(uint16_t i=0;i<n;i++) {
+            if(perf_is_counter[ch]) {
+                snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":0,\"tid\":%d,\"ts\":%" PRIu32 ",\"args\":{\"depth\":%" PRIu32 "}}",
+                    perf_names[ch], ch, samples[i].ts_us, samples[i].value);
+            } else {
+                snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%" PRIu32 ",\"dur\":%" PRIu32 "}",
+                    perf_names[ch], ch, samples[i].ts_us, samples[i].value);
+            }
+            perf_emit(w, line);
+            written++;
+        }
+    }
+    perf_emit(w, "\n]}\n");
+    tulip_file_close(w);
+    m_del(perf_sample_t, samples, PERF_RING_SIZE);
+    return written;
+}
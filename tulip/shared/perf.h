@@ -0,0 +1,56 @@
+// perf.h
+// per-frame performance counters, kept in small lock-free rings (one writer per channel)
+#ifndef __PERFH
+#define __PERFH
+
+#include <stdint.h>
+#include "polyfills.h"
+
+// Must be a power of 2
+#define PERF_RING_SIZE 128
+
+enum {
+    PERF_FRAME = 0,     // us between frame done interrupts
+    PERF_COMPOSITOR,    // us spent filling bounce buffers during the frame
+    PERF_TFB,           // us per display_tfb_update (TFB raster into bg_tfb)
+    PERF_LVGL,          // us per lv_task_handler run on the MP task
+    PERF_LVGL_RENDER,   // us per LVGL display refresh on its render thread
+    PERF_AMY,           // us per AMY block render
+    PERF_SEQ_LATE,      // us a sequencer tick fired after it was due
+    PERF_MIDI_DEPTH,    // MIDI in queue depth after each message
+    PERF_SCHED_DEPTH,   // mp_sched_schedule plus tulip event queue length at frame done
+    PERF_GC,            // us per GC collection
+    PERF_CHANNELS
+};
+
+typedef struct {
+    uint32_t ts_us;
+    uint32_t value;
+} perf_sample_t;
+
+typedef struct {
+    perf_sample_t samples[PERF_RING_SIZE];
+    volatile uint32_t head;
+} perf_ring_t;
+
+extern perf_ring_t perf_rings[PERF_CHANNELS];
+extern uint8_t perf_active;
+extern const char * const perf_names[PERF_CHANNELS];
+extern const uint8_t perf_is_counter[PERF_CHANNELS];
+
+// Safe from ISRs and other tasks as long as each channel only has one writer
+static inline void perf_record(uint8_t ch, uint32_t ts_us, uint32_t value) {
+    if(!perf_active) return;
+    perf_ring_t *r = &perf_rings[ch];
+    uint32_t h = r->head;
+    r->samples[h & (PERF_RING_SIZE-1)].ts_us = ts_us;
+    r->samples[h & (PERF_RING_SIZE-1)].value = value;
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+}
+
+void perf_start();
+void perf_stop();
+uint16_t perf_snapshot(uint8_t ch, perf_sample_t *out);
+int32_t perf_write_trace(const char *filename);
+
+#endif
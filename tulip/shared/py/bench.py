@@ -0,0 +1,27 @@
+# bench.py
+# Runs tulip's native microbenchmarks (shared/bench.c) and reports ns per unit of work: pixels, events or samples.
+# Use it before and after a change, on desktop and on device, and keep the JSON it writes to compare.
+
+import tulip
+
+def run(names=None, iters=0, filename=None, quiet=False):
+    if isinstance(names, str):
+        names = [names]
+    results = []
+    for (name, unit) in tulip.bench_list():
+        if names is not None and name not in names:
+            continue
+        try:
+            (n, us, units) = tulip.bench_run(name, iters)
+        except OSError:
+            if not quiet: print("%-20s couldn't run (out of memory or no free PCM patch)" % (name))
+            continue
+        ns = us * 1000.0 / units if units else 0
+        results.append({"name": name, "unit": unit, "iters": n, "total_us": us, "units": units, "ns_per_unit": ns})
+        if not quiet:
+            print("%-20s %10.2f ns/%-6s %10.1f us/iter" % (name, ns, unit, us / n))
+    if filename is not None:
+        import json
+        with open(filename, "w") as f:
+            f.write(json.dumps({"board": tulip.board(), "version": tulip.version(), "results": results}))
+    return results
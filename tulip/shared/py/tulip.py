@@ -96,6 +96,10 @@ class Sprite():
         self.y = 0.0
         self.x_v = 0.0
         self.y_v = 0.0
+        self.scale = 1.0
+        self.rotation = 0.0
+        self.flip_h = False
+        self.flip_v = False
 
     def clamp(self):
         # Modifies x,y to be within the visible screen area
@@ -126,6 +130,20 @@ class Sprite():
                     sprite_register(self.sprite_id,self.mem_pos, self.width, self.height)
                     Sprite.mem_pointer += width*height
 
+    # Load a Surface's pixels as this sprite's bitmap
+    def load_surface(self, surface):
+        if(self.sprite_id >= Sprite.SPRITES):
+            raise Exception("No more sprite handles.")
+        if(self.mem_pos is None):
+            if((Sprite.mem_pointer + surface.w*surface.h) > Sprite.SPRITE_RAM_BYTES):
+                raise Exception("No more sprite RAM. Current pointer %d, you want to add %d" % (Sprite.mem_pointer, surface.w*surface.h))
+            self.mem_pos = Sprite.mem_pointer
+            Sprite.mem_pointer += surface.w*surface.h
+        self.width = surface.w
+        self.height = surface.h
+        surface.to_sprite_ram(self.mem_pos)
+        sprite_register(self.sprite_id, self.mem_pos, self.width, self.height)
+
     def off(self):
         sprite_off(self.sprite_id)
 
@@ -140,6 +158,47 @@ class Sprite():
 
     def move(self):
         sprite_move(self.sprite_id, int(self.x), int(self.y))
+
+    # Have Tulip move this sprite every frame. See tulip.sprite_motion, edge is one of Motion.STOP/WRAP/BOUNCE/FREE
+    def motion(self, x_v=None, y_v=None, x_a=0, y_a=0, edge=0, bounds=None):
+        if(x_v is not None): self.x_v = x_v
+        if(y_v is not None): self.y_v = y_v
+        if(bounds is None):
+            sprite_motion(self.sprite_id, self.x_v, self.y_v, x_a, y_a, edge)
+        else:
+            sprite_motion(self.sprite_id, self.x_v, self.y_v, x_a, y_a, edge, bounds[0], bounds[1], bounds[2], bounds[3])
+
+    def stop(self):
+        sprite_motion_off(self.sprite_id)
+
+    # Read back where the motion engine has it
+    def update(self):
+        m = sprite_motion(self.sprite_id)
+        if(m is not None):
+            (self.x, self.y, self.x_v, self.y_v) = m
+
+    # Cycle through frames of this sprite's size, one after another in sprite RAM from its mem_pos,
+    # each shown for period display frames
+    def animate(self, frames, period, loop=True):
+        sprite_anim(self.sprite_id, self.mem_pos, frames, period, self.width*self.height, loop)
+
+    def transform(self, scale=None, rotation=None, flip_h=None, flip_v=None):
+        # scale (a number or (x,y)), rotate clockwise in degrees and flip about the sprite's centre
+        if(scale is not None): self.scale = scale
+        if(rotation is not None): self.rotation = rotation
+        if(flip_h is not None): self.flip_h = flip_h
+        if(flip_v is not None): self.flip_v = flip_v
+        sprite_transform(self.sprite_id, self.scale, self.rotation, (1 if self.flip_h else 0) | (2 if self.flip_v else 0))
+
+    # Draw this sprite from lines, beziers or ellipses instead of a bitmap, relative to its x,y. See tulip.sprite_lines
+    def lines(self, segments):
+        return sprite_lines(self.sprite_id, segments)
+
+    def beziers(self, curves):
+        return sprite_beziers(self.sprite_id, curves)
+
+    def ellipses(self, ellipses):
+        return sprite_ellipses(self.sprite_id, ellipses)
     
 
 # A sprite who can move from the joystick/keyboard
@@ -205,6 +264,151 @@ class Colors:
     RESET = DEFAULT = END = "\033[0m"
     SORTED_HUE = [0,73,146,219,251,178,105,210,242,137,169,201,233,32,64,96,128,160,192,224,228,196,237,164,205,132,232,246,173,100,200,241,168,236,214,141,209,68,136,204,240,245,172,250,177,104,208,244,213,140,249,176,212,248,255,182,109,218,254,145,181,217,253,36,72,108,144,180,216,252,220,184,221,148,185,112,188,222,149,76,152,189,116,156,186,113,153,40,80,120,124,157,84,190,117,44,88,92,121,48,125,52,56,60,223,150,77,154,158,81,85,89,93,4,8,12,16,20,24,28,61,57,126,53,29,122,49,25,94,21,191,118,45,90,62,17,30,58,159,86,13,26,127,54,95,22,63,31,187,114,155,41,82,123,91,50,59,9,18,27,23,55,87,14,119,46,19,51,151,78,83,5,10,15,47,115,42,11,79,6,43,7,183,110,147,37,74,111,75,38,39,1,2,3,35,71,107,34,143,70,67,103,179,106,139,33,66,99,135,175,102,131,171,98,167,163,215,142,211,69,138,207,203,134,199,65,130,195,227,231,235,162,239,166,243,170,97,194,198,226,247,174,101,202,230,129,234,161,206,133,193,225,238,165,197,229]
 
+# Flags and remap table helpers for tulip.copper()
+class Copper:
+    NO_TFB = 1
+    NO_SPRITES = 2
+    NO_TILES = 4
+
+    # A remap table that scales every color by amount (0-1), for fades, shadows and underwater lines
+    def dim(amount):
+        lut = bytearray(256)
+        for i in range(256):
+            (r,g,b) = rgb(i)
+            lut[i] = color(int(r*amount), int(g*amount), int(b*amount))
+        return lut
+
+    # A remap table that sends every color to one, for flashes and silhouettes
+    def solid(pal_idx):
+        return bytes([pal_idx]*256)
+
+class Motion:
+    # What a sprite does at its bounds, for tulip.sprite_motion
+    STOP = 0
+    WRAP = 1
+    BOUNCE = 2
+    FREE = 3
+    # Bits in the events from tulip.motion_events()
+    HIT_LEFT = 1
+    HIT_RIGHT = 2
+    HIT_TOP = 4
+    HIT_BOTTOM = 8
+    ANIM_DONE = 16
+
+# Kinds of gesture from tulip.gestures()
+class Gesture:
+    TAP = 1
+    DOUBLE_TAP = 2
+    LONG_PRESS = 3
+    SWIPE = 4
+    PINCH = 5
+    PINCH_END = 6
+
+# Collisions from sprite positions, see tulip.collide. Keeps one result buffer so checking every frame doesn't allocate
+class Collide:
+    def __init__(self):
+        import array
+        self.result = array.array('I', [0]*33)
+        self.pairs = 0
+
+    # Works out this frame's collisions, returns how many pairs of sprites touch
+    def run(self):
+        self.pairs = collide(self.result)
+        return self.pairs
+
+    # True if sprite a touches sprite b, or touches anything if b is None
+    def hit(self, a, b=None):
+        if(b is None):
+            return self.result[a] != 0
+        return (self.result[a] >> b) & 1 == 1
+
+    # True if sprite s is over a wall color
+    def wall(self, s):
+        return (self.result[32] >> s) & 1 == 1
+
+    # The sprites s touches
+    def sprites(self, s):
+        return [b for b in range(32) if (self.result[s] >> b) & 1]
+
+# Key event kinds from tulip.key_events(), and the held keys from tulip.keys(buf). Keeps one buffer so polling
+# every frame doesn't allocate
+class Keys:
+    UP = 0
+    DOWN = 1
+    REPEAT = 2
+
+    def __init__(self):
+        self.held_bits = bytearray(32)
+        self.mods = 0
+
+    # Reads the keys held right now, returns the modifier mask
+    def poll(self):
+        self.mods = keys(self.held_bits)
+        return self.mods
+
+    # True if scan code scan was held at the last poll()
+    def held(self, scan):
+        return (self.held_bits[scan >> 3] >> (scan & 7)) & 1 == 1
+
+class Tiles:
+    # Or these into a tile number in a tile_map entry
+    FLIP_H = 0x4000
+    FLIP_V = 0x8000
+    EMPTY = 0x3fff
+
+    # A map_w*map_h array of tile numbers to pass to tile_map, all set to fill
+    def blank(map_w, map_h, fill=0x3fff):
+        import array
+        return array.array('H', [fill]*(map_w*map_h))
+
+# An off screen RGB332 buffer of any size. Every bg_ drawing call, bg_str and bg_png can draw into it:
+#   s = tulip.Surface(200, 100)
+#   with s:
+#       tulip.bg_clear(0)
+#       tulip.bg_str("hello", 10, 10, 255, 1)
+#   s.blit(50, 50)
+# s.pixels is a bytearray, memoryview(s.pixels) reads and writes it without a copy
+class Surface:
+    target = None # the Surface bg drawing is going into, None for the BG
+
+    def __init__(self, w, h, fill=0):
+        self.w = w
+        self.h = h
+        self.pixels = bytearray([fill])*(w*h)
+        self._last = None
+
+    # Point bg drawing here until the with block ends. Nests, and goes back to whatever was the target before
+    def __enter__(self):
+        self._last = Surface.target
+        Surface.target = self
+        bg_target(self.pixels, self.w, self.h)
+        return self
+
+    def __exit__(self, *args):
+        Surface.target = self._last
+        self._last = None
+        if(Surface.target is None):
+            bg_target()
+        else:
+            bg_target(Surface.target.pixels, Surface.target.w, Surface.target.h)
+
+    # Draw this surface (or the sx,sy,sw,sh part of it) at x,y on the bg or the current target, clipped.
+    # With alpha, pixels of the alpha color (0x55) are left out
+    def blit(self, x, y, alpha=False, src=None):
+        if(src is None):
+            surface_blit(self.pixels, self.w, self.h, x, y, alpha)
+        else:
+            surface_blit(self.pixels, self.w, self.h, x, y, alpha, src[0], src[1], src[2], src[3])
+
+    # Copy the bg at x,y into this surface
+    def grab(self, x, y):
+        with self:
+            surface_blit(None, 0, 0, 0, 0, False, x, y, self.w, self.h)
+
+    # Copy the pixels into sprite RAM at mem_pos, returns the bytes used. Sprite.load_surface keeps track of RAM for you
+    def to_sprite_ram(self, mem_pos):
+        return sprite_bitmap(self.pixels, mem_pos)
+
 class Joy:
     # These are the mask bits for the joystick / keyboard
     # TODO: test NES (not just SNES)
@@ -256,6 +460,11 @@ def version():
     me = build_strings()
     return me[2].replace("-", "") + "-" + me[1].replace("-dirty", "")
 
+def bench(names=None, iters=0, filename=None, quiet=False):
+    # Runs the native benchmarks, see bench.py
+    import bench
+    return bench.run(names, iters, filename, quiet)
+
 def free_disk_bytes():
     import os
     st = os.statvfs('.')
@@ -577,12 +786,19 @@ def url_put(url, filename, headers={"User-Agent":"TulipCC/4.0"}):
     f.close()
 
 def screenshot(filename=None):
-    from upysh import rm
     if(filename is not None):
-        int_screenshot(filename)
+        # Capture the next frame as it's displayed, and wait for it to be written
+        if(not capture(filename, "png")):
+            # No RAM for a capture buffer, blank the screen and render it instead
+            int_screenshot(filename)
+            return None
+        import time
+        start = ticks_ms()
+        while(capture_pending() and ticks_ms() - start < 5000):
+            time.sleep_ms(10)
         return None
     if(ip() is not None):
-        int_screenshot("screenshot.png")
+        screenshot("screenshot.png")
         world.upload("screenshot.png", 'Tulip Screenshot')
     else:
         print("Need wi-fi on")
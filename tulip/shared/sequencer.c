@@ -40,6 +40,8 @@ in C, we have a timer/thread that calls .. mp_sched_schedule(tick_guy(time)) and
 */
 
 #include "sequencer.h"
+#include "perf.h"
+#include "events.h"
 
 // Things that MP can change
 float sequencer_bpm = 108; // verified optimal BPM 
@@ -103,11 +105,12 @@ static void sequencer_check_and_fill() {
     while(amy_sysclock()  >= (next_amy_tick_us/1000)) {
         sequencer_tick_count++;
         uint32_t lag = amy_sysclock() - (next_amy_tick_us/1000);
+        perf_record(PERF_SEQ_LATE, (uint32_t)get_time_us(), lag*1000);
         // Check defers 
         for(uint8_t i=0;i<DEFER_SLOTS;i++) {
             if(defer_callbacks[i] != NULL && amy_sysclock() > defer_sysclock[i]) {
                 //fprintf(stderr, "calling defer with sysclock %" PRIu32 " and actual %" PRIu32"\n", defer_sysclock[i], amy_sysclock() );
-                mp_sched_schedule(defer_callbacks[i], defer_args[i]);
+                tulip_schedule(EVENT_AUDIO, defer_callbacks[i], defer_args[i]);
                 defer_callbacks[i] = NULL; defer_sysclock[i] = 0; defer_args[i] = NULL;
             }
         }
@@ -116,7 +119,7 @@ static void sequencer_check_and_fill() {
             if(sequencer_dividers[i]!=0) {
                 if(sequencer_tick_count % sequencer_dividers[i] == 0) {
                     //fprintf(stderr, "scheduling cb with time %" PRIu64 ", lag %" PRIi32 " tick %" PRIu32 "\n",(next_amy_tick_us/1000)+sequencer_latency_ms, lag, sequencer_tick_count );
-                    mp_sched_schedule(sequencer_callbacks[i], mp_obj_new_int((next_amy_tick_us/1000)+sequencer_latency_ms));
+                    tulip_schedule(EVENT_AUDIO, sequencer_callbacks[i], mp_obj_new_int((next_amy_tick_us/1000)+sequencer_latency_ms));
                 }
             }
         }
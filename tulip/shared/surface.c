@@ -0,0 +1,79 @@
+// surface.c
+// Off screen render targets. A surface is just a w*h RGB332 buffer, python owns it (a bytearray, so memoryview
+// gets the pixels without a copy) and passes it to bg_target so every bg_ drawing call, text and PNG decode
+// lands in it instead of the bg. Blits go between any two surfaces, the bg included, clipped to both.
+
+#include "surface.h"
+
+surface_t draw_target = {NULL, 0, 0};
+
+// NULL to draw on the bg again
+void surface_set_target(uint8_t *pixels, uint16_t w, uint16_t h) {
+    if(pixels == NULL || w == 0 || h == 0) {
+        draw_target.pixels = NULL;
+        draw_target.w = 0;
+        draw_target.h = 0;
+        return;
+    }
+    draw_target.pixels = pixels;
+    draw_target.w = w;
+    draw_target.h = h;
+}
+
+// The bg, offscreen area and all
+surface_t surface_bg() {
+    surface_t s = {bg, H_RES+OFFSCREEN_X_PX, V_RES+OFFSCREEN_Y_PX};
+    return s;
+}
+
+surface_t surface_target() {
+    if(draw_target.pixels == NULL) return surface_bg();
+    return draw_target;
+}
+
+void surface_clear(surface_t *s, uint8_t pal_idx) {
+    memset(s->pixels, pal_idx, (uint32_t)s->w * s->h);
+}
+
+// Copy the w*h rect at sx,sy in src to dx,dy in dst, skipping ALPHA pixels if alpha is set.
+// The rect is trimmed to fit both. src and dst can be the same surface, overlapping rects are fine without alpha
+void surface_blit(const surface_t *src, int16_t sx, int16_t sy, int16_t w, int16_t h,
+                  surface_t *dst, int16_t dx, int16_t dy, uint8_t alpha) {
+    if(sx < 0) { w += sx; dx -= sx; sx = 0; }
+    if(sy < 0) { h += sy; dy -= sy; sy = 0; }
+    if(dx < 0) { w += dx; sx -= dx; dx = 0; }
+    if(dy < 0) { h += dy; sy -= dy; dy = 0; }
+    if(sx + w > src->w) w = src->w - sx;
+    if(sy + h > src->h) h = src->h - sy;
+    if(dx + w > dst->w) w = dst->w - dx;
+    if(dy + h > dst->h) h = dst->h - dy;
+    if(w <= 0 || h <= 0) return;
+
+    // Going up the rows when moving down inside one buffer, so we don't read rows we've already written
+    int16_t j0 = 0, j1 = h, step = 1;
+    if(src->pixels == dst->pixels && dy > sy) { j0 = h - 1; j1 = -1; step = -1; }
+    for(int16_t j = j0; j != j1; j += step) {
+        const uint8_t *s = src->pixels + (uint32_t)(sy + j) * src->w + sx;
+        uint8_t *d = dst->pixels + (uint32_t)(dy + j) * dst->w + dx;
+        if(alpha) {
+            for(int16_t i = 0; i < w; i++) if(s[i] != ALPHA) d[i] = s[i];
+        } else {
+            memmove(d, s, w);
+        }
+    }
+}
+
+// Decoded PNG pixels, 4 bytes each. Fully transparent pixels are skipped, like display_set_bg_bitmap_rgba
+void surface_set_rgba(surface_t *s, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *rgba) {
+    for(int32_t j = 0; j < h; j++) {
+        int32_t py = y + j;
+        if(py < 0 || py >= s->h) continue;
+        const uint8_t *p = rgba + (uint32_t)j * w * 4;
+        uint8_t *row = s->pixels + (uint32_t)py * s->w;
+        for(int32_t i = 0; i < w; i++, p += 4) {
+            int32_t px = x + i;
+            if(px < 0 || px >= s->w || p[3] == 0) continue;
+            row[px] = color_332(p[0], p[1], p[2]);
+        }
+    }
+}
@@ -0,0 +1,27 @@
+// surface.h
+// RGB332 pixel buffers of any size that bg drawing can be pointed at instead of the bg, and clipped blits between them
+#ifndef __SURFACEH
+#define __SURFACEH
+
+#include "display.h"
+#include "polyfills.h"
+
+// Rows are w pixels apart, one byte each
+typedef struct {
+    uint8_t *pixels;
+    uint16_t w, h;
+} surface_t;
+
+// Where drawPixel and the bg_ calls draw. pixels is NULL when that's the bg, which gets reallocated on a timing change.
+// Otherwise they're in a python buffer that can move, so modtulip sets them again before every call that draws
+extern surface_t draw_target;
+
+void surface_set_target(uint8_t *pixels, uint16_t w, uint16_t h);
+surface_t surface_bg();
+surface_t surface_target();
+void surface_clear(surface_t *s, uint8_t pal_idx);
+void surface_blit(const surface_t *src, int16_t sx, int16_t sy, int16_t w, int16_t h,
+                  surface_t *dst, int16_t dx, int16_t dy, uint8_t alpha);
+void surface_set_rgba(surface_t *s, int16_t x, int16_t y, uint16_t w, uint16_t h, const uint8_t *rgba);
+
+#endif
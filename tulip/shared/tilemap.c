@@ -0,0 +1,246 @@
+// tilemap.c
+// A tile map layer like the BG planes on old consoles: a set of small tiles, a map of tile numbers (with flips) as
+// big as you like, and a viewport that scrolls around it, wrapping at the edges. display_bounce_empty() draws each
+// screen row straight from the tiles, so a world far bigger than bg costs map_w*map_h*2 bytes, and scrolling it
+// is two numbers instead of blitting new tiles into bg.
+#include "tilemap.h"
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+tilemap_t tilemap;
+// The compositor has the layer in use for this bounce. Tiles and maps are only freed when it doesn't
+static uint8_t tilemap_busy = 0;
+static uint8_t tilemap_live = 0;
+// Scroll set by python, latched at frame done so the layer never moves halfway down the screen
+static int32_t next_x, next_y;
+static uint8_t next_pending = 0;
+
+#ifdef ESP_PLATFORM
+static portMUX_TYPE tilemap_mux = portMUX_INITIALIZER_UNLOCKED;
+#define TILEMAP_LOCK() portENTER_CRITICAL_SAFE(&tilemap_mux)
+#define TILEMAP_UNLOCK() portEXIT_CRITICAL_SAFE(&tilemap_mux)
+#else
+#define TILEMAP_LOCK() mp_uint_t tilemap_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define TILEMAP_UNLOCK() MICROPY_END_ATOMIC_SECTION(tilemap_atomic)
+#endif
+
+static inline uint32_t wrap(int32_t v, uint32_t n) {
+    int32_t r = v % (int32_t)n;
+    return r < 0 ? r + n : r;
+}
+
+static void tilemap_dirty() {
+    if(tilemap.on) display_dirty_add(0, tilemap.top, H_RES-1, tilemap.bottom-1);
+}
+
+static uint8_t tilemap_drawable() {
+    return tilemap.on && tilemap.pixels != NULL && tilemap.map != NULL;
+}
+
+// Stop the compositor using the layer and wait out a bounce that already is
+static void tilemap_pause() {
+    __atomic_store_n(&tilemap_live, 0, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&tilemap_busy, __ATOMIC_SEQ_CST)) delay_ms(1);
+}
+
+static void tilemap_resume() {
+    __atomic_store_n(&tilemap_live, tilemap_drawable(), __ATOMIC_SEQ_CST);
+    tilemap_dirty();
+}
+
+// pixels is count tiles of tile_w*tile_h, one after another
+uint8_t tilemap_tiles(const uint8_t *pixels, uint8_t tile_w, uint8_t tile_h, uint16_t count) {
+    if(tile_w == 0 || tile_h == 0 || count == 0 || count > TILE_INDEX_MASK) return 0;
+    uint32_t len = (uint32_t)count * tile_w * tile_h;
+    uint8_t *p = (uint8_t*)malloc_caps(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    uint8_t *opaque = (uint8_t*)malloc_caps((count + 7) / 8, MALLOC_CAP_INTERNAL);
+    if(p == NULL || opaque == NULL) {
+        if(p != NULL) free_caps(p);
+        if(opaque != NULL) free_caps(opaque);
+        return 0;
+    }
+    memcpy(p, pixels, len);
+    memset(opaque, 0, (count + 7) / 8);
+    for(uint16_t t=0;t<count;t++) {
+        const uint8_t *tp = p + (uint32_t)t * tile_w * tile_h;
+        uint8_t solid = 1;
+        for(uint16_t i=0;i<tile_w*tile_h && solid;i++) if(tp[i] == ALPHA) solid = 0;
+        if(solid) opaque[t / 8] |= 1 << (t % 8);
+    }
+    tilemap_pause();
+    if(tilemap.pixels != NULL) free_caps(tilemap.pixels);
+    if(tilemap.opaque != NULL) free_caps(tilemap.opaque);
+    tilemap.pixels = p;
+    tilemap.opaque = opaque;
+    tilemap.tile_w = tile_w;
+    tilemap.tile_h = tile_h;
+    tilemap.tiles = count;
+    tilemap_resume();
+    return 1;
+}
+
+// A tile sheet, like a decoded PNG: tiles are cut left to right, top to bottom. Returns how many, -1 if no RAM
+int32_t tilemap_tiles_rgba(const uint8_t *rgba, uint32_t w, uint32_t h, uint8_t tile_w, uint8_t tile_h) {
+    if(tile_w == 0 || tile_h == 0) return 0;
+    uint32_t cols = w / tile_w;
+    uint32_t rows = h / tile_h;
+    uint32_t count = MIN(cols * rows, TILE_INDEX_MASK);
+    if(count == 0) return 0;
+    uint8_t *p = (uint8_t*)malloc_caps(count * tile_w * tile_h, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if(p == NULL) return -1;
+    uint8_t *o = p;
+    for(uint32_t t=0;t<count;t++) {
+        uint32_t sx = (t % cols) * tile_w;
+        uint32_t sy = (t / cols) * tile_h;
+        for(uint8_t ty=0;ty<tile_h;ty++) {
+            const uint8_t *s = rgba + ((sy + ty) * w + sx) * 4;
+            for(uint8_t tx=0;tx<tile_w;tx++, s+=4) {
+                // only full transparent counts, like sprites
+                *o++ = (s[3] == 0) ? ALPHA : color_332(s[0], s[1], s[2]);
+            }
+        }
+    }
+    uint8_t ok = tilemap_tiles(p, tile_w, tile_h, count);
+    free_caps(p);
+    return ok ? (int32_t)count : -1;
+}
+
+uint8_t tilemap_map(const uint16_t *map, uint16_t map_w, uint16_t map_h) {
+    if(map_w == 0 || map_h == 0) return 0;
+    uint16_t *m = (uint16_t*)malloc_caps((uint32_t)map_w * map_h * sizeof(uint16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if(m == NULL) return 0;
+    memcpy(m, map, (uint32_t)map_w * map_h * sizeof(uint16_t));
+    tilemap_pause();
+    if(tilemap.map != NULL) free_caps(tilemap.map);
+    tilemap.map = m;
+    tilemap.map_w = map_w;
+    tilemap.map_h = map_h;
+    tilemap_resume();
+    return 1;
+}
+
+// One entry, for tiles that change as the game goes. Shows up whenever that row is next drawn
+void tilemap_set(uint16_t x, uint16_t y, uint16_t entry) {
+    if(tilemap.map == NULL || x >= tilemap.map_w || y >= tilemap.map_h) return;
+    tilemap.map[(uint32_t)y * tilemap.map_w + x] = entry;
+    tilemap_dirty();
+}
+
+uint16_t tilemap_get(uint16_t x, uint16_t y) {
+    if(tilemap.map == NULL || x >= tilemap.map_w || y >= tilemap.map_h) return TILE_EMPTY;
+    return tilemap.map[(uint32_t)y * tilemap.map_w + x];
+}
+
+void tilemap_scroll(int32_t x, int32_t y, int16_t x_speed, int16_t y_speed) {
+    TILEMAP_LOCK();
+    next_x = x;
+    next_y = y;
+    next_pending = 1;
+    tilemap.x_speed = x_speed;
+    tilemap.y_speed = y_speed;
+    TILEMAP_UNLOCK();
+}
+
+void tilemap_show(int16_t top, int16_t bottom) {
+    tilemap_pause();
+    tilemap.top = MAX(top, 0);
+    tilemap.bottom = MIN(bottom, V_RES);
+    tilemap.on = 1;
+    tilemap_resume();
+}
+
+void tilemap_hide() {
+    tilemap_dirty();
+    tilemap_pause();
+    tilemap.on = 0;
+}
+
+// Back to nothing, and give the RAM back
+void tilemap_reset() {
+    tilemap_hide();
+    if(tilemap.pixels != NULL) free_caps(tilemap.pixels);
+    if(tilemap.opaque != NULL) free_caps(tilemap.opaque);
+    if(tilemap.map != NULL) free_caps(tilemap.map);
+    memset(&tilemap, 0, sizeof(tilemap));
+    tilemap.bottom = V_RES;
+    next_pending = 0;
+}
+
+// From display_frame_done_generic, an ISR on the ESP
+void tilemap_frame_done() {
+    uint8_t moved = 0;
+    TILEMAP_LOCK();
+    if(next_pending) {
+        tilemap.x = next_x;
+        tilemap.y = next_y;
+        next_pending = 0;
+        moved = 1;
+    }
+    if(tilemap.x_speed || tilemap.y_speed) {
+        tilemap.x += tilemap.x_speed;
+        tilemap.y += tilemap.y_speed;
+        moved = 1;
+    }
+    // Keep them small so they never overflow, the layer looks the same
+    if(moved && tilemap.map_w && tilemap.map_h && tilemap.tile_w && tilemap.tile_h) {
+        tilemap.x = wrap(tilemap.x, tilemap.map_w * tilemap.tile_w);
+        tilemap.y = wrap(tilemap.y, tilemap.map_h * tilemap.tile_h);
+    }
+    TILEMAP_UNLOCK();
+    if(moved) tilemap_dirty();
+}
+
+// The compositor brackets each bounce with these, and only draws rows if begin says so
+uint8_t IRAM_ATTR tilemap_begin() {
+    __atomic_store_n(&tilemap_busy, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&tilemap_live, __ATOMIC_SEQ_CST)) return 1;
+    __atomic_store_n(&tilemap_busy, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void IRAM_ATTR tilemap_end() {
+    __atomic_store_n(&tilemap_busy, 0, __ATOMIC_RELEASE);
+}
+
+// One screen row of the layer over what's already in row. Whole runs of opaque, unflipped tiles are a memcpy
+void IRAM_ATTR tilemap_row(uint8_t *row, uint16_t y) {
+    tilemap_t *t = &tilemap;
+    if((int16_t)y < t->top || (int16_t)y >= t->bottom) return;
+    uint8_t tw = t->tile_w;
+    uint8_t th = t->tile_h;
+    uint32_t my = wrap(t->y + (y - t->top), (uint32_t)t->map_h * th);
+    uint32_t mx = wrap(t->x, (uint32_t)t->map_w * tw);
+    const uint16_t *map_row = &t->map[(my / th) * t->map_w];
+    uint8_t py = my % th;
+    uint16_t col = mx / tw;
+    uint8_t px = mx % tw;
+    uint16_t x = 0;
+    while(x < H_RES) {
+        uint16_t e = map_row[col];
+        uint16_t run = MIN(tw - px, H_RES - x);
+        uint16_t idx = e & TILE_INDEX_MASK;
+        if(idx < t->tiles) {
+            uint8_t ty = (e & TILE_FLIP_V) ? th - 1 - py : py;
+            const uint8_t *src = t->pixels + ((uint32_t)idx * th + ty) * tw;
+            uint8_t *dst = row + x;
+            if(e & TILE_FLIP_H) {
+                for(uint16_t i=0;i<run;i++) {
+                    uint8_t c = src[tw - 1 - px - i];
+                    if(c != ALPHA) dst[i] = c;
+                }
+            } else if(t->opaque[idx / 8] & (1 << (idx % 8))) {
+                memcpy(dst, src + px, run);
+            } else {
+                for(uint16_t i=0;i<run;i++) {
+                    uint8_t c = src[px + i];
+                    if(c != ALPHA) dst[i] = c;
+                }
+            }
+        }
+        x += run;
+        px = 0;
+        if(++col == t->map_w) col = 0;
+    }
+}
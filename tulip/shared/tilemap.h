@@ -0,0 +1,44 @@
+// tilemap.h
+// a scrolling tile map layer, drawn per scanline between the BG and the TFB
+#ifndef __TILEMAPH
+#define __TILEMAPH
+
+#include "display.h"
+#include "polyfills.h"
+
+// A map entry is a tile number and flip bits. Tile numbers past the end of the tile set are see through
+#define TILE_INDEX_MASK 0x3fff
+#define TILE_FLIP_H 0x4000
+#define TILE_FLIP_V 0x8000
+#define TILE_EMPTY TILE_INDEX_MASK
+
+typedef struct {
+    uint8_t on;
+    uint8_t tile_w, tile_h;
+    uint16_t tiles;         // in the tile set
+    uint8_t *pixels;        // tiles * tile_h * tile_w RGB332, one tile after another. ALPHA is see through
+    uint8_t *opaque;        // bit per tile, set if it has no ALPHA pixels and can be copied straight
+    uint16_t *map;          // map_h rows of map_w entries
+    uint16_t map_w, map_h;
+    int16_t top, bottom;    // screen rows the layer covers, bottom not included
+    int32_t x, y;           // the map pixel at the layer's top left, wraps around the map
+    int16_t x_speed, y_speed;
+} tilemap_t;
+
+extern tilemap_t tilemap;
+
+uint8_t tilemap_tiles(const uint8_t *pixels, uint8_t tile_w, uint8_t tile_h, uint16_t count);
+int32_t tilemap_tiles_rgba(const uint8_t *rgba, uint32_t w, uint32_t h, uint8_t tile_w, uint8_t tile_h);
+uint8_t tilemap_map(const uint16_t *map, uint16_t map_w, uint16_t map_h);
+void tilemap_set(uint16_t x, uint16_t y, uint16_t entry);
+uint16_t tilemap_get(uint16_t x, uint16_t y);
+void tilemap_scroll(int32_t x, int32_t y, int16_t x_speed, int16_t y_speed);
+void tilemap_show(int16_t top, int16_t bottom);
+void tilemap_hide();
+void tilemap_reset();
+void tilemap_frame_done();
+uint8_t tilemap_begin();
+void tilemap_row(uint8_t *row, uint16_t y);
+void tilemap_end();
+
+#endif
@@ -24,6 +24,18 @@ EXTMOD_SRC_C += $(addprefix $(TULIP_EXTMOD_DIR)/, \
 	u8g2_fonts.c \
 	u8fontdata.c \
 	bresenham.c \
+	displaylist.c \
+	perf.c \
+	bench.c \
+	capture.c \
+	events.c \
+	vector.c \
+	copper.c \
+	tilemap.c \
+	motion.c \
+	collide.c \
+	gesture.c \
+	surface.c \
 	ui.c \
 	help.c \
 	tulip_helpers.c \
@@ -35,6 +47,8 @@ EXTMOD_SRC_C += $(addprefix $(TULIP_EXTMOD_DIR)/, \
 	lodepng.c \
 	sequencer.c \
 	lvgl_u8g2.c \
+	lvgl_png.c \
+	lvgl_render.c \
 	memorypcm.c \
 	)
 
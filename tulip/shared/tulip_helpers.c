@@ -1,7 +1,12 @@
 // tulip_helpers.c
 
 #include "tulip_helpers.h"
+#include "polyfills.h"
 #include "ui.h"
+#ifndef ESP_PLATFORM
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 extern uint8_t keyboard_send_keys_to_micropython;
 extern int8_t keyboard_grab_ui_focus;
 
@@ -39,37 +44,32 @@ int32_t file_size(const char *filename) {
 
 
 
+static mp_obj_t open_vfs(const char *filename, const char *mode) {
+    mp_obj_t m_args[2];
+    m_args[0] = mp_obj_new_str(filename, strlen(filename));
+    m_args[1] = mp_obj_new_str(mode, strlen(mode));
+    return mp_vfs_open(2, &m_args[0], (mp_map_t *)&mp_const_empty_map);
+}
+
 // if len < 0, read the whole thing
 uint32_t read_file(const char *filename, uint8_t *buf, int32_t len, uint8_t binary) {
     if(len<0) {
     	len = file_size(filename);
     }
-    mp_obj_t m_args[2];
-    m_args[0] = mp_obj_new_str(filename, strlen(filename));
-    if(binary) {
-	    m_args[1] = mp_obj_new_str("rb",2);
-	} else {
-	    m_args[1] = mp_obj_new_str("r",1);		
-	}
-    mp_obj_t file = mp_vfs_open(2, &m_args[0], (mp_map_t *)&mp_const_empty_map);
+    mp_obj_t file = open_vfs(filename, binary ? "rb" : "r");
+    // One read for the lot: FatFs and LittleFS move whole sectors straight into buf instead of through their cache
     int errcode;
-    size_t bytes_read = mp_stream_rw(file, buf, len, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    size_t bytes_read = mp_stream_rw(file, buf, len, &errcode, MP_STREAM_RW_READ);
     mp_stream_close(file);
     return bytes_read;
 }
 
 // overwrites if exists
 uint32_t write_file(const char *filename, uint8_t *buf, uint32_t len, uint8_t binary) {
-    mp_obj_t m_args[2];
-    m_args[0] = mp_obj_new_str(filename, strlen(filename)+1);
-    if(binary) {
-	    m_args[1] = mp_obj_new_str("wb\0",3);
-	} else {
-	    m_args[1] = mp_obj_new_str("w\0",2);		
-	}
-    mp_obj_t file = mp_vfs_open(2, &m_args[0], (mp_map_t *)&mp_const_empty_map);
+    mp_obj_t file = open_vfs(filename, binary ? "wb" : "w");
     int errcode;
-    size_t bytes_written = mp_stream_rw(file, buf, len, &errcode, MP_STREAM_RW_WRITE | MP_STREAM_RW_ONCE);
+    // Not RW_ONCE, a short write would otherwise leave a truncated file
+    size_t bytes_written = mp_stream_rw(file, buf, len, &errcode, MP_STREAM_RW_WRITE);
     mp_stream_close(file);
     return bytes_written;
 }
@@ -86,11 +86,7 @@ void tulip_fclose(mp_obj_t file) {
 }
 
 mp_obj_t tulip_fopen(const char *filename, const char *mode) {
-    mp_obj_t m_args[2];
-    m_args[0] = mp_obj_new_str(filename, strlen(filename));
-    m_args[1] = mp_obj_new_str(mode,strlen(mode));
-    mp_obj_t file = mp_vfs_open(2, &m_args[0], (mp_map_t *)&mp_const_empty_map);
-    return file;    
+    return open_vfs(filename, mode);
 }
 
 uint32_t tulip_fwrite(mp_obj_t file, uint8_t * buf, uint32_t len) {
@@ -109,26 +105,149 @@ uint32_t tulip_fseek(mp_obj_t file, uint32_t seekpoint, int32_t whence) {
     return mp_stream_posix_lseek(file, seekpoint, whence);
 }
 
-int32_t tulip_getline(char * line, uint32_t * len, mp_obj_t file ) {
-    // tulip_fread a char at a time until a \n
-    uint8_t buf[1];
-    int32_t rbytes = 0;
-    for(uint8_t i=0;i<255;i++) {
-        uint32_t bytes = tulip_fread(file, buf, 1);
-        rbytes += bytes;
-        if(bytes == 0) { // eof
-            line[i] = 0;
-            return rbytes;
+uint8_t tulip_file_open(tulip_file_t *f, const char *filename, const char *mode) {
+    f->pos = 0;
+    f->fill = 0;
+    f->writing = (strchr(mode, 'w') != NULL || strchr(mode, 'a') != NULL);
+    // Open first, so a bad path raising doesn't leak the buffer
+    f->file = open_vfs(filename, mode);
+    f->buf = (uint8_t*)malloc_caps(TULIP_FILE_BUF, MALLOC_CAP_SPIRAM);
+    if(f->buf == NULL) {
+        mp_stream_close(f->file);
+        f->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void tulip_file_flush(tulip_file_t *f) {
+    if(f->writing && f->fill) {
+        int errcode;
+        mp_stream_rw(f->file, f->buf, f->fill, &errcode, MP_STREAM_RW_WRITE);
+    }
+    f->fill = 0;
+}
+
+uint32_t tulip_file_read(tulip_file_t *f, uint8_t *buf, uint32_t len) {
+    int errcode;
+    uint32_t got = f->fill - f->pos;
+    if(got > len) got = len;
+    memcpy(buf, f->buf + f->pos, got);
+    f->pos += got;
+    if(got == len) return got;
+    // Buffer's empty. Big reads go straight to the caller, small ones refill
+    if(len - got >= TULIP_FILE_BUF) {
+        return got + mp_stream_rw(f->file, buf + got, len - got, &errcode, MP_STREAM_RW_READ);
+    }
+    f->fill = mp_stream_rw(f->file, f->buf, TULIP_FILE_BUF, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    uint32_t more = f->fill < len - got ? f->fill : len - got;
+    memcpy(buf + got, f->buf, more);
+    f->pos = more;
+    return got + more;
+}
+
+// Reads up to and not including the next \n into line, always null terminated. Returns the bytes consumed
+// from the file (so the \n counts), 0 at the end of the file. Lines longer than max-1 are cut short and the
+// rest comes back on the next call.
+int32_t tulip_file_getline(tulip_file_t *f, char *line, uint32_t max) {
+    int32_t consumed = 0;
+    uint32_t n = 0;
+    while(n + 1 < max) {
+        if(f->pos == f->fill) {
+            int errcode;
+            f->fill = mp_stream_rw(f->file, f->buf, TULIP_FILE_BUF, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+            f->pos = 0;
+            if(f->fill == 0) break;
         }
-        if(buf[0] == '\n') {
-            line[i] = 0;
-            return rbytes;
+        uint8_t *start = f->buf + f->pos;
+        uint32_t avail = f->fill - f->pos;
+        uint8_t *nl = memchr(start, '\n', avail);
+        uint32_t take = nl ? (uint32_t)(nl - start) : avail;
+        if(take > max - 1 - n) { take = max - 1 - n; nl = NULL; }
+        memcpy(line + n, start, take);
+        n += take;
+        f->pos += take;
+        consumed += take;
+        if(nl) {
+            f->pos++;
+            consumed++;
+            break;
         }
-        line[i] = buf[0];
-        *len = *len + 1;
     }
-    line[254] = 0;
-    return rbytes;
+    line[n] = 0;
+    return consumed;
+}
+
+uint32_t tulip_file_write(tulip_file_t *f, const uint8_t *buf, uint32_t len) {
+    if(f->fill + len > TULIP_FILE_BUF) tulip_file_flush(f);
+    if(len >= TULIP_FILE_BUF) {
+        int errcode;
+        return mp_stream_rw(f->file, (void*)buf, len, &errcode, MP_STREAM_RW_WRITE);
+    }
+    memcpy(f->buf + f->fill, buf, len);
+    f->fill += len;
+    return len;
+}
+
+void tulip_file_close(tulip_file_t *f) {
+    if(f->file != NULL) {
+        tulip_file_flush(f);
+        mp_stream_close(f->file);
+        f->file = NULL;
+    }
+    if(f->buf != NULL) free_caps(f->buf);
+    f->buf = NULL;
 }
 
+// Returns 0 if the file isn't there or we're out of memory
+uint8_t tulip_file_map(const char *filename, tulip_map_t *m) {
+    m->data = NULL;
+    m->len = 0;
+    m->mapped = 0;
+    if(!file_exists(filename)) return 0;
+    mp_obj_t file = open_vfs(filename, "rb");
+    int errcode;
+#ifndef ESP_PLATFORM
+    // Posix VFS files will give us their fd, so the kernel can page the file in for us
+    const mp_stream_p_t *stream_p = mp_get_stream(file);
+    mp_uint_t fd = stream_p->ioctl ? stream_p->ioctl(file, MP_STREAM_GET_FILENO, 0, &errcode) : MP_STREAM_ERROR;
+    struct stat st;
+    if(fd != MP_STREAM_ERROR && fstat(fd, &st) == 0 && st.st_size > 0) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) {
+            m->data = (uint8_t*)p;
+            m->len = st.st_size;
+            m->mapped = 1;
+            mp_stream_close(file); // the mapping outlives the fd
+            return 1;
+        }
+    }
+#endif
+    int32_t len = mp_stream_posix_lseek(file, 0, SEEK_END);
+    mp_stream_posix_lseek(file, 0, SEEK_SET);
+    if(len <= 0) {
+        mp_stream_close(file);
+        return len == 0;
+    }
+    m->data = (uint8_t*)malloc_caps(len, MALLOC_CAP_SPIRAM);
+    if(m->data == NULL) {
+        mp_stream_close(file);
+        return 0;
+    }
+    m->len = mp_stream_rw(file, m->data, len, &errcode, MP_STREAM_RW_READ);
+    mp_stream_close(file);
+    return 1;
+}
 
+void tulip_file_unmap(tulip_map_t *m) {
+    if(m->data == NULL) return;
+#ifndef ESP_PLATFORM
+    if(m->mapped) {
+        munmap(m->data, m->len);
+        m->data = NULL;
+        return;
+    }
+#endif
+    free_caps(m->data);
+    m->data = NULL;
+}
@@ -23,5 +23,32 @@ mp_obj_t tulip_fopen(const char *filename, const char *mode);
 uint32_t tulip_fwrite(mp_obj_t file, uint8_t * buf, uint32_t len);
 void tulip_fclose(mp_obj_t file);
 uint32_t tulip_fseek(mp_obj_t file, uint32_t seekpoint, int32_t whence);
-int32_t tulip_getline(char * line, uint32_t * len, mp_obj_t file );
+
+// Buffered files for native code. Keep the tulip_file_t on the C stack (so the GC can see the file object)
+// and use it within one native call. Reads and writes go to the VFS TULIP_FILE_BUF bytes at a time,
+// bigger reads and writes skip the buffer.
+#define TULIP_FILE_BUF 4096
+typedef struct {
+    mp_obj_t file;
+    uint8_t *buf;
+    uint32_t pos;       // next byte to hand out of buf
+    uint32_t fill;      // bytes in buf, read ahead or waiting to be written
+    uint8_t writing;
+} tulip_file_t;
+
+uint8_t tulip_file_open(tulip_file_t *f, const char *filename, const char *mode);
+uint32_t tulip_file_read(tulip_file_t *f, uint8_t *buf, uint32_t len);
+int32_t tulip_file_getline(tulip_file_t *f, char *line, uint32_t max);
+uint32_t tulip_file_write(tulip_file_t *f, const uint8_t *buf, uint32_t len);
+void tulip_file_close(tulip_file_t *f);
+
+// A whole file, read only. mmap'd on Tulip Desktop, one big read into SPIRAM on Tulip CC
+typedef struct {
+    uint8_t *data;
+    uint32_t len;
+    uint8_t mapped;
+} tulip_map_t;
+
+uint8_t tulip_file_map(const char *filename, tulip_map_t *m);
+void tulip_file_unmap(tulip_map_t *m);
 #endif
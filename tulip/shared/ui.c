@@ -1,10 +1,12 @@
 // ui.c
 // user interface components
 #include "ui.h"
+#include "gesture.h"
 
 
 
 void send_touch_to_micropython(int16_t touch_x, int16_t touch_y, uint8_t up) {
+    gesture_touch(up ? 0 : touch_points);
     // respond to finger down / up
     if(touch_held && up) { // this is a finger up / click release
         // If there's any text entry happening, in all cases, a touch up stops it
@@ -0,0 +1,325 @@
+// vector.c
+// Vector sprites: a sprite slot drawn from lines, quadratic beziers or ellipses instead of a bitmap.
+// Shapes are set once from python and flattened to line segments. At the start of each frame the display task
+// bins every visible vector sprite's segments into per scanline spans, and display_bounce_empty() draws each
+// row's spans straight into the bounce buffer along with the bitmap sprites. Nothing touches bg, so there's
+// nothing to erase: moving a shape is a sprite_move, and a frame where nothing moved doesn't bin at all.
+#include "vector.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef ESP_PLATFORM
+#include "freertos/FreeRTOS.h"
+#endif
+
+#define VECTOR_VIS (SPRITE_IS_WIREFRAME | SPRITE_IS_BEZIER | SPRITE_IS_ELLIPSE)
+
+typedef struct {
+    vector_seg_t *segs;
+    uint32_t count;
+    uint8_t kind;
+    display_rect_t box; // around all the segments, relative to the sprite's x,y
+} vector_shape_t;
+
+static vector_shape_t vector_shapes[SPRITES];
+static vector_bins_t vector_bufs[2];
+static uint32_t *vector_fill = NULL;    // [V_RES], where each row's next span goes while placing. Allocated last
+vector_bins_t * volatile vector_front = NULL;
+static uint8_t vector_ready = 0;        // the back buffer is binned and waits for frame done to be shown
+static uint8_t vector_binning = 0;      // the display task is reading shapes, don't free them
+static uint32_t vector_version = 1;     // bumped on every shape change
+// What the last bin was made from, so frames where nothing changed are free
+static uint32_t binned_version = 0;
+static uint16_t binned_x[SPRITES], binned_y[SPRITES];
+static uint8_t binned_vis[SPRITES];
+
+// Shapes are swapped by the MP task and read by the display task
+#ifdef ESP_PLATFORM
+static portMUX_TYPE vector_mux = portMUX_INITIALIZER_UNLOCKED;
+#define VECTOR_LOCK() portENTER_CRITICAL_SAFE(&vector_mux)
+#define VECTOR_UNLOCK() portEXIT_CRITICAL_SAFE(&vector_mux)
+#else
+#define VECTOR_LOCK() mp_uint_t vector_atomic = MICROPY_BEGIN_ATOMIC_SECTION()
+#define VECTOR_UNLOCK() MICROPY_END_ATOMIC_SECTION(vector_atomic)
+#endif
+
+static int16_t clamp16(int32_t v) {
+    return (int16_t)MIN(MAX(v, INT16_MIN), INT16_MAX);
+}
+
+static vector_bins_t *vector_back() {
+    return (vector_front == &vector_bufs[0]) ? &vector_bufs[1] : &vector_bufs[0];
+}
+
+// The bins are big (MAX_LINE_EMITS spans twice) so nothing is allocated until the first shape is set
+static uint8_t vector_alloc() {
+    if(vector_fill != NULL) return 1;
+    uint8_t ok = 1;
+    for(uint8_t i=0;i<2;i++) {
+        vector_bufs[i].row_start = (uint32_t*)malloc_caps((V_RES+1)*sizeof(uint32_t), MALLOC_CAP_INTERNAL);
+        vector_bufs[i].spans = (vector_span_t*)malloc_caps(MAX_LINE_EMITS*sizeof(vector_span_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(vector_bufs[i].row_start == NULL || vector_bufs[i].spans == NULL) ok = 0;
+    }
+    uint32_t *fill = (uint32_t*)malloc_caps(V_RES*sizeof(uint32_t), MALLOC_CAP_INTERNAL);
+    if(fill == NULL) ok = 0;
+    if(!ok) {
+        fprintf(stderr, "not enough RAM for vector sprites\n");
+        for(uint8_t i=0;i<2;i++) {
+            if(vector_bufs[i].row_start != NULL) free_caps(vector_bufs[i].row_start);
+            if(vector_bufs[i].spans != NULL) free_caps(vector_bufs[i].spans);
+            vector_bufs[i].row_start = NULL;
+            vector_bufs[i].spans = NULL;
+        }
+        if(fill != NULL) free_caps(fill);
+        return 0;
+    }
+    __atomic_store_n(&vector_fill, fill, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Put a new shape in a slot and free the old one once the display task can't be looking at it
+static void vector_swap(uint8_t s, vector_shape_t *shape) {
+    VECTOR_LOCK();
+    vector_shape_t old = vector_shapes[s];
+    vector_shapes[s] = *shape;
+    vector_version++;
+    VECTOR_UNLOCK();
+    while(__atomic_load_n(&vector_binning, __ATOMIC_SEQ_CST)) delay_ms(1);
+    if(old.segs != NULL) free_caps(old.segs);
+}
+
+// About one segment per 8px of control polygon
+static uint16_t vector_bezier_segs(const int16_t *p) {
+    uint32_t len = abs(p[2]-p[0]) + abs(p[3]-p[1]) + abs(p[4]-p[2]) + abs(p[5]-p[3]);
+    return MIN(MAX(len / 8, 2), VECTOR_BEZIER_SEGS);
+}
+
+// About one segment per 6px of circumference
+static uint16_t vector_ellipse_segs(const int16_t *p) {
+    uint32_t r = abs(p[2]) + abs(p[3]);
+    return MIN(MAX(r / 2, 8), VECTOR_ELLIPSE_SEGS);
+}
+
+// kind is SPRITE_IS_WIREFRAME, _BEZIER or _ELLIPSE, prims is count records of VECTOR_*_LEN int16s.
+// Returns how many line segments that made, -1 if we ran out of RAM
+int32_t vector_set(uint8_t s, uint8_t kind, const int16_t *prims, uint32_t count) {
+    if(s >= SPRITES) return -1;
+    if(!vector_alloc()) return -1;
+    uint8_t len = (kind == SPRITE_IS_BEZIER) ? VECTOR_BEZIER_LEN : VECTOR_LINE_LEN;
+    uint32_t n = 0;
+    for(uint32_t i=0;i<count;i++) {
+        const int16_t *p = prims + i*len;
+        if(kind == SPRITE_IS_BEZIER) n += vector_bezier_segs(p);
+        else if(kind == SPRITE_IS_ELLIPSE) n += vector_ellipse_segs(p);
+        else n++;
+    }
+    vector_shape_t shape = { NULL, n, kind, { 0, 0, -1, -1 } };
+    if(n) {
+        shape.segs = (vector_seg_t*)malloc_caps(n*sizeof(vector_seg_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if(shape.segs == NULL) return -1;
+    }
+    vector_seg_t *o = shape.segs;
+    for(uint32_t i=0;i<count;i++) {
+        const int16_t *p = prims + i*len;
+        uint8_t color = (uint8_t)p[len-1];
+        if(kind == SPRITE_IS_BEZIER) {
+            uint16_t segs = vector_bezier_segs(p);
+            int16_t px = p[0], py = p[1];
+            for(uint16_t k=1;k<=segs;k++) {
+                float t = (float)k / segs;
+                float mt = 1.0f - t;
+                int16_t x = clamp16(lroundf(mt*mt*p[0] + 2.0f*mt*t*p[2] + t*t*p[4]));
+                int16_t y = clamp16(lroundf(mt*mt*p[1] + 2.0f*mt*t*p[3] + t*t*p[5]));
+                *o++ = (vector_seg_t){ px, py, x, y, color };
+                px = x; py = y;
+            }
+        } else if(kind == SPRITE_IS_ELLIPSE) {
+            uint16_t segs = vector_ellipse_segs(p);
+            int16_t px = clamp16(p[0] + p[2]), py = p[1];
+            for(uint16_t k=1;k<=segs;k++) {
+                float a = 2.0f * (float)M_PI * k / segs;
+                int16_t x = clamp16(p[0] + lroundf(p[2] * cosf(a)));
+                int16_t y = clamp16(p[1] + lroundf(p[3] * sinf(a)));
+                *o++ = (vector_seg_t){ px, py, x, y, color };
+                px = x; py = y;
+            }
+        } else {
+            *o++ = (vector_seg_t){ p[0], p[1], p[2], p[3], color };
+        }
+    }
+    for(uint32_t i=0;i<n;i++) {
+        vector_seg_t *g = &shape.segs[i];
+        if(i == 0) shape.box = (display_rect_t){ g->x0, g->y0, g->x0, g->y0 };
+        shape.box.x0 = MIN(shape.box.x0, MIN(g->x0, g->x1));
+        shape.box.y0 = MIN(shape.box.y0, MIN(g->y0, g->y1));
+        shape.box.x1 = MAX(shape.box.x1, MAX(g->x0, g->x1));
+        shape.box.y1 = MAX(shape.box.y1, MAX(g->y0, g->y1));
+    }
+    vector_swap(s, &shape);
+    return n;
+}
+
+void vector_clear(uint8_t s) {
+    if(s >= SPRITES) return;
+    vector_shape_t shape = { NULL, 0, 0, { 0, 0, -1, -1 } };
+    vector_swap(s, &shape);
+}
+
+// What sprite_on should set sprite_vis to for this slot, 0 if it's a bitmap sprite
+uint8_t vector_kind(uint8_t s) {
+    if(s >= SPRITES) return 0;
+    return vector_shapes[s].kind;
+}
+
+// Where the shown frame drew slot s, for dirty rects
+uint8_t vector_bounds(uint8_t s, display_rect_t *r) {
+    vector_bins_t *b = vector_front;
+    if(b == NULL || s >= SPRITES || b->bounds[s].x1 < b->bounds[s].x0) return 0;
+    *r = b->bounds[s];
+    return 1;
+}
+
+void vector_stats(uint32_t *segs, uint32_t *spans, uint32_t *dropped) {
+    vector_bins_t *b = vector_front;
+    *segs = b ? b->segs : 0;
+    *spans = b ? b->row_start[V_RES] : 0;
+    *dropped = b ? b->dropped : 0;
+}
+
+void vector_reset() {
+    for(uint8_t s=0;s<SPRITES;s++) vector_clear(s);
+}
+
+// Add one span, or on the counting pass just count it. Both passes see spans in the same order, so the ones
+// past MAX_LINE_EMITS are the same ones both times
+static inline void vector_emit(vector_bins_t *b, uint8_t pass, uint32_t *emitted, int32_t y, int32_t x0, int32_t x1, uint8_t color, uint8_t s) {
+    if(x1 < 0 || x0 >= H_RES) return;
+    if((*emitted)++ >= MAX_LINE_EMITS) return;
+    if(pass == 0) {
+        b->row_start[y+1]++;
+        return;
+    }
+    vector_span_t *sp = &b->spans[vector_fill[y]++];
+    sp->x0 = MAX(x0, 0);
+    sp->x1 = MIN(x1, H_RES-1);
+    sp->color = color;
+    sp->s = s;
+}
+
+// The columns a segment covers on each row. A pixel is on a row if the line passes its centre within that row's
+// band of half a pixel either side, and the end points are always in, so joined segments don't leave gaps
+static void vector_seg_spans(vector_bins_t *b, uint8_t pass, uint32_t *emitted, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint8_t color, uint8_t s) {
+    if(y0 > y1) {
+        int32_t t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+    if(y1 < 0 || y0 >= V_RES) return;
+    if(y0 == y1) {
+        vector_emit(b, pass, emitted, y0, MIN(x0, x1), MAX(x0, x1), color, s);
+        return;
+    }
+    int64_t step = ((int64_t)(x1 - x0) * 65536) / (y1 - y0);
+    int32_t ya = MAX(y0, 0);
+    int32_t yb = MIN(y1, V_RES-1);
+    int64_t mid = ((int64_t)x0 * 65536) + step * (ya - y0);
+    for(int32_t y=ya;y<=yb;y++, mid += step) {
+        int64_t ea = (y == y0) ? ((int64_t)x0 * 65536) : mid - step/2;
+        int64_t eb = (y == y1) ? ((int64_t)x1 * 65536) : mid + step/2;
+        int64_t lo = MIN(ea, eb);
+        int64_t hi = MAX(ea, eb);
+        int32_t l = (int32_t)((lo + 0xffff) >> 16);
+        int32_t r = (int32_t)((hi + 0xffff) >> 16) - 1;
+        if(y == y0) { l = MIN(l, x0); r = MAX(r, x0); }
+        if(y == y1) { l = MIN(l, x1); r = MAX(r, x1); }
+        if(r < l) l = r = (int32_t)(((lo + hi) / 2 + 0x8000) >> 16);
+        vector_emit(b, pass, emitted, y, l, r, color, s);
+    }
+}
+
+// From the display task at the start of a frame. Bins into the back buffer, which frame done then swaps in,
+// so what's on screen is never half binned
+void vector_bin() {
+    if(__atomic_load_n(&vector_fill, __ATOMIC_ACQUIRE) == NULL) return;
+    if(__atomic_load_n(&vector_ready, __ATOMIC_ACQUIRE)) return;
+    uint8_t changed = (binned_version != __atomic_load_n(&vector_version, __ATOMIC_ACQUIRE));
+    for(uint8_t s=0;s<SPRITES && !changed;s++) {
+        uint8_t vis = sprite_vis[s] & VECTOR_VIS;
+        if(vis != binned_vis[s] || (vis && (sprite_x_px[s] != binned_x[s] || sprite_y_px[s] != binned_y[s]))) changed = 1;
+    }
+    if(!changed) return;
+
+    __atomic_store_n(&vector_binning, 1, __ATOMIC_SEQ_CST);
+    vector_shape_t shapes[SPRITES];
+    VECTOR_LOCK();
+    memcpy(shapes, vector_shapes, sizeof(shapes));
+    binned_version = vector_version;
+    VECTOR_UNLOCK();
+    for(uint8_t s=0;s<SPRITES;s++) {
+        binned_vis[s] = sprite_vis[s] & VECTOR_VIS;
+        binned_x[s] = sprite_x_px[s];
+        binned_y[s] = sprite_y_px[s];
+    }
+
+    vector_bins_t *b = vector_back();
+    memset(b->row_start, 0, (V_RES+1)*sizeof(uint32_t));
+    b->segs = 0;
+    uint32_t emitted = 0;
+    // Count each row's spans, make room for them, then place them
+    for(uint8_t pass=0;pass<2;pass++) {
+        emitted = 0;
+        for(uint8_t s=0;s<SPRITES;s++) {
+            if(!binned_vis[s] || shapes[s].count == 0) continue;
+            int32_t ox = binned_x[s];
+            int32_t oy = binned_y[s];
+            for(uint32_t i=0;i<shapes[s].count;i++) {
+                vector_seg_t *g = &shapes[s].segs[i];
+                vector_seg_spans(b, pass, &emitted, g->x0 + ox, g->y0 + oy, g->x1 + ox, g->y1 + oy, g->color, s);
+            }
+            if(pass == 0) b->segs += shapes[s].count;
+        }
+        if(pass == 0) {
+            for(uint16_t y=0;y<V_RES;y++) {
+                b->row_start[y+1] += b->row_start[y];
+                vector_fill[y] = b->row_start[y];
+            }
+        }
+    }
+    b->dropped = (emitted > MAX_LINE_EMITS) ? emitted - MAX_LINE_EMITS : 0;
+
+    for(uint8_t s=0;s<SPRITES;s++) {
+        display_rect_t *r = &b->bounds[s];
+        *r = (display_rect_t){ 0, 0, -1, -1 };
+        if(!binned_vis[s] || shapes[s].count == 0) continue;
+        int32_t x0 = MAX(shapes[s].box.x0 + binned_x[s], 0);
+        int32_t y0 = MAX(shapes[s].box.y0 + binned_y[s], 0);
+        int32_t x1 = MIN(shapes[s].box.x1 + binned_x[s], H_RES-1);
+        int32_t y1 = MIN(shapes[s].box.y1 + binned_y[s], V_RES-1);
+        if(x1 >= x0 && y1 >= y0) *r = (display_rect_t){ x0, y0, x1, y1 };
+    }
+    __atomic_store_n(&vector_binning, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&vector_ready, 1, __ATOMIC_RELEASE);
+}
+
+// From display_frame_done_generic, which is an ISR on the ESP
+void vector_frame_done() {
+    if(__atomic_load_n(&vector_ready, __ATOMIC_ACQUIRE)) {
+        vector_front = vector_back();
+        __atomic_store_n(&vector_ready, 0, __ATOMIC_RELEASE);
+    }
+}
+
+// With the display stopped
+void vector_teardown() {
+    vector_reset();
+    vector_front = NULL;
+    vector_ready = 0;
+    binned_version = 0;
+    for(uint8_t i=0;i<2;i++) {
+        if(vector_bufs[i].row_start != NULL) free_caps(vector_bufs[i].row_start);
+        if(vector_bufs[i].spans != NULL) free_caps(vector_bufs[i].spans);
+        vector_bufs[i].row_start = NULL;
+        vector_bufs[i].spans = NULL;
+    }
+    if(vector_fill != NULL) free_caps(vector_fill);
+    vector_fill = NULL;
+}
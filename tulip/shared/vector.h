@@ -0,0 +1,51 @@
+// vector.h
+// line, bezier and ellipse sprites, binned into scanline spans and drawn by the compositor
+#ifndef __VECTORH
+#define __VECTORH
+
+#include "display.h"
+#include "polyfills.h"
+
+// Numbers per primitive in what python hands us, the last one is always the color
+#define VECTOR_LINE_LEN 5       // x0, y0, x1, y1, color
+#define VECTOR_BEZIER_LEN 7     // x0, y0, cx, cy, x1, y1, color. A quadratic curve through cx,cy's pull
+#define VECTOR_ELLIPSE_LEN 5    // cx, cy, rx, ry, color
+// Most line segments a bezier or an ellipse gets flattened into
+#define VECTOR_BEZIER_SEGS 32
+#define VECTOR_ELLIPSE_SEGS 64
+
+// Everything is flattened to these when it's set, coordinates are relative to the sprite's x,y
+typedef struct {
+    int16_t x0, y0, x1, y1;
+    uint8_t color;
+} vector_seg_t;
+
+// The pixels one segment covers on one scanline
+typedef struct {
+    int16_t x0, x1;     // screen px, inclusive, clipped to the screen
+    uint8_t color;
+    uint8_t s;          // sprite slot. A row's spans are in slot order so they layer like bitmap sprites
+} vector_span_t;
+
+// One frame of spans bucketed by row. The display task fills one while the compositor reads the other
+typedef struct {
+    vector_span_t *spans;           // [MAX_LINE_EMITS]
+    uint32_t *row_start;            // [V_RES+1], row y is spans[row_start[y]] up to spans[row_start[y+1]]
+    display_rect_t bounds[SPRITES]; // what each slot covers on screen, x1 < x0 for nothing
+    uint32_t segs;
+    uint32_t dropped;               // spans past MAX_LINE_EMITS
+} vector_bins_t;
+
+extern vector_bins_t * volatile vector_front;
+
+int32_t vector_set(uint8_t s, uint8_t kind, const int16_t *prims, uint32_t count);
+void vector_clear(uint8_t s);
+uint8_t vector_kind(uint8_t s);
+uint8_t vector_bounds(uint8_t s, display_rect_t *r);
+void vector_stats(uint32_t *segs, uint32_t *spans, uint32_t *dropped);
+void vector_reset();
+void vector_bin();
+void vector_frame_done();
+void vector_teardown();
+
+#endif